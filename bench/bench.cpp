@@ -0,0 +1,587 @@
+/**
+* Hermes microbenchmarks.
+*
+* Measures the distance kernels (aligned and unaligned rows), every
+* DistanceFunction subclass, Evaluator dispatch and batches, and the
+* serialization and Base64/hex paths of BasicArrayObject, over a range of
+* dimensions and element types. Every result reports ns/op, GB/s of operand
+* data and operations per second, and the heap allocations per operation.
+*
+* Usage: bench [--format text|csv|json] [--filter text] [--dims 8,64,...]
+*              [--time seconds] [--level scalar|sse2|avx2|avx512]
+*/
+#include <BrayCurtisDistance.h>
+#include <CanberraDistance.h>
+#include <ChebyshevDistance.h>
+#include <ChiSquareDistance.h>
+#include <CosineDistance.h>
+#include <DotProductDistance.h>
+#include <MinkowskiDistance.h>
+#include <EuclideanDistance.h>
+#include <HammingDistance.h>
+#include <JeffreyDivergence.h>
+#include <ManhattanDistance.h>
+#include <BasicArrayObject.h>
+#include <BitArrayObject.h>
+#include <BulkSerializer.h>
+#include <Evaluator.h>
+#include <FeatureVectorStore.h>
+#include <TextCodec.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Every heap allocation of the process is counted, so that each result can
+// tell how many allocations an operation costs.
+static std::atomic<uint64_t> allocations(0);
+
+// GCC does not know these replace the global operators, and takes the
+// free() calls below for mismatches.
+#if defined(__GNUC__) && !defined(__clang__)
+#  pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t size){
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size, std::align_val_t alignment){
+
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t a = (size_t) alignment;
+    void *p = aligned_alloc(a, (size + a - 1) / a * a);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept{
+
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept{
+
+    free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept{
+
+    free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept{
+
+    free(p);
+}
+
+namespace{
+
+struct Options{
+    std::string format;
+    std::string filter;
+    std::vector<uint32_t> dims;
+    double seconds;
+};
+
+struct Result{
+    std::string name;
+    std::string type;
+    std::string layout;
+    uint32_t dim;
+    double nsPerOp;
+    double gbPerSecond;
+    double opsPerSecond;
+    double allocsPerOp;
+};
+
+Options options;
+std::vector<Result> results;
+// Keeps the compiler from dropping the measured work.
+volatile double sink;
+
+template <class T> const char *typeName();
+template <> const char *typeName<double>(){ return "float64"; }
+template <> const char *typeName<float>(){ return "float32"; }
+template <> const char *typeName<int32_t>(){ return "int32"; }
+template <> const char *typeName<uint8_t>(){ return "uint8"; }
+template <> const char *typeName<bool>(){ return "bit"; }
+
+bool selected(const std::string &name){
+
+    return options.filter.empty() || (name.find(options.filter) != std::string::npos);
+}
+
+void report(const Result &r){
+
+    if (options.format == "csv"){
+        printf("%s,%s,%s,%u,%.3f,%.3f,%.0f,%.3f\n", r.name.c_str(), r.type.c_str(), r.layout.c_str(), r.dim,
+               r.nsPerOp, r.gbPerSecond, r.opsPerSecond, r.allocsPerOp);
+    } else if (options.format == "text"){
+        printf("%-28s %-8s %-10s %6u %12.2f %9.2f %14.0f %8.2f\n", r.name.c_str(), r.type.c_str(), r.layout.c_str(), r.dim,
+               r.nsPerOp, r.gbPerSecond, r.opsPerSecond, r.allocsPerOp);
+    }
+    fflush(stdout);
+    results.push_back(r);
+}
+
+/**
+* Runs body(iterations), which performs that many operations, until the
+* runs last options.seconds, and reports the best of three.
+*
+* @param bytes The operand bytes read by one operation, for GB/s.
+*/
+template <class Body>
+void measure(const std::string &name, const char *type, const char *layout, uint32_t dim, double bytes, Body body){
+
+    if (!selected(name))
+        return;
+
+    typedef std::chrono::steady_clock Clock;
+    double target = options.seconds / 3;
+    uint64_t iterations = 1;
+    for (;;){
+        Clock::time_point start = Clock::now();
+        body(iterations);
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if ((elapsed >= target) || (iterations >= ((uint64_t) 1 << 40)))
+            break;
+        double scale = (elapsed > 0.0) ? 1.2 * target / elapsed : 100.0;
+        iterations = (uint64_t) (iterations * std::min(100.0, std::max(2.0, scale)));
+    }
+
+    double best = 1e300;
+    uint64_t before = allocations.load();
+    for (int run = 0; run < 3; run++){
+        Clock::time_point start = Clock::now();
+        body(iterations);
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    uint64_t allocated = allocations.load() - before;
+
+    Result r;
+    r.name = name;
+    r.type = type;
+    r.layout = layout;
+    r.dim = dim;
+    r.nsPerOp = best * 1e9 / iterations;
+    r.opsPerSecond = iterations / best;
+    r.gbPerSecond = bytes * iterations / best / 1e9;
+    r.allocsPerOp = (double) allocated / (3.0 * iterations);
+    report(r);
+}
+
+// Rows of random values in [1, 100], kept in a cache-sized pool.
+template <class T>
+void fill(T *p, size_t n, std::mt19937 &random){
+
+    std::uniform_real_distribution<double> value(1.0, 100.0);
+    for (size_t i = 0; i < n; i++)
+        p[i] = (T) value(random);
+}
+
+size_t poolSize(uint32_t dim, size_t element){
+
+    // About 256 KiB of rows, at least 4.
+    return std::max((size_t) 4, std::min((size_t) 1024, (size_t) (256 * 1024) / (dim * element)));
+}
+
+/**
+* The static kernel of Metric over raw rows, 64-byte aligned or one element
+* off.
+*/
+template <class Metric, class T>
+void benchKernel(const char *metric, uint32_t dim){
+
+    size_t rows = poolSize(dim, sizeof(T));
+    size_t stride = (dim * sizeof(T) + 63) / 64 * 64 / sizeof(T) + 64 / sizeof(T);
+    T *base = (T *) ::operator new(rows * stride * sizeof(T) + 64, std::align_val_t(64));
+    std::mt19937 random(dim);
+    fill(base, rows * stride, random);
+
+    const char *layouts[] = {"aligned", "unaligned"};
+    for (int l = 0; l < 2; l++){
+        const T *first = base + l;
+        measure(std::string("kernel/") + metric, typeName<T>(), layouts[l], dim, 2.0 * dim * sizeof(T), [&](uint64_t iterations){
+            double s = 0.0;
+            for (uint64_t x = 0; x < iterations; x++){
+                size_t a = x % rows, b = (x + 1) % rows;
+                s += Metric::template compute<T>(first + a * stride, first + b * stride, dim);
+            }
+            sink = s;
+        });
+    }
+    ::operator delete(base, std::align_val_t(64));
+}
+
+template <class T>
+std::vector< BasicArrayObject<T> > makeObjects(uint32_t dim, size_t count){
+
+    std::mt19937 random(dim * 31 + count);
+    std::vector< BasicArrayObject<T> > list(count);
+    for (size_t x = 0; x < count; x++){
+        list[x].setOID(x);
+        list[x].resize(dim);
+        fill(list[x].getMutableData(), dim, random);
+    }
+    return list;
+}
+
+/**
+* A DistanceFunction subclass called through the base class, as the index
+* structures do.
+*/
+template <class Metric, class T>
+void benchObject(const char *metric, uint32_t dim){
+
+    std::vector< BasicArrayObject<T> > list = makeObjects<T>(dim, poolSize(dim, sizeof(T)));
+    Metric function;
+    DistanceFunction< BasicArrayObject<T> > &df = function;
+    size_t rows = list.size();
+    measure(std::string("object/") + metric, typeName<T>(), "vector", dim, 2.0 * dim * sizeof(T), [&](uint64_t iterations){
+        double s = 0.0;
+        for (uint64_t x = 0; x < iterations; x++)
+            s += df.getDistance(list[x % rows], list[(x + 1) % rows]);
+        sink = s;
+    });
+}
+
+/**
+* Evaluator dispatch, one pair at a time and in batches over a
+* FeatureVectorStore.
+*/
+template <class T>
+void benchEvaluator(const char *metric, uint16_t type, uint32_t dim){
+
+    typedef BasicArrayObject<T> Object;
+    std::vector<Object> list = makeObjects<T>(dim, poolSize(dim, sizeof(T)));
+    size_t rows = list.size();
+    Evaluator<Object> evaluator(type);
+    measure(std::string("evaluator/") + metric, typeName<T>(), "vector", dim, 2.0 * dim * sizeof(T), [&](uint64_t iterations){
+        double s = 0.0;
+        for (uint64_t x = 0; x < iterations; x++)
+            s += evaluator.getDistance(list[x % rows], list[(x + 1) % rows]);
+        sink = s;
+    });
+
+    FeatureVectorStore<T> store(list, FeatureVectorStore<T>::PADDED);
+    Evaluator< FeatureVectorView<T> > viewEvaluator(type);
+    FeatureVectorView<T> query = store.getView(0);
+    std::vector<double> out(rows);
+    // One operation is one distance, so batches compare with the rows above.
+    measure(std::string("batch/") + metric, typeName<T>(), "padded", dim, 1.0 * dim * sizeof(T), [&](uint64_t iterations){
+        double s = 0.0;
+        for (uint64_t done = 0; done < iterations; done += rows){
+            viewEvaluator.getDistances(query, store.begin(), store.end(), &out[0]);
+            s += out[done % rows];
+        }
+        sink = s;
+    });
+}
+
+template <class T>
+void benchMetrics(uint32_t dim){
+
+    typedef BasicArrayObject<T> Object;
+    benchKernel< EuclideanDistance<Object>, T >("euclidean", dim);
+    benchKernel< ManhattanDistance<Object>, T >("cityblock", dim);
+    benchKernel< ChebyshevDistance<Object>, T >("chebyshev", dim);
+    benchKernel< JeffreyDivergence<Object>, T >("jeffrey", dim);
+    benchKernel< CanberraDistance<Object>, T >("canberra", dim);
+    benchKernel< BrayCurtisDistance<Object>, T >("braycurtis", dim);
+    benchKernel< ChiSquareDistance<Object>, T >("chisquare", dim);
+    benchKernel< HammingDistance<Object>, T >("hamming", dim);
+    benchKernel< CosineDistance<Object>, T >("cosine", dim);
+    benchKernel< DotProductDistance<Object>, T >("dotproduct", dim);
+    benchKernel< MinkowskiDistance<Object, 1, 2>, T >("minkowski0.5", dim);
+    benchKernel< MinkowskiDistance<Object, 3>, T >("minkowski3", dim);
+
+    benchObject< EuclideanDistance<Object>, T >("euclidean", dim);
+    benchObject< ManhattanDistance<Object>, T >("cityblock", dim);
+    benchObject< ChebyshevDistance<Object>, T >("chebyshev", dim);
+    benchObject< JeffreyDivergence<Object>, T >("jeffrey", dim);
+    benchObject< CanberraDistance<Object>, T >("canberra", dim);
+    benchObject< BrayCurtisDistance<Object>, T >("braycurtis", dim);
+    benchObject< ChiSquareDistance<Object>, T >("chisquare", dim);
+    benchObject< HammingDistance<Object>, T >("hamming", dim);
+    benchObject< CosineDistance<Object>, T >("cosine", dim);
+    benchObject< DotProductDistance<Object>, T >("dotproduct", dim);
+    benchObject< MinkowskiDistance<Object, 1, 2>, T >("minkowski0.5", dim);
+    benchObject< MinkowskiDistance<Object, 3>, T >("minkowski3", dim);
+
+    benchEvaluator<T>("euclidean", Evaluator<Object>::EUCLIDEAN, dim);
+    benchEvaluator<T>("cityblock", Evaluator<Object>::CITYBLOCK, dim);
+    benchEvaluator<T>("chebyshev", Evaluator<Object>::CHEBYSHEV, dim);
+    benchEvaluator<T>("jeffrey", Evaluator<Object>::JEFFREY, dim);
+    benchEvaluator<T>("canberra", Evaluator<Object>::CANBERRA, dim);
+    benchEvaluator<T>("braycurtis", Evaluator<Object>::BRAYCURTIS, dim);
+    benchEvaluator<T>("chisquare", Evaluator<Object>::QUISQUARE, dim);
+    benchEvaluator<T>("hamming", Evaluator<Object>::HAMMING, dim);
+    benchEvaluator<T>("cosine", Evaluator<Object>::COSINE, dim);
+    benchEvaluator<T>("dotproduct", Evaluator<Object>::DOTPRODUCT, dim);
+}
+
+/**
+* Hamming distance of bit-packed vectors; dim counts bits.
+*/
+void benchBits(uint32_t dim){
+
+    size_t rows = poolSize((dim + 63) / 64, sizeof(uint64_t));
+    std::mt19937 random(dim);
+    std::vector<BitArrayObject> list(rows);
+    for (size_t x = 0; x < rows; x++){
+        list[x].setOID(x);
+        for (uint32_t i = 0; i < dim; i++)
+            list[x].add((random() & 1) != 0);
+    }
+    HammingDistance<BitArrayObject> function;
+    DistanceFunction<BitArrayObject> &df = function;
+    measure("object/hamming", typeName<bool>(), "packed", dim, 2.0 * ((dim + 63) / 64) * 8, [&](uint64_t iterations){
+        double s = 0.0;
+        for (uint64_t x = 0; x < iterations; x++)
+            s += df.getDistance(list[x % rows], list[(x + 1) % rows]);
+        sink = s;
+    });
+}
+
+/**
+* serialize()/unserialize(), the string versions and the text codecs. One
+* operation handles one feature vector; GB/s counts its serialized bytes.
+*/
+template <class T>
+void benchSerialization(uint32_t dim){
+
+    typedef BasicArrayObject<T> Object;
+    std::vector<Object> list = makeObjects<T>(dim, 1);
+    Object &object = list[0];
+    const char *type = typeName<T>();
+    double bytes = object.getSerializedSize();
+
+    measure("serialize", type, "vector", dim, bytes, [&](uint64_t iterations){
+        size_t s = 0;
+        for (uint64_t x = 0; x < iterations; x++){
+            // Drops the cached copy, as any change of the object would.
+            object.setOID(x);
+            s += object.serialize()[0];
+        }
+        sink = s;
+    });
+
+    std::string serialized = object.serializeToString();
+    Object target;
+    measure("unserialize", type, "vector", dim, bytes, [&](uint64_t iterations){
+        double s = 0.0;
+        for (uint64_t x = 0; x < iterations; x++){
+            target.unserialize((const unsigned char *) serialized.data(), serialized.size());
+            s += target.getOID();
+        }
+        sink = s;
+    });
+
+    measure("serializeToString", type, "vector", dim, bytes, [&](uint64_t iterations){
+        size_t s = 0;
+        for (uint64_t x = 0; x < iterations; x++){
+            object.setOID(x);
+            s += object.serializeToString().size();
+        }
+        sink = s;
+    });
+
+    measure("unserializeFromString", type, "vector", dim, bytes, [&](uint64_t iterations){
+        double s = 0.0;
+        for (uint64_t x = 0; x < iterations; x++){
+            target.unserializeFromString(serialized);
+            s += target.getOID();
+        }
+        sink = s;
+    });
+
+    const unsigned char *raw = (const unsigned char *) serialized.data();
+    std::vector<char> text(TextCodec::base64Size(serialized.size()) + 2 * serialized.size());
+    std::vector<unsigned char> decoded(serialized.size() + 4);
+
+    measure("base64/encode", type, "buffer", dim, bytes, [&](uint64_t iterations){
+        size_t s = 0;
+        for (uint64_t x = 0; x < iterations; x++)
+            s += TextCodec::encodeBase64(raw, serialized.size(), &text[0]);
+        sink = s;
+    });
+
+    size_t length = TextCodec::encodeBase64(raw, serialized.size(), &text[0]);
+    measure("base64/decode", type, "buffer", dim, bytes, [&](uint64_t iterations){
+        size_t s = 0;
+        for (uint64_t x = 0; x < iterations; x++)
+            s += TextCodec::decodeBase64(&text[0], length, &decoded[0]);
+        sink = s;
+    });
+
+    measure("hex/encode", type, "buffer", dim, bytes, [&](uint64_t iterations){
+        size_t s = 0;
+        for (uint64_t x = 0; x < iterations; x++)
+            s += TextCodec::encodeHex(raw, serialized.size(), &text[0]);
+        sink = s;
+    });
+
+    length = TextCodec::encodeHex(raw, serialized.size(), &text[0]);
+    measure("hex/decode", type, "buffer", dim, bytes, [&](uint64_t iterations){
+        size_t s = 0;
+        for (uint64_t x = 0; x < iterations; x++)
+            s += TextCodec::decodeHex(&text[0], length, &decoded[0]);
+        sink = s;
+    });
+
+    measure("serializeToBase64", type, "vector", dim, bytes, [&](uint64_t iterations){
+        size_t s = 0;
+        for (uint64_t x = 0; x < iterations; x++){
+            object.setOID(x);
+            s += object.serializeToBase64().size();
+        }
+        sink = s;
+    });
+
+    std::string base64 = object.serializeToBase64();
+    measure("unserializeFromBase64", type, "vector", dim, bytes, [&](uint64_t iterations){
+        double s = 0.0;
+        for (uint64_t x = 0; x < iterations; x++){
+            target.unserializeFromBase64(base64);
+            s += target.getOID();
+        }
+        sink = s;
+    });
+
+    // BulkSerializer over a pool of vectors; one operation is one vector.
+    std::vector<Object> pool = makeObjects<T>(dim, poolSize(dim, sizeof(T)));
+    const char *layouts[] = {"rows", "dims"};
+    for (int l = 0; l < 2; l++){
+        typename BulkSerializer<T>::Layout layout = (typename BulkSerializer<T>::Layout) l;
+        std::vector<unsigned char> buffer;
+        measure("bulk/serialize", type, layouts[l], dim, bytes, [&](uint64_t iterations){
+            size_t s = 0;
+            for (uint64_t done = 0; done < iterations; done += pool.size()){
+                BulkSerializer<T>::serialize(pool, buffer, layout);
+                s += buffer[done % buffer.size()];
+            }
+            sink = s;
+        });
+
+        BulkSerializer<T>::serialize(pool, buffer, layout);
+        std::vector<Object> batch;
+        measure("bulk/read", type, layouts[l], dim, bytes, [&](uint64_t iterations){
+            double s = 0.0;
+            for (uint64_t done = 0; done < iterations; done += pool.size()){
+                BulkReader<T> reader(buffer.data(), buffer.size());
+                while (reader.read(batch, 256) > 0)
+                    s += batch[0].getOID();
+            }
+            sink = s;
+        });
+    }
+}
+
+std::vector<uint32_t> parseDims(const char *text){
+
+    std::vector<uint32_t> dims;
+    while (*text != '\0'){
+        char *end;
+        unsigned long d = strtoul(text, &end, 10);
+        if ((end == text) || (d == 0)){
+            fprintf(stderr, "Invalid dimension list.\n");
+            exit(2);
+        }
+        dims.push_back(d);
+        text = (*end == ',') ? end + 1 : end;
+    }
+    return dims;
+}
+
+void usage(){
+
+    fprintf(stderr, "Usage: bench [--format text|csv|json] [--filter text] [--dims 8,64,...]\n"
+                    "             [--time seconds] [--level scalar|sse2|avx2|avx512]\n");
+    exit(2);
+}
+
+void printJson(){
+
+    printf("{\"level\":\"%s\",\"results\":[", DistanceKernels::levelName(DistanceKernels::level()));
+    for (size_t x = 0; x < results.size(); x++){
+        const Result &r = results[x];
+        printf("%s\n{\"name\":\"%s\",\"type\":\"%s\",\"layout\":\"%s\",\"dim\":%u,\"nsPerOp\":%.3f,"
+               "\"gbPerSecond\":%.3f,\"opsPerSecond\":%.0f,\"allocsPerOp\":%.3f}",
+               x ? "," : "", r.name.c_str(), r.type.c_str(), r.layout.c_str(), r.dim,
+               r.nsPerOp, r.gbPerSecond, r.opsPerSecond, r.allocsPerOp);
+    }
+    printf("]}\n");
+}
+
+}
+
+int main(int argc, char **argv){
+
+    options.format = "text";
+    options.seconds = 0.06;
+    options.dims = parseDims("8,16,32,64,128,256,512,1024,2048,4096");
+
+    for (int a = 1; a < argc; a++){
+        std::string arg = argv[a];
+        if (a + 1 >= argc)
+            usage();
+        const char *value = argv[++a];
+        if (arg == "--format"){
+            options.format = value;
+            if ((options.format != "text") && (options.format != "csv") && (options.format != "json"))
+                usage();
+        } else if (arg == "--filter"){
+            options.filter = value;
+        } else if (arg == "--dims"){
+            options.dims = parseDims(value);
+        } else if (arg == "--time"){
+            options.seconds = atof(value);
+        } else if (arg == "--level"){
+            std::string level = value;
+            if (level == "scalar") DistanceKernels::setLevel(DistanceKernels::SCALAR);
+            else if (level == "sse2") DistanceKernels::setLevel(DistanceKernels::SSE2);
+            else if (level == "avx2") DistanceKernels::setLevel(DistanceKernels::AVX2);
+            else if (level == "avx512") DistanceKernels::setLevel(DistanceKernels::AVX512);
+            else usage();
+        } else {
+            usage();
+        }
+    }
+
+    if (options.format == "csv"){
+        printf("name,type,layout,dim,ns_per_op,gb_per_s,ops_per_s,allocs_per_op\n");
+    } else if (options.format == "text"){
+        printf("# kernel level: %s\n", DistanceKernels::levelName(DistanceKernels::level()));
+        printf("%-28s %-8s %-10s %6s %12s %9s %14s %8s\n", "name", "type", "layout", "dim", "ns/op", "GB/s", "ops/s", "allocs");
+    }
+
+    for (size_t d = 0; d < options.dims.size(); d++){
+        uint32_t dim = options.dims[d];
+        benchMetrics<double>(dim);
+        benchMetrics<float>(dim);
+        benchMetrics<int32_t>(dim);
+        benchMetrics<uint8_t>(dim);
+        benchBits(dim);
+        benchSerialization<double>(dim);
+        benchSerialization<float>(dim);
+        benchSerialization<uint8_t>(dim);
+    }
+
+    if (options.format == "json")
+        printJson();
+    return 0;
+}
@@ -0,0 +1,85 @@
+template <class ObjectType>
+BrayCurtisDistance<ObjectType>::BrayCurtisDistance(){
+
+    this->metricType = MetricType;
+}
+
+template <class ObjectType>
+BrayCurtisDistance<ObjectType>::~BrayCurtisDistance(){
+}
+
+template <class ObjectType>
+double BrayCurtisDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
+
+    return getDistance(obj1, obj2);
+}
+
+template <class ObjectType>
+double BrayCurtisDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    double d;
+    if constexpr (HasAuxiliaries<ObjectType>::value){
+        d = computeWithAuxiliaries(obj1.getRawData(), obj1.getAuxiliaries(), obj2.getRawData(), obj2.getAuxiliaries(), obj1.size());
+    } else {
+        d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+    }
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void BrayCurtisDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    DistanceKernels::computeObjectBatch<BrayCurtisDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+template <class T>
+double BrayCurtisDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return DistanceKernels::compute<BrayCurtisKernel>(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+double BrayCurtisDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    // Bray-Curtis is a ratio of sums, so it cannot stop early.
+    (void) bound;
+    (void) order;
+    return compute(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+void BrayCurtisDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<BrayCurtisKernel>(q, c, count, n, out);
+}
+
+template <class ObjectType>
+template <class T>
+double BrayCurtisDistance<ObjectType>::computeWithAuxiliaries(const T *a, const VectorAuxiliaries &xa, const T *b, const VectorAuxiliaries &xb, size_t n){
+
+    // Without negative elements, sum |a + b| = sum |a| + sum |b|.
+    if (!xa.nonNegative || !xb.nonNegative)
+        return compute(a, b, n);
+    double t = xa.absSum + xb.absSum;
+    return (t == 0.0) ? 0.0 : DistanceKernels::compute<ManhattanKernel>(a, b, n) / t;
+}
@@ -0,0 +1,44 @@
+#ifndef BRAYCURTISDISTANCE_H
+#define BRAYCURTISDISTANCE_H
+
+#include "DistanceFunction.h"
+#include "DistanceKernels.h"
+#include "VectorAuxiliaries.h"
+#include <cmath>
+#include <stdexcept>
+
+/**
+* Bray-Curtis dissimilarity: sum |a - b| / sum |a + b|.
+* Identical or all-zero vectors are at distance 0.
+* getDistance() on non-negative feature vectors keeping VectorAuxiliaries
+* takes the denominator from their sums.
+*/
+template <class ObjectType>
+class BrayCurtisDistance : public DistanceFunction <ObjectType>{
+
+    public:
+
+        // Same number as Evaluator::BRAYCURTIS.
+        static const uint16_t MetricType = 6;
+
+        BrayCurtisDistance();
+        virtual ~BrayCurtisDistance();
+
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
+        template <class T>
+        static double computeWithAuxiliaries(const T *a, const VectorAuxiliaries &xa, const T *b, const VectorAuxiliaries &xb, size_t n);
+};
+
+#include "BrayCurtisDistance-inl.h"
+#endif // BRAYCURTISDISTANCE_H
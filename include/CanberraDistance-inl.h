@@ -1,5 +1,7 @@
 template <class ObjectType>
 CanberraDistance<ObjectType>::CanberraDistance(){
+
+    this->metricType = MetricType;
 }
 
 
@@ -9,44 +11,79 @@ CanberraDistance<ObjectType>::~CanberraDistance(){
 
 
 template <class ObjectType>
-double CanberraDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double CanberraDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
 
     return getDistance(obj1, obj2);
 }
 
 
 template <class ObjectType>
-double CanberraDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double CanberraDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
 
     if (obj1.size() != obj2.size())
         throw std::length_error("The feature vectors do not have the same size.");
 
-    double d = 0;
-    double tmp;
-    double ai, bi, mai, mbi;
-
-    ai = bi = 0.0;
+    double d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
 
-    for (size_t i = 0; i < obj1.size(); i++){
+    // Statistic support
+    this->updateDistanceCount();
 
-        ai = obj1[i];
-        bi = obj2[i];
+    return d;
+}
 
-        mai = sqrt(pow(ai, 2.0));
-        mbi = sqrt(pow(bi, 2.0));
+template <class ObjectType>
+void CanberraDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
 
-        double den = mai+mbi;
-        if (den == 0.0){
-            den = 1.0;
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
         }
-
-        tmp = (sqrt(pow((ai - bi), 2.0)))/den;
-        d = d + tmp;
     }
 
+    DistanceKernels::computeObjectBatch<CanberraDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+double CanberraDistance<ObjectType>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size())
+        throw std::length_error("The feature vectors do not have the same size.");
+
+    if ((order != NULL) && (order->size() != obj1.size()))
+        throw std::length_error("The dimension order does not match the feature vectors size.");
+
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+
     // Statistic support
     this->updateDistanceCount();
 
     return d;
 }
 
+template <class ObjectType>
+template <class T>
+double CanberraDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return DistanceKernels::compute<CanberraKernel>(a, b, n);
+}
+
+
+template <class ObjectType>
+template <class T>
+double CanberraDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    return DistanceKernels::computeBounded<CanberraKernel>(a, b, n, bound, order);
+}
+
+
+template <class ObjectType>
+template <class T>
+void CanberraDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<CanberraKernel>(q, c, count, n, out);
+}
+
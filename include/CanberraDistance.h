@@ -2,6 +2,7 @@
 #define CANBERRADISTANCE_H
 
 #include "DistanceFunction.h"
+#include "DistanceKernels.h"
 #include <cmath>
 #include <stdexcept>
 
@@ -10,11 +11,25 @@ class CanberraDistance : public DistanceFunction <ObjectType>{
 
     public:
 
+        // Same number as Evaluator::CANBERRA.
+        static const uint16_t MetricType = 5;
+
         CanberraDistance();
         virtual ~CanberraDistance();
 
-        double GetDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error);
-        double getDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error);
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+        double getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order = NULL);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
 };
 
 #include "CanberraDistance-inl.h"
@@ -1,5 +1,7 @@
 template <class ObjectType>
 ChebyshevDistance<ObjectType>::ChebyshevDistance(){
+
+    this->metricType = MetricType;
 }
 
 template <class ObjectType>
@@ -7,29 +9,76 @@ ChebyshevDistance<ObjectType>::~ChebyshevDistance(){
 }
 
 template <class ObjectType>
-double ChebyshevDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double ChebyshevDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
 
     return getDistance(obj1, obj2);
 }
 
 template <class ObjectType>
-double ChebyshevDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double ChebyshevDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
 
     if (obj1.size() != obj2.size())
         throw std::length_error("The feature vectors do not have the same size.");
 
-    double d = 0;
-    double tmp;
+    double d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void ChebyshevDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
 
-    for (size_t i = 0; i < obj1.size(); i++){
-        tmp = fabs(obj1[i] - obj2[i]);
-        if (tmp > d){
-            d = tmp;
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
         }
     }
 
+    DistanceKernels::computeObjectBatch<ChebyshevDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+double ChebyshevDistance<ObjectType>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size())
+        throw std::length_error("The feature vectors do not have the same size.");
+
+    if ((order != NULL) && (order->size() != obj1.size())){
+        throw std::length_error("The dimension order does not match the feature vectors size.");
+    }
+
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+
     // Statistic support
     this->updateDistanceCount();
 
     return d;
 }
+
+template <class ObjectType>
+template <class T>
+double ChebyshevDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return DistanceKernels::compute<ChebyshevKernel>(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+double ChebyshevDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    return DistanceKernels::computeBounded<ChebyshevKernel>(a, b, n, bound, order);
+}
+
+template <class ObjectType>
+template <class T>
+void ChebyshevDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<ChebyshevKernel>(q, c, count, n, out);
+}
@@ -0,0 +1,86 @@
+template <class ObjectType>
+ChiSquareDistance<ObjectType>::ChiSquareDistance(){
+
+    this->metricType = MetricType;
+}
+
+template <class ObjectType>
+ChiSquareDistance<ObjectType>::~ChiSquareDistance(){
+}
+
+template <class ObjectType>
+double ChiSquareDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
+
+    return getDistance(obj1, obj2);
+}
+
+template <class ObjectType>
+double ChiSquareDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    double d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void ChiSquareDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    DistanceKernels::computeObjectBatch<ChiSquareDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+double ChiSquareDistance<ObjectType>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    if ((order != NULL) && (order->size() != obj1.size())){
+        throw std::length_error("The dimension order does not match the feature vectors size.");
+    }
+
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+template <class T>
+double ChiSquareDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return DistanceKernels::compute<ChiSquareKernel>(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+double ChiSquareDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    return DistanceKernels::computeBounded<ChiSquareKernel>(a, b, n, bound, order);
+}
+
+template <class ObjectType>
+template <class T>
+void ChiSquareDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<ChiSquareKernel>(q, c, count, n, out);
+}
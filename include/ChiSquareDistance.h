@@ -0,0 +1,40 @@
+#ifndef CHISQUAREDISTANCE_H
+#define CHISQUAREDISTANCE_H
+
+#include "DistanceFunction.h"
+#include "DistanceKernels.h"
+#include <cmath>
+#include <stdexcept>
+
+/**
+* Chi-square distance: sum (a - b)^2 / (a + b), meant for non-negative
+* histograms. Bins that are zero in both vectors add zero.
+*/
+template <class ObjectType>
+class ChiSquareDistance : public DistanceFunction <ObjectType>{
+
+    public:
+
+        // Same number as Evaluator::QUISQUARE.
+        static const uint16_t MetricType = 7;
+
+        ChiSquareDistance();
+        virtual ~ChiSquareDistance();
+
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+        double getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order = NULL);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
+};
+
+#include "ChiSquareDistance-inl.h"
+#endif // CHISQUAREDISTANCE_H
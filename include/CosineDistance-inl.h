@@ -0,0 +1,103 @@
+template <class ObjectType>
+CosineDistance<ObjectType>::CosineDistance(){
+
+    this->metricType = MetricType;
+}
+
+template <class ObjectType>
+CosineDistance<ObjectType>::~CosineDistance(){
+}
+
+template <class ObjectType>
+double CosineDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
+
+    return getDistance(obj1, obj2);
+}
+
+template <class ObjectType>
+double CosineDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    double d;
+    if constexpr (HasAuxiliaries<ObjectType>::value){
+        d = computeWithAuxiliaries(obj1.getRawData(), obj1.getAuxiliaries(), obj2.getRawData(), obj2.getAuxiliaries(), obj1.size());
+    } else {
+        d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+    }
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void CosineDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    if constexpr (HasAuxiliaries<ObjectType>::value){
+        VectorAuxiliaries xq = query.getAuxiliaries();
+        for (size_t x = 0; x < count; x++){
+            out[x] = computeWithAuxiliaries(query.getRawData(), xq, candidates[x]->getRawData(), candidates[x]->getAuxiliaries(), query.size());
+        }
+    } else {
+        DistanceKernels::computeObjectBatch<CosineDistance>(query.getRawData(), candidates, count, query.size(), out);
+    }
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+template <class T>
+double CosineDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return fromDotProduct(DistanceKernels::compute<DotProductKernel>(a, b, n),
+                          DistanceKernels::compute<DotProductKernel>(a, a, n),
+                          DistanceKernels::compute<DotProductKernel>(b, b, n));
+}
+
+template <class ObjectType>
+template <class T>
+double CosineDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    // The cosine is a ratio of sums, so it cannot stop early.
+    (void) bound;
+    (void) order;
+    return compute(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+void CosineDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<DotProductKernel>(q, c, count, n, out);
+    double nq = DistanceKernels::compute<DotProductKernel>(q, q, n);
+    for (size_t x = 0; x < count; x++)
+        out[x] = fromDotProduct(out[x], nq, DistanceKernels::compute<DotProductKernel>(c[x], c[x], n));
+}
+
+template <class ObjectType>
+template <class T>
+double CosineDistance<ObjectType>::computeWithAuxiliaries(const T *a, const VectorAuxiliaries &xa, const T *b, const VectorAuxiliaries &xb, size_t n){
+
+    return fromDotProduct(DistanceKernels::compute<DotProductKernel>(a, b, n), xa.squaredNorm, xb.squaredNorm);
+}
+
+template <class ObjectType>
+double CosineDistance<ObjectType>::fromDotProduct(double dot, double squaredNorm1, double squaredNorm2){
+
+    if ((squaredNorm1 == 0.0) || (squaredNorm2 == 0.0))
+        return (squaredNorm1 == squaredNorm2) ? 0.0 : 1.0;
+    double c = dot / std::sqrt(squaredNorm1 * squaredNorm2);
+    c = (c > 1.0) ? 1.0 : ((c < -1.0) ? -1.0 : c);
+    return 1.0 - c;
+}
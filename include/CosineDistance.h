@@ -0,0 +1,50 @@
+#ifndef COSINEDISTANCE_H
+#define COSINEDISTANCE_H
+
+#include "DistanceFunction.h"
+#include "DistanceKernels.h"
+#include "VectorAuxiliaries.h"
+#include <cmath>
+#include <stdexcept>
+
+/**
+* Cosine distance: 1 - a.b / (|a| |b|), in [0, 2].
+* A zero vector is at distance 0 from another zero vector and 1 from any
+* other vector. getDistance() on feature vectors keeping VectorAuxiliaries
+* takes the norms from them, leaving one dot product per pair.
+* Not a metric: it breaks the triangle inequality.
+*/
+template <class ObjectType>
+class CosineDistance : public DistanceFunction <ObjectType>{
+
+    public:
+
+        // Same number as Evaluator::COSINE.
+        static const uint16_t MetricType = 9;
+
+        CosineDistance();
+        virtual ~CosineDistance();
+
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
+        template <class T>
+        static double computeWithAuxiliaries(const T *a, const VectorAuxiliaries &xa, const T *b, const VectorAuxiliaries &xb, size_t n);
+
+        /**
+        * Gets the cosine distance from a dot product and the squared norms.
+        */
+        static double fromDotProduct(double dot, double squaredNorm1, double squaredNorm2);
+};
+
+#include "CosineDistance-inl.h"
+#endif // COSINEDISTANCE_H
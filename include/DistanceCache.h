@@ -0,0 +1,319 @@
+#ifndef DISTANCECACHE_H
+#define DISTANCECACHE_H
+
+#include "DistanceStatistics.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+* Tells whether a feature vector type numbers its contents with a
+* getVersion() method (see BasicArrayObject), which DistanceCache requires.
+*/
+template <class ObjectType, class = void>
+struct Versioned{
+    static const bool value = false;
+};
+
+template <class ObjectType>
+struct Versioned<ObjectType, decltype((void) std::declval<const ObjectType &>().getVersion())>{
+    static const bool value = true;
+};
+
+/**
+* A bounded, thread-safe memo of distances, keyed by the OIDs of the two
+* feature vectors, the metric type and the parameter of the metric if any
+* (e.g. the Minkowski order). Set it on one or more Evaluators
+* (Evaluator::setCache()) to answer repeated distances without computing
+* them, e.g. across relevance-feedback rounds or clustering passes.
+*
+* Every entry also records the content versions of both feature vectors
+* (BasicArrayObject::getVersion()): an entry is only used while both are
+* unchanged, and is replaced otherwise. invalidate() drops the entries of an
+* OID explicitly, e.g. when a feature vector is replaced by another one.
+*
+* The entries are split into stripes, each with its own lock, so threads
+* working on different pairs rarely wait for each other. Inside a stripe a
+* key maps to a set of Ways entries, and a full set evicts with the CLOCK
+* policy: entries used since the hand last passed get a second chance.
+* Distances are assumed symmetric, so (a, b) and (b, a) share an entry.
+*
+* Example:
+*   DistanceCache cache(1 << 20);
+*   Evaluator<FeatureVector> e(Evaluator<FeatureVector>::JEFFREY);
+*   e.setCache(&cache);
+*   e.getDistance(a, b); // Computed.
+*   e.getDistance(b, a); // Cached.
+*/
+class DistanceCache{
+
+    public:
+        static const uint32_t Ways = 8;
+
+    private:
+        struct Entry{
+            uint32_t oid1, oid2;
+            uint64_t version1, version2;
+            double dist;
+            uint64_t variant;
+            uint16_t metric;
+            uint8_t valid;
+            uint8_t referenced;
+        };
+
+        struct alignas(64) Stripe{
+            std::mutex mutex;
+            std::vector<Entry> entries;
+            std::vector<uint8_t> hands;
+            size_t used;
+            uint64_t hits, misses, evictions;
+        };
+
+        std::unique_ptr<Stripe[]> stripes;
+        uint32_t stripeCount;
+        size_t setsPerStripe;
+
+    public:
+
+        /**
+        * Constructor.
+        *
+        * @param capacity The maximum number of distances kept (rounded up to
+        * a whole number of sets in every stripe).
+        * @param stripeCount The number of independently locked stripes.
+        */
+        DistanceCache(size_t capacity = 1 << 20, uint32_t stripeCount = 64){
+
+            this->stripeCount = std::max(1u, stripeCount);
+            size_t sets = (capacity + Ways - 1) / Ways;
+            setsPerStripe = std::max((size_t) 1, (sets + this->stripeCount - 1) / this->stripeCount);
+
+            stripes.reset(new Stripe[this->stripeCount]);
+            for (uint32_t s = 0; s < this->stripeCount; s++){
+                stripes[s].entries.resize(setsPerStripe * Ways);
+                stripes[s].hands.resize(setsPerStripe);
+            }
+            clear();
+            resetStatistics();
+        }
+
+        DistanceCache(const DistanceCache &) = delete;
+        DistanceCache &operator=(const DistanceCache &) = delete;
+
+        /**
+        * Looks a distance up.
+        *
+        * @param metric The metric type, as in Evaluator.
+        * @param oid1 The OID of the first feature vector.
+        * @param version1 The content version of the first feature vector.
+        * @param oid2 The OID of the second feature vector.
+        * @param version2 The content version of the second feature vector.
+        * @param dist Receives the distance when found.
+        * @param variant Tells apart the parameters of the metric, e.g. the
+        * bits of the Minkowski order; 0 for metrics without one.
+        * @return Whether the distance was found.
+        */
+        bool lookup(uint16_t metric, uint32_t oid1, uint64_t version1, uint32_t oid2, uint64_t version2, double &dist, uint64_t variant = 0){
+
+            normalize(oid1, version1, oid2, version2);
+            uint64_t h = hash(metric, variant, oid1, oid2);
+            Stripe &s = stripes[h % stripeCount];
+            bool hit = false;
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                Entry *set = &s.entries[(h / stripeCount) % setsPerStripe * Ways];
+                for (uint32_t w = 0; w < Ways; w++){
+                    Entry &e = set[w];
+                    if (matches(e, metric, variant, oid1, oid2) && (e.version1 == version1) && (e.version2 == version2)){
+                        e.referenced = 1;
+                        dist = e.dist;
+                        hit = true;
+                        break;
+                    }
+                }
+                if (hit)
+                    s.hits++;
+                else
+                    s.misses++;
+            }
+            DistanceStatistics::countCache(metric, hit);
+            return hit;
+        }
+
+        /**
+        * Stores a distance, replacing the entry of the same pair if any, or
+        * evicting one of the set if it is full.
+        *
+        * @param metric The metric type, as in Evaluator.
+        * @param oid1 The OID of the first feature vector.
+        * @param version1 The content version of the first feature vector.
+        * @param oid2 The OID of the second feature vector.
+        * @param version2 The content version of the second feature vector.
+        * @param dist The distance.
+        * @param variant Tells apart the parameters of the metric, as in lookup().
+        */
+        void insert(uint16_t metric, uint32_t oid1, uint64_t version1, uint32_t oid2, uint64_t version2, double dist, uint64_t variant = 0){
+
+            normalize(oid1, version1, oid2, version2);
+            uint64_t h = hash(metric, variant, oid1, oid2);
+            Stripe &s = stripes[h % stripeCount];
+            size_t index = (h / stripeCount) % setsPerStripe;
+
+            std::lock_guard<std::mutex> lock(s.mutex);
+            Entry *set = &s.entries[index * Ways];
+            Entry *target = NULL;
+            for (uint32_t w = 0; (w < Ways) && (target == NULL); w++)
+                if (matches(set[w], metric, variant, oid1, oid2))
+                    target = &set[w];
+            for (uint32_t w = 0; (w < Ways) && (target == NULL); w++)
+                if (!set[w].valid)
+                    target = &set[w];
+            if (target == NULL){
+                // CLOCK: clear the reference bits until an entry has none.
+                uint8_t &hand = s.hands[index];
+                while (set[hand].referenced){
+                    set[hand].referenced = 0;
+                    hand = (hand + 1) % Ways;
+                }
+                target = &set[hand];
+                hand = (hand + 1) % Ways;
+                s.evictions++;
+            }
+            if (!target->valid)
+                s.used++;
+
+            target->oid1 = oid1;
+            target->oid2 = oid2;
+            target->version1 = version1;
+            target->version2 = version2;
+            target->dist = dist;
+            target->variant = variant;
+            target->metric = metric;
+            target->valid = 1;
+            target->referenced = 0;
+        }
+
+        /**
+        * Drops every distance involving an OID. Scans the whole cache.
+        *
+        * @param oid The OID of the feature vector.
+        */
+        void invalidate(uint32_t oid){
+
+            for (uint32_t x = 0; x < stripeCount; x++){
+                Stripe &s = stripes[x];
+                std::lock_guard<std::mutex> lock(s.mutex);
+                for (size_t y = 0; y < s.entries.size(); y++){
+                    Entry &e = s.entries[y];
+                    if (e.valid && ((e.oid1 == oid) || (e.oid2 == oid))){
+                        e.valid = 0;
+                        s.used--;
+                    }
+                }
+            }
+        }
+
+        /**
+        * Drops every distance.
+        */
+        void clear(){
+
+            for (uint32_t x = 0; x < stripeCount; x++){
+                Stripe &s = stripes[x];
+                std::lock_guard<std::mutex> lock(s.mutex);
+                for (size_t y = 0; y < s.entries.size(); y++){
+                    s.entries[y].valid = 0;
+                    s.entries[y].referenced = 0;
+                }
+                std::fill(s.hands.begin(), s.hands.end(), 0);
+                s.used = 0;
+            }
+        }
+
+        /**
+        * Gets the number of distances kept.
+        */
+        size_t size(){
+
+            return sum(&Stripe::used);
+        }
+
+        size_t getCapacity() const{
+
+            return (size_t) stripeCount * setsPerStripe * Ways;
+        }
+
+        /**
+        * Gets the number of lookups that found their distance.
+        */
+        uint64_t getHits(){
+
+            return sum(&Stripe::hits);
+        }
+
+        /**
+        * Gets the number of lookups that did not find their distance.
+        */
+        uint64_t getMisses(){
+
+            return sum(&Stripe::misses);
+        }
+
+        /**
+        * Gets the number of distances dropped to make room for others.
+        */
+        uint64_t getEvictions(){
+
+            return sum(&Stripe::evictions);
+        }
+
+        void resetStatistics(){
+
+            for (uint32_t x = 0; x < stripeCount; x++){
+                Stripe &s = stripes[x];
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.hits = s.misses = s.evictions = 0;
+            }
+        }
+
+    private:
+
+        static void normalize(uint32_t &oid1, uint64_t &version1, uint32_t &oid2, uint64_t &version2){
+
+            if ((oid1 > oid2) || ((oid1 == oid2) && (version1 > version2))){
+                std::swap(oid1, oid2);
+                std::swap(version1, version2);
+            }
+        }
+
+        static bool matches(const Entry &e, uint16_t metric, uint64_t variant, uint32_t oid1, uint32_t oid2){
+
+            return e.valid && (e.oid1 == oid1) && (e.oid2 == oid2) && (e.metric == metric) && (e.variant == variant);
+        }
+
+        // The finalizer of splitmix64.
+        static uint64_t hash(uint16_t metric, uint64_t variant, uint32_t oid1, uint32_t oid2){
+
+            uint64_t h = (((uint64_t) oid1 << 32) | oid2) ^ ((metric ^ variant) * 0x9e3779b97f4a7c15ull);
+            h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+            h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+            return h ^ (h >> 31);
+        }
+
+        template <class Counter>
+        uint64_t sum(Counter Stripe::*counter){
+
+            uint64_t total = 0;
+            for (uint32_t x = 0; x < stripeCount; x++){
+                std::lock_guard<std::mutex> lock(stripes[x].mutex);
+                total += stripes[x].*counter;
+            }
+            return total;
+        }
+};
+
+#endif // DISTANCECACHE_H
@@ -3,17 +3,29 @@
 
 #include <cmath>
 #include <cstdlib>
-
+#include "DistanceStatistics.h"
+#include <stdint.h>
+#include <vector>
+
+/**
+* Base of the distance functions.
+* distCount counts the distances computed through this object; it is not
+* synchronized, so share a DistanceFunction between threads only through
+* DistanceStatistics, which every update is also reported to.
+*/
 template <class ObjectType>
 class DistanceFunction{
 
     protected:
-        u_int32_t distCount;
+        uint64_t distCount;
+        // Evaluator type number reported to DistanceStatistics, 0 if unknown.
+        uint16_t metricType;
 
     public:
 
-        DistanceFunction(u_int32_t d = 0){
+        DistanceFunction(uint64_t d = 0){
             distCount = d;
+            metricType = 0;
         }
 
         virtual ~DistanceFunction(){
@@ -23,9 +35,48 @@ class DistanceFunction{
 
         virtual double getDistance(ObjectType & obj1, ObjectType & obj2) = 0;
 
+        virtual double GetBoundedDistance(ObjectType & obj1, ObjectType & obj2, double bound, const std::vector<uint32_t> *order = NULL){
+
+            return getBoundedDistance(obj1, obj2, bound, order);
+        }
+
+        virtual void GetDistances(ObjectType & query, ObjectType * const * candidates, size_t count, double * out){
+
+            getDistances(query, candidates, count, out);
+        }
+
+        /**
+        * Calculates the distances between a query and several candidates.
+        * @param candidates The candidates to be compared with the query.
+        * @param count The number of candidates.
+        * @param out Receives the count distances, in the candidates order.
+        */
+        virtual void getDistances(ObjectType & query, ObjectType * const * candidates, size_t count, double * out){
+
+            for (size_t x = 0; x < count; x++)
+                out[x] = getDistance(query, *candidates[x]);
+        }
+
+        /**
+        * Calculates the distance, but may stop as soon as it is known to be
+        * greater than bound. Metrics that cannot stop early compute the full
+        * distance.
+        * @param bound The largest distance the caller is interested in.
+        * @param order An optional visiting order of the dimensions, such as
+        * highest variance first. Only used by metrics that stop early.
+        * @return The exact distance if it is <= bound, otherwise any value
+        * greater than bound.
+        */
+        virtual double getBoundedDistance(ObjectType & obj1, ObjectType & obj2, double bound, const std::vector<uint32_t> *order = NULL){
+
+            (void) bound;
+            (void) order;
+            return getDistance(obj1, obj2);
+        }
+
         DistanceFunction& operator=(const DistanceFunction& evaluator){
 
-            distCount = evaluator.getDistanceCount();
+            distCount = evaluator.distCount;
             return *this;
         }
       
@@ -39,23 +90,24 @@ class DistanceFunction{
             distCount = 0;
         }
 
-        u_int32_t GetDistanceCount() {
+        uint64_t GetDistanceCount() {
 
             return getDistanceCount();
         }
 
-        u_int32_t getDistanceCount() {
+        uint64_t getDistanceCount() {
             return distCount;
         }
 
-        void UpdateDistanceCount(){
+        void UpdateDistanceCount(uint64_t n = 1){
 
-            updateDistanceCount();
+            updateDistanceCount(n);
         }
 
-        void updateDistanceCount(){
+        void updateDistanceCount(uint64_t n = 1){
 
-            distCount++;
+            distCount += n;
+            DistanceStatistics::count(metricType, n);
         }
 
    
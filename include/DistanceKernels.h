@@ -0,0 +1,1189 @@
+#ifndef DISTANCEKERNELS_H
+#define DISTANCEKERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// GCC and Clang vector extensions let each kernel below be written once and
+// compiled for several instruction sets. Other compilers only get the scalar
+// path. Define HERMES_NO_SIMD to force the scalar path everywhere.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(HERMES_NO_SIMD)
+#  define HERMES_VECTOR_EXTENSIONS 1
+#  if defined(__x86_64__) || defined(__i386__)
+#    define HERMES_X86_DISPATCH 1
+#  endif
+#endif
+
+#ifdef HERMES_X86_DISPATCH
+#  include <immintrin.h>
+#endif
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+/**
+* Vector types of W double lanes, and W float lanes to be widened.
+*/
+template <int W>
+struct SimdVector;
+
+typedef double SimdDouble2 __attribute__((vector_size(16)));
+typedef double SimdDouble4 __attribute__((vector_size(32)));
+typedef double SimdDouble8 __attribute__((vector_size(64)));
+typedef float SimdFloat2 __attribute__((vector_size(8)));
+typedef float SimdFloat4 __attribute__((vector_size(16)));
+typedef float SimdFloat8 __attribute__((vector_size(32)));
+
+template <> struct SimdVector<2>{ typedef SimdDouble2 Double; typedef SimdFloat2 Float; };
+template <> struct SimdVector<4>{ typedef SimdDouble4 Double; typedef SimdFloat4 Float; };
+template <> struct SimdVector<8>{ typedef SimdDouble8 Double; typedef SimdFloat8 Float; };
+
+typedef int64_t SimdInt2 __attribute__((vector_size(16)));
+typedef int64_t SimdInt4 __attribute__((vector_size(32)));
+typedef int64_t SimdInt8 __attribute__((vector_size(64)));
+#endif
+
+/**
+* Integer lanes with the same layout as a double vector (or plain double).
+*/
+template <class V>
+struct SimdBits;
+
+template <> struct SimdBits<double>{ typedef int64_t Type; };
+#ifdef HERMES_VECTOR_EXTENSIONS
+template <> struct SimdBits<SimdDouble2>{ typedef SimdInt2 Type; };
+template <> struct SimdBits<SimdDouble4>{ typedef SimdInt4 Type; };
+template <> struct SimdBits<SimdDouble8>{ typedef SimdInt8 Type; };
+#endif
+
+/**
+* Natural logarithm of positive finite values, for scalar doubles or vectors.
+* The exponent is read from the bit pattern and ln(m), m in [sqrt(2)/2, sqrt(2)),
+* comes from the series 2 atanh((m - 1) / (m + 1)) truncated after the s^11
+* term, which bounds the absolute error by 2e-11. Zero, negative and
+* subnormal inputs give meaningless results and must be masked by the caller.
+*/
+template <class V>
+static inline void simdFastLog(V &r, const V &x){
+
+    typedef typename SimdBits<V>::Type B;
+    B bits, eb, mb;
+    V e, m;
+
+    memcpy(&bits, &x, sizeof(V));
+    eb = ((bits >> 52) & 0x7ff) | 0x4330000000000000LL;
+    mb = (bits & 0x000fffffffffffffLL) | 0x3ff0000000000000LL;
+    memcpy(&e, &eb, sizeof(V));
+    memcpy(&m, &mb, sizeof(V));
+
+    // e holds 2^52 + biased exponent, m is in [1, 2).
+    e = e - (4503599627370496.0 + 1023.0);
+    V up = e + 1.0;
+    V half = m * 0.5;
+    e = (m > 1.4142135623730951) ? up : e;
+    m = (m > 1.4142135623730951) ? half : m;
+
+    V s = (m - 1.0) / (m + 1.0);
+    V s2 = s * s;
+    V p = ((((s2 * (1.0 / 11) + 1.0 / 9) * s2 + 1.0 / 7) * s2 + 1.0 / 5) * s2 + 1.0 / 3) * s2 + 1.0;
+    r = e * 0.6931471805599453 + 2.0 * s * p;
+}
+
+/**
+* Square root of every lane, for scalar doubles or vectors.
+*/
+static inline void simdSqrt(double &r, const double &x){
+
+    r = std::sqrt(x);
+}
+
+template <class V>
+static inline void simdSqrt(V &r, const V &x){
+
+#if defined(HERMES_X86_DISPATCH) && defined(__SSE2__)
+    // SSE2 is part of every x86-64 level, and its square root leaves errno
+    // alone, unlike std::sqrt.
+    double lanes[sizeof(V) / sizeof(double)];
+    memcpy(lanes, &x, sizeof(V));
+    for (size_t k = 0; k < sizeof(V) / sizeof(double); k += 2)
+        _mm_storeu_pd(lanes + k, _mm_sqrt_pd(_mm_loadu_pd(lanes + k)));
+    memcpy(&r, lanes, sizeof(V));
+#else
+    r = x;
+    for (size_t k = 0; k < sizeof(V) / sizeof(double); k++)
+        r[k] = std::sqrt(x[k]);
+#endif
+}
+
+/**
+* x^N by repeated squaring, for scalar doubles or vectors.
+*/
+template <int N, class V>
+static inline void simdPower(V &r, const V &x){
+
+    if constexpr (N == 1){
+        r = x;
+    } else if constexpr (N % 2 == 0){
+        V h;
+        simdPower<N / 2>(h, x);
+        r = h * h;
+    } else {
+        V h;
+        simdPower<N - 1>(h, x);
+        r = h * x;
+    }
+}
+
+/**
+* Lane helpers for a kernel processing W doubles at a time.
+* All helpers take and return vectors by reference, so that no vector crosses
+* a function boundary compiled for a narrower instruction set.
+*
+* @arg W The number of double lanes (1 means plain scalar code).
+*/
+template <int W>
+struct SimdLanes{
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+    typedef typename SimdVector<W>::Double Vec;
+    typedef typename SimdVector<W>::Float HalfVec;
+
+    static inline void zero(Vec &v){
+        v = Vec();
+    }
+
+    static inline void load(Vec &v, const double *p){
+        memcpy(&v, p, sizeof(Vec));
+    }
+
+    // Single precision inputs are widened to double before any arithmetic.
+    static inline void load(Vec &v, const float *p){
+        HalfVec f;
+        memcpy(&f, p, sizeof(HalfVec));
+        v = __builtin_convertvector(f, Vec);
+    }
+
+    // Other element types are widened one by one; going through an array
+    // rather than lane stores keeps GCC from taking v as uninitialized.
+    template <class T>
+    static inline void load(Vec &v, const T *p){
+        double lanes[W];
+        for (int k = 0; k < W; k++)
+            lanes[k] = (double) p[k];
+        memcpy(&v, lanes, sizeof(Vec));
+    }
+
+    // Loads n < W elements and zero-fills the remaining lanes.
+    template <class T>
+    static inline void loadPartial(Vec &v, const T *p, size_t n){
+        double lanes[W] = {};
+        for (size_t k = 0; k < n; k++)
+            lanes[k] = (double) p[k];
+        memcpy(&v, lanes, sizeof(Vec));
+    }
+
+    static inline void broadcast(Vec &v, double x){
+        v = Vec() + x;
+    }
+
+    static inline void store(double *p, const Vec &v){
+        memcpy(p, &v, sizeof(Vec));
+    }
+
+    static inline double sum(const Vec &v){
+        double s = 0.0;
+        for (int k = 0; k < W; k++)
+            s += v[k];
+        return s;
+    }
+
+    static inline double max(const Vec &v){
+        double m = v[0];
+        for (int k = 1; k < W; k++)
+            m = (v[k] > m) ? v[k] : m;
+        return m;
+    }
+#endif
+};
+
+/**
+* The portable scalar specialization.
+*/
+template <>
+struct SimdLanes<1>{
+
+    typedef double Vec;
+
+    static inline void zero(Vec &v){
+        v = 0.0;
+    }
+
+    template <class T>
+    static inline void load(Vec &v, const T *p){
+        v = (double) *p;
+    }
+
+    template <class T>
+    static inline void loadPartial(Vec &v, const T *p, size_t n){
+        v = (n > 0) ? (double) *p : 0.0;
+    }
+
+    static inline void broadcast(Vec &v, double x){
+        v = x;
+    }
+
+    static inline void store(double *p, const Vec &v){
+        *p = v;
+    }
+
+    static inline double sum(const Vec &v){
+        return v;
+    }
+
+    static inline double max(const Vec &v){
+        return v;
+    }
+};
+
+/**
+* Runtime-dispatched distance kernels over contiguous arrays.
+*
+* Every kernel is written once as a policy (see SquaredEuclideanKernel and its
+* siblings) and instantiated for the portable scalar path and, on x86, for
+* SSE2, AVX2+FMA and AVX-512F. The widest level supported by the running CPU is
+* detected the first time a kernel runs and reused from then on.
+*
+* Tolerance: the vector kernels add the per-dimension terms in a different
+* order than a sequential loop (and may contract to FMA), so sums (Euclidean,
+* Manhattan, Canberra) differ from the sequential result by at most about
+* n * 2^-52 relative, n being the number of dimensions. Chebyshev is exact.
+* Float inputs are widened to double before subtraction, so they are at least
+* as accurate as a loop subtracting in single precision.
+*/
+class DistanceKernels{
+
+    public:
+
+        enum Level{
+            SCALAR = 0,
+            SSE2 = 1,
+            AVX2 = 2,
+            AVX512 = 3
+        };
+
+        /**
+        * Probes the CPU for the widest supported instruction set.
+        * @return The best level this CPU and build can run.
+        */
+        static Level detectLevel(){
+
+#ifdef HERMES_X86_DISPATCH
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return AVX512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                return AVX2;
+            if (__builtin_cpu_supports("sse2"))
+                return SSE2;
+#endif
+            return SCALAR;
+        }
+
+        /**
+        * Gets the level used by the kernels.
+        * @return The current kernel level.
+        */
+        static Level level(){
+
+            return currentLevel();
+        }
+
+        /**
+        * Forces a kernel level, e.g. to compare implementations.
+        * Levels above detectLevel() are clamped. Not meant to be called while
+        * other threads are computing distances.
+        * @param l The level to be used.
+        */
+        static void setLevel(Level l){
+
+            Level best = detectLevel();
+            currentLevel() = (l > best) ? best : l;
+        }
+
+        /**
+        * Gets a printable name of a level.
+        * @param l The level.
+        * @return The level name.
+        */
+        static const char *levelName(Level l){
+
+            switch (l){
+                case SSE2: return "sse2";
+                case AVX2: return "avx2";
+                case AVX512: return "avx512";
+                default: return "scalar";
+            }
+        }
+
+        /**
+        * Reduces two arrays with the kernel policy K at the current level.
+        * @param a The first array.
+        * @param b The second array.
+        * @param n The number of elements of both arrays.
+        * @return The value produced by K::finish.
+        */
+        template <class K, class T>
+        static double compute(const T *a, const T *b, size_t n){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (level()){
+                case AVX512: return computeAvx512<K>(a, b, n);
+                case AVX2: return computeAvx2<K>(a, b, n);
+                case SSE2: return computeSse2<K>(a, b, n);
+                default: break;
+            }
+#endif
+            return reduce<K, 1>(a, b, n);
+        }
+
+        /**
+        * Reduces one query against many candidates with the kernel policy K,
+        * dispatching once for the whole batch.
+        * @param q The query array.
+        * @param c The candidate arrays, each with n elements.
+        * @param count The number of candidates.
+        * @param n The number of elements of every array.
+        * @param out Receives count values produced by K::finish.
+        */
+        template <class K, class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (level()){
+                case AVX512: computeBatchAvx512<K>(q, c, count, n, out); return;
+                case AVX2: computeBatchAvx2<K>(q, c, count, n, out); return;
+                case SSE2: computeBatchSse2<K>(q, c, count, n, out); return;
+                default: break;
+            }
+#endif
+            reduceBatch<K, 1>(q, c, count, n, out);
+        }
+
+        /**
+        * Computes a tile of dot products, c[i * ldc + j] = a[i] . b[j], as a
+        * blocked matrix multiply: b is packed into panels of columns and a
+        * register-blocked micro-kernel sweeps the rows of a over each panel.
+        * @param a The m row arrays, each with d elements.
+        * @param b The n column arrays, each with d elements.
+        * @param c Receives the m x n dot products (overwritten).
+        * @param ldc The row stride of c.
+        * @param panel Scratch space of DotPanelSize doubles.
+        */
+        template <class T>
+        static void computeDotTile(const T *const *a, size_t m, const T *const *b, size_t n, size_t d, double *c, size_t ldc, double *panel){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (level()){
+                case AVX512: dotTileAvx512(a, m, b, n, d, c, ldc, panel); return;
+                case AVX2: dotTileAvx2(a, m, b, n, d, c, ldc, panel); return;
+                case SSE2: dotTileSse2(a, m, b, n, d, c, ldc, panel); return;
+                default: break;
+            }
+#endif
+            dotTile<1>(a, m, b, n, d, c, ldc, panel);
+        }
+
+        /**
+        * The dot product tile driver for W lanes. The micro-kernel keeps a
+        * DotRows x (2 W) block of c in registers while streaming a block of
+        * DotDepth dimensions.
+        */
+        template <int W, class T>
+        static inline void dotTile(const T *const *a, size_t m, const T *const *b, size_t n, size_t d, double *c, size_t ldc, double *panel){
+
+            typedef SimdLanes<W> L;
+            const size_t nr = 2 * W;
+
+            if (d == 0){
+                for (size_t i = 0; i < m; i++)
+                    std::fill(c + i * ldc, c + i * ldc + n, 0.0);
+                return;
+            }
+
+            for (size_t j0 = 0; j0 < n; j0 += nr){
+                size_t nj = (n - j0 < nr) ? n - j0 : nr;
+                for (size_t k0 = 0; k0 < d; k0 += DotDepth){
+                    size_t kc = (d - k0 < DotDepth) ? d - k0 : DotDepth;
+
+                    // Packs the columns k-major, zero-filling a partial panel.
+                    for (size_t k = 0; k < kc; k++)
+                        for (size_t x = 0; x < nr; x++)
+                            panel[k * nr + x] = (x < nj) ? (double) b[j0 + x][k0 + k] : 0.0;
+
+                    for (size_t i0 = 0; i0 < m; i0 += DotRows){
+                        size_t mi = (m - i0 < DotRows) ? m - i0 : DotRows;
+                        const T *r0 = a[i0] + k0;
+                        const T *r1 = a[i0 + ((mi > 1) ? 1 : 0)] + k0;
+                        const T *r2 = a[i0 + ((mi > 2) ? 2 : 0)] + k0;
+                        const T *r3 = a[i0 + ((mi > 3) ? 3 : 0)] + k0;
+
+                        typename L::Vec c00, c01, c10, c11, c20, c21, c30, c31, b0, b1, va;
+                        L::zero(c00); L::zero(c01); L::zero(c10); L::zero(c11);
+                        L::zero(c20); L::zero(c21); L::zero(c30); L::zero(c31);
+                        for (size_t k = 0; k < kc; k++){
+                            L::load(b0, panel + k * nr);
+                            L::load(b1, panel + k * nr + W);
+                            L::broadcast(va, (double) r0[k]);
+                            c00 += va * b0; c01 += va * b1;
+                            L::broadcast(va, (double) r1[k]);
+                            c10 += va * b0; c11 += va * b1;
+                            L::broadcast(va, (double) r2[k]);
+                            c20 += va * b0; c21 += va * b1;
+                            L::broadcast(va, (double) r3[k]);
+                            c30 += va * b0; c31 += va * b1;
+                        }
+
+                        double block[DotRows * 2 * MaxLanes];
+                        L::store(block, c00); L::store(block + W, c01);
+                        L::store(block + nr, c10); L::store(block + nr + W, c11);
+                        L::store(block + 2 * nr, c20); L::store(block + 2 * nr + W, c21);
+                        L::store(block + 3 * nr, c30); L::store(block + 3 * nr + W, c31);
+                        for (size_t i = 0; i < mi; i++){
+                            double *row = c + (i0 + i) * ldc + j0;
+                            for (size_t x = 0; x < nj; x++)
+                                row[x] = (k0 == 0) ? block[i * nr + x] : row[x] + block[i * nr + x];
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+        * Runs Metric::computeBatch() over feature vector objects, which must
+        * all hold n elements, gathering their storage in chunks.
+        * @param q The query array.
+        * @param objects The candidate objects.
+        */
+        template <class Metric, class T, class ObjectType>
+        static void computeObjectBatch(const T *q, ObjectType *const *objects, size_t count, size_t n, double *out){
+
+            const T *chunk[BatchChunk];
+            for (size_t j = 0; j < count; j += BatchChunk){
+                size_t len = (count - j < BatchChunk) ? count - j : BatchChunk;
+                for (size_t x = 0; x < len; x++)
+                    chunk[x] = objects[j + x]->getRawData();
+                Metric::computeBatch(q, chunk, len, n, out + j);
+            }
+        }
+
+        /**
+        * Early-abandoning version of compute() for sum or max kernels whose
+        * finish() returns the accumulator. The reduction is checked against
+        * the limit after every block of dimensions and stops once it is
+        * exceeded. When an order is given, dimensions are visited in that
+        * order instead (e.g. highest variance first) one at a time.
+        * @param limit The accumulator value above which the caller does not
+        * care about the exact result.
+        * @param order A permutation of [0, n) or NULL; it is not checked
+        * here (see checkPermutation()).
+        * @return The exact reduction if it is <= limit, otherwise a partial
+        * reduction that is already > limit.
+        */
+        template <class K, class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double limit, const uint32_t *order = NULL){
+
+            if (order == NULL){
+                double acc = 0.0;
+                for (size_t i = 0; i < n; i += BoundedBlock){
+                    double part = compute<K>(a + i, b + i, (n - i < BoundedBlock) ? n - i : BoundedBlock);
+                    acc = K::MaxReduction ? std::max(acc, part) : acc + part;
+                    if (acc > limit)
+                        return acc;
+                }
+                return acc;
+            }
+
+            double s = 0.0, t = 0.0;
+            for (size_t i = 0; i < n; i++){
+                K::step(s, t, (double) a[order[i]], (double) b[order[i]]);
+                if ((i & (OrderedCheck - 1)) == OrderedCheck - 1 && s > limit)
+                    return s;
+            }
+            return K::finish(s, t);
+        }
+
+        /**
+        * Checks that a dimension order is a permutation of [0, size), as
+        * computeBounded() requires. Call it once, when the order is set.
+        * @param order The order.
+        * @throw std::invalid_argument If an index is out of range or repeated.
+        */
+        static void checkPermutation(const std::vector<uint32_t> &order){
+
+            std::vector<bool> seen(order.size(), false);
+            for (size_t i = 0; i < order.size(); i++){
+                if ((order[i] >= order.size()) || seen[order[i]])
+                    throw std::invalid_argument("The dimension order is not a permutation of the dimensions.");
+                seen[order[i]] = true;
+            }
+        }
+
+        /**
+        * Portable implementation of compute(), whatever the level is.
+        */
+        template <class K, class T>
+        static double computeScalar(const T *a, const T *b, size_t n){
+
+            return reduce<K, 1>(a, b, n);
+        }
+
+        /**
+        * The generic kernel driver. Runs K over W lanes with two independent
+        * accumulators to hide latency, and zero-pads the tail. Every policy
+        * must map a pair of zeros to a neutral contribution.
+        */
+        template <class K, int W, class T>
+        static inline double reduce(const T *a, const T *b, size_t n){
+
+            typedef SimdLanes<W> L;
+            typename L::Vec s0, t0, s1, t1, va, vb;
+            L::zero(s0); L::zero(t0); L::zero(s1); L::zero(t1);
+
+            size_t i = 0;
+            for (; i + 2 * W <= n; i += 2 * W){
+                L::load(va, a + i);
+                L::load(vb, b + i);
+                K::step(s0, t0, va, vb);
+                L::load(va, a + i + W);
+                L::load(vb, b + i + W);
+                K::step(s1, t1, va, vb);
+            }
+            if (i + W <= n){
+                L::load(va, a + i);
+                L::load(vb, b + i);
+                K::step(s0, t0, va, vb);
+                i += W;
+            }
+            if (i < n){
+                L::loadPartial(va, a + i, n - i);
+                L::loadPartial(vb, b + i, n - i);
+                K::step(s0, t0, va, vb);
+            }
+
+            if (K::MaxReduction){
+                s0 = (s1 > s0) ? s1 : s0;
+            } else {
+                s0 += s1;
+                t0 += t1;
+            }
+            return finishLanes<K, W>(s0, t0);
+        }
+
+        /**
+        * The batch kernel driver. Runs K over four candidates at a time, so
+        * that each group of query lanes is loaded once and stays in a
+        * register for all four.
+        */
+        template <class K, int W, class T>
+        static inline void reduceBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+            typedef SimdLanes<W> L;
+            size_t lines = (n * sizeof(T) + 63) / 64;
+            lines = (lines > PrefetchLines) ? PrefetchLines : lines;
+            size_t j = 0;
+            for (; j + 4 <= count; j += 4){
+                // Start loading the next group while this one is reduced; the
+                // hardware prefetcher follows the rest of each row.
+                for (size_t x = j + 4; (x < j + 8) && (x < count); x++)
+                    for (size_t l = 0; l < lines; l++)
+                        prefetch((const char *) c[x] + 64 * l);
+
+                typename L::Vec s0, t0, s1, t1, s2, t2, s3, t3, vq, vc;
+                L::zero(s0); L::zero(t0); L::zero(s1); L::zero(t1);
+                L::zero(s2); L::zero(t2); L::zero(s3); L::zero(t3);
+                const T *c0 = c[j], *c1 = c[j + 1], *c2 = c[j + 2], *c3 = c[j + 3];
+
+                size_t i = 0;
+                for (; i + W <= n; i += W){
+                    L::load(vq, q + i);
+                    L::load(vc, c0 + i);
+                    K::step(s0, t0, vq, vc);
+                    L::load(vc, c1 + i);
+                    K::step(s1, t1, vq, vc);
+                    L::load(vc, c2 + i);
+                    K::step(s2, t2, vq, vc);
+                    L::load(vc, c3 + i);
+                    K::step(s3, t3, vq, vc);
+                }
+                if (i < n){
+                    L::loadPartial(vq, q + i, n - i);
+                    L::loadPartial(vc, c0 + i, n - i);
+                    K::step(s0, t0, vq, vc);
+                    L::loadPartial(vc, c1 + i, n - i);
+                    K::step(s1, t1, vq, vc);
+                    L::loadPartial(vc, c2 + i, n - i);
+                    K::step(s2, t2, vq, vc);
+                    L::loadPartial(vc, c3 + i, n - i);
+                    K::step(s3, t3, vq, vc);
+                }
+
+                out[j] = finishLanes<K, W>(s0, t0);
+                out[j + 1] = finishLanes<K, W>(s1, t1);
+                out[j + 2] = finishLanes<K, W>(s2, t2);
+                out[j + 3] = finishLanes<K, W>(s3, t3);
+            }
+            for (; j < count; j++)
+                out[j] = reduce<K, W>(q, c[j], n);
+        }
+
+        /**
+        * Squared Euclidean distance (the caller takes the root).
+        */
+        template <class T>
+        static double squaredEuclidean(const T *a, const T *b, size_t n);
+
+        /**
+        * Manhattan (L1) distance.
+        */
+        template <class T>
+        static double manhattan(const T *a, const T *b, size_t n);
+
+        /**
+        * Chebyshev (L-infinity) distance.
+        */
+        template <class T>
+        static double chebyshev(const T *a, const T *b, size_t n);
+
+        /**
+        * Canberra distance. Dimensions where both values are zero add zero.
+        */
+        template <class T>
+        static double canberra(const T *a, const T *b, size_t n);
+
+        /**
+        * Dot product.
+        */
+        template <class T>
+        static double dotProduct(const T *a, const T *b, size_t n);
+
+        /**
+        * Counts the bits set in a XOR b: the Hamming distance of two
+        * bit-packed vectors. Uses AVX-512 VPOPCNTDQ at the AVX512 level when
+        * the CPU has it, nibble lookups with vpshufb at the AVX2 level, and
+        * the popcnt instruction otherwise.
+        * @param n The number of 64-bit words of both arrays.
+        */
+        static uint64_t hamming(const uint64_t *a, const uint64_t *b, size_t n){
+
+#ifdef HERMES_X86_DISPATCH
+            static const bool popcnt = __builtin_cpu_supports("popcnt");
+            static const bool vpopcnt = __builtin_cpu_supports("avx512vpopcntdq");
+            Level l = level();
+            if ((l == AVX512) && vpopcnt)
+                return hammingAvx512(a, b, n);
+            if ((l >= AVX2) && (n >= LookupPopcountWords))
+                return hammingAvx2(a, b, n);
+            if ((l >= SSE2) && popcnt)
+                return hammingPopcnt(a, b, n);
+#endif
+            return hammingWords(a, b, n);
+        }
+
+        /**
+        * Hints the CPU to load the cache line holding p.
+        */
+        static inline void prefetch(const void *p){
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+            __builtin_prefetch(p, 0, 3);
+#else
+            (void) p;
+#endif
+        }
+
+        static inline uint64_t popcount(uint64_t x){
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+            return __builtin_popcountll(x);
+#else
+            x = x - ((x >> 1) & 0x5555555555555555ULL);
+            x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+            x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+            return (x * 0x0101010101010101ULL) >> 56;
+#endif
+        }
+
+        // Scratch space required by computeDotTile().
+        static const size_t MaxLanes = 8;
+        static const size_t DotRows = 4;
+        static const size_t DotDepth = 256;
+        static const size_t DotPanelSize = DotDepth * 2 * MaxLanes;
+
+    private:
+
+        template <class K, int W>
+        static inline double finishLanes(const typename SimdLanes<W>::Vec &s, const typename SimdLanes<W>::Vec &t){
+
+            if (K::MaxReduction)
+                return K::finish(SimdLanes<W>::max(s), 0.0);
+            return K::finish(SimdLanes<W>::sum(s), SimdLanes<W>::sum(t));
+        }
+
+        // Dimensions reduced between two checks of computeBounded().
+        static const size_t BoundedBlock = 64;
+        static const size_t OrderedCheck = 8;
+        // Candidates gathered per computeBatch() call by computeObjectBatch().
+        static const size_t BatchChunk = 64;
+        // Cache lines of each upcoming candidate prefetched by reduceBatch().
+        static const size_t PrefetchLines = 8;
+
+        // Below this many words, popcnt beats the nibble lookups.
+        static const size_t LookupPopcountWords = 16;
+
+        static inline uint64_t hammingWords(const uint64_t *a, const uint64_t *b, size_t n){
+
+            uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4){
+                c0 += popcount(a[i] ^ b[i]);
+                c1 += popcount(a[i + 1] ^ b[i + 1]);
+                c2 += popcount(a[i + 2] ^ b[i + 2]);
+                c3 += popcount(a[i + 3] ^ b[i + 3]);
+            }
+            for (; i < n; i++)
+                c0 += popcount(a[i] ^ b[i]);
+            return c0 + c1 + c2 + c3;
+        }
+
+        static Level &currentLevel(){
+
+            static Level l = detectLevel();
+            return l;
+        }
+
+#ifdef HERMES_X86_DISPATCH
+        template <class K, class T>
+        __attribute__((target("sse2"), flatten))
+        static double computeSse2(const T *a, const T *b, size_t n){
+            return reduce<K, 2>(a, b, n);
+        }
+
+        template <class K, class T>
+        __attribute__((target("avx2,fma"), flatten))
+        static double computeAvx2(const T *a, const T *b, size_t n){
+            return reduce<K, 4>(a, b, n);
+        }
+
+        template <class K, class T>
+        __attribute__((target("avx512f"), flatten))
+        static double computeAvx512(const T *a, const T *b, size_t n){
+            return reduce<K, 8>(a, b, n);
+        }
+
+        template <class T>
+        __attribute__((target("sse2"), flatten))
+        static void dotTileSse2(const T *const *a, size_t m, const T *const *b, size_t n, size_t d, double *c, size_t ldc, double *panel){
+            dotTile<2>(a, m, b, n, d, c, ldc, panel);
+        }
+
+        template <class T>
+        __attribute__((target("avx2,fma"), flatten))
+        static void dotTileAvx2(const T *const *a, size_t m, const T *const *b, size_t n, size_t d, double *c, size_t ldc, double *panel){
+            dotTile<4>(a, m, b, n, d, c, ldc, panel);
+        }
+
+        template <class T>
+        __attribute__((target("avx512f"), flatten))
+        static void dotTileAvx512(const T *const *a, size_t m, const T *const *b, size_t n, size_t d, double *c, size_t ldc, double *panel){
+            dotTile<8>(a, m, b, n, d, c, ldc, panel);
+        }
+
+        __attribute__((target("popcnt"), flatten))
+        static uint64_t hammingPopcnt(const uint64_t *a, const uint64_t *b, size_t n){
+            return hammingWords(a, b, n);
+        }
+
+        // Counts the bits of each nibble with a 16-entry table, and adds the
+        // bytes of each 64-bit lane with vpsadbw.
+        __attribute__((target("avx2")))
+        static uint64_t hammingAvx2(const uint64_t *a, const uint64_t *b, size_t n){
+            const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                   0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            const __m256i nibble = _mm256_set1_epi8(0x0f);
+            __m256i total = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4){
+                __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (a + i)), _mm256_loadu_si256((const __m256i *) (b + i)));
+                __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(x, nibble));
+                __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+                total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+            }
+            uint64_t lanes[4];
+            _mm256_storeu_si256((__m256i *) lanes, total);
+            uint64_t count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            for (; i < n; i++)
+                count += popcount(a[i] ^ b[i]);
+            return count;
+        }
+
+        __attribute__((target("avx512f,avx512vpopcntdq")))
+        static uint64_t hammingAvx512(const uint64_t *a, const uint64_t *b, size_t n){
+            __m512i total = _mm512_setzero_si512();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8){
+                __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+                total = _mm512_add_epi64(total, _mm512_popcnt_epi64(x));
+            }
+            if (i < n){
+                __mmask8 m = (__mmask8) ((1u << (n - i)) - 1);
+                __m512i x = _mm512_xor_si512(_mm512_maskz_loadu_epi64(m, a + i), _mm512_maskz_loadu_epi64(m, b + i));
+                total = _mm512_add_epi64(total, _mm512_popcnt_epi64(x));
+            }
+            uint64_t lanes[8];
+            _mm512_storeu_si512(lanes, total);
+            return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+        }
+
+        template <class K, class T>
+        __attribute__((target("sse2"), flatten))
+        static void computeBatchSse2(const T *q, const T *const *c, size_t count, size_t n, double *out){
+            reduceBatch<K, 2>(q, c, count, n, out);
+        }
+
+        template <class K, class T>
+        __attribute__((target("avx2,fma"), flatten))
+        static void computeBatchAvx2(const T *q, const T *const *c, size_t count, size_t n, double *out){
+            reduceBatch<K, 4>(q, c, count, n, out);
+        }
+
+        template <class K, class T>
+        __attribute__((target("avx512f"), flatten))
+        static void computeBatchAvx512(const T *q, const T *const *c, size_t count, size_t n, double *out){
+            reduceBatch<K, 8>(q, c, count, n, out);
+        }
+#endif
+};
+
+/**
+* Kernel policies. step() folds one group of lanes into the accumulators s and
+* t, and finish() turns the reduced accumulators into the distance. The same
+* code serves scalar doubles and vectors.
+*/
+struct SquaredEuclideanKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V d = a - b;
+        s += d * d;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+struct DotProductKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        s += a * b;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+struct ManhattanKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V d = a - b;
+        s += (d < 0.0) ? -d : d;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+struct ChebyshevKernel{
+
+    static const bool MaxReduction = true;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V d = a - b;
+        d = (d < 0.0) ? -d : d;
+        s = (d > s) ? d : s;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+/**
+* Minkowski distance of order p = PNum / PDen, without the final root:
+* sum |a - b|^p. Integer orders take repeated multiplications, halves and
+* quarters one or two square roots first; there is no pow() call per
+* dimension.
+*/
+template <int PNum, int PDen = 1>
+struct MinkowskiKernel{
+
+    static_assert((PNum > 0) && ((PDen == 1) || (PDen == 2) || (PDen == 4)),
+                  "The order must be a positive multiple of 1/4 with denominator 1, 2 or 4.");
+
+    static const bool MaxReduction = false;
+
+    // |d|^p of every lane of d >= 0.
+    template <class V>
+    static inline void power(V &r, const V &d){
+        if constexpr (PDen == 1){
+            simdPower<PNum>(r, d);
+        } else {
+            V root;
+            simdSqrt(root, d);
+            if constexpr (PDen == 4)
+                simdSqrt(root, root);
+            simdPower<PNum>(r, root);
+        }
+    }
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V d = a - b;
+        d = (d < 0.0) ? -d : d;
+        V t;
+        power(t, d);
+        s += t;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+struct CanberraKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V d = a - b;
+        V den = ((a < 0.0) ? -a : a) + ((b < 0.0) ? -b : b);
+        den = (den == 0.0) ? den + 1.0 : den;
+        s += ((d < 0.0) ? -d : d) / den;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+/**
+* Bray-Curtis: sum |a - b| over sum |a + b|, with one division per pair.
+*/
+struct BrayCurtisKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &t, const V &a, const V &b){
+        V d = a - b;
+        V m = a + b;
+        s += (d < 0.0) ? -d : d;
+        t += (m < 0.0) ? -m : m;
+    }
+
+    static inline double finish(double s, double t){
+        return (t == 0.0) ? 0.0 : s / t;
+    }
+};
+
+/**
+* Chi-square: sum (a - b)^2 / (a + b), dividing a whole vector of dimensions
+* at once. Values must be non-negative, as in ChiSquareDistance: then a + b is
+* zero only when both are, and those dimensions add zero.
+*/
+struct ChiSquareKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V d = a - b;
+        V den = a + b;
+        den = (den == 0.0) ? den + 1.0 : den;
+        s += (d * d) / den;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+/**
+* Jeffrey divergence of histograms: sum a ln(2a / (a + b)) + b ln(2b / (a + b)),
+* evaluated as x ln x terms with simdFastLog(). Non-positive bins add nothing.
+*/
+struct JeffreyKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V m = (a + b) * 0.5;
+        V la, lb, lm;
+        simdFastLog(la, a);
+        simdFastLog(lb, b);
+        simdFastLog(lm, m);
+        V ta = a * la;
+        V tb = b * lb;
+        V tm = m * lm;
+        V zero = a * 0.0;
+        ta = (a > 0.0) ? ta : zero;
+        tb = (b > 0.0) ? tb : zero;
+        tm = (m > 0.0) ? tm : zero;
+        s += ta + tb - 2.0 * tm;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+/**
+* The pair term of the Jeffrey divergence when the x ln x sums of both
+* vectors are known (see VectorAuxiliaries): sum m ln m, m = (a + b) / 2.
+* Non-positive bins add nothing, as in JeffreyKernel.
+*/
+struct MeanXLogXKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V m = (a + b) * 0.5;
+        V lm;
+        simdFastLog(lm, m);
+        V zero = a * 0.0;
+        s += (m > 0.0) ? m * lm : zero;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+/**
+* Per-vector kernels of VectorAuxiliaries. They read a only; b is ignored.
+*/
+struct AbsSumKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &){
+        s += (a < 0.0) ? -a : a;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+// The largest -a, or 0: positive when some element is negative.
+struct NegativeKernel{
+
+    static const bool MaxReduction = true;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &){
+        V n = -a;
+        s = (n > s) ? n : s;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+// The x ln x sum of the Jeffrey divergence, with the same masking.
+struct XLogXKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &){
+        V la;
+        simdFastLog(la, a);
+        V zero = a * 0.0;
+        s += (a > 0.0) ? a * la : zero;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+/**
+* Hamming distance of unpacked vectors: the number of positions that differ.
+* See DistanceKernels::hamming() for bit-packed vectors.
+*/
+struct HammingKernel{
+
+    static const bool MaxReduction = false;
+
+    template <class V>
+    static inline void step(V &s, V &, const V &a, const V &b){
+        V zero = a * 0.0;
+        s += (a != b) ? zero + 1.0 : zero;
+    }
+
+    static inline double finish(double s, double){
+        return s;
+    }
+};
+
+template <class T>
+double DistanceKernels::dotProduct(const T *a, const T *b, size_t n){
+
+    return compute<DotProductKernel>(a, b, n);
+}
+
+template <class T>
+double DistanceKernels::squaredEuclidean(const T *a, const T *b, size_t n){
+
+    return compute<SquaredEuclideanKernel>(a, b, n);
+}
+
+template <class T>
+double DistanceKernels::manhattan(const T *a, const T *b, size_t n){
+
+    return compute<ManhattanKernel>(a, b, n);
+}
+
+template <class T>
+double DistanceKernels::chebyshev(const T *a, const T *b, size_t n){
+
+    return compute<ChebyshevKernel>(a, b, n);
+}
+
+template <class T>
+double DistanceKernels::canberra(const T *a, const T *b, size_t n){
+
+    return compute<CanberraKernel>(a, b, n);
+}
+
+#endif // DISTANCEKERNELS_H
@@ -0,0 +1,491 @@
+#ifndef DISTANCESTATISTICS_H
+#define DISTANCESTATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+* Process-wide instrumentation of distance computations.
+*
+* Counts are kept per metric in per-thread shards: each thread only writes its
+* own shard (plain loads and stores, no locked instructions), and snapshot()
+* adds all the shards up. Counts of finished threads are folded into a retired
+* shard, so nothing is lost. Optionally, one call out of every N is timed and
+* recorded in a per-metric log2 latency histogram.
+*
+* Counts are on by default, timing is off. setEnabled(false) reduces every hook
+* to one relaxed load and a branch; building with HERMES_NO_INSTRUMENTATION
+* removes the hooks altogether.
+*
+* Lookups of a DistanceCache are counted the same way, as hits and misses
+* per metric; hits are not counted as distance computations.
+*
+* Metrics are identified by the Evaluator type numbers (1 = Euclidean, ...).
+*/
+class DistanceStatistics{
+
+    public:
+
+        static const uint16_t MaxMetrics = 32;
+        static const uint16_t HistogramBuckets = 48;
+
+        /**
+        * Per-query counters. Bind one to the threads working on a query with
+        * a QueryScope; every distance computed by those threads while the
+        * scope is alive is added to it.
+        */
+        struct QueryCounters{
+
+            std::string name;
+            std::atomic<uint64_t> counts[MaxMetrics];
+
+            QueryCounters(const std::string &name = ""){
+                this->name = name;
+                reset();
+            }
+
+            void reset(){
+                for (uint16_t m = 0; m < MaxMetrics; m++)
+                    counts[m].store(0, std::memory_order_relaxed);
+            }
+
+            uint64_t getCount(uint16_t metric) const{
+                return counts[slot(metric)].load(std::memory_order_relaxed);
+            }
+
+            uint64_t getTotal() const{
+                uint64_t total = 0;
+                for (uint16_t m = 0; m < MaxMetrics; m++)
+                    total += counts[m].load(std::memory_order_relaxed);
+                return total;
+            }
+        };
+
+        /**
+        * Attributes the distances computed by the current thread to a query
+        * until destroyed. Scopes nest.
+        */
+        class QueryScope{
+
+            private:
+                QueryCounters *previous;
+
+            public:
+                QueryScope(QueryCounters &counters){
+                    previous = currentQuery();
+                    currentQuery() = &counters;
+                }
+
+                ~QueryScope(){
+                    currentQuery() = previous;
+                }
+        };
+
+        /**
+        * A consistent-enough copy of all the counters.
+        */
+        struct Snapshot{
+
+            uint64_t counts[MaxMetrics];
+            uint64_t samples[MaxMetrics];
+            uint64_t sampledNanos[MaxMetrics];
+            uint64_t histogram[MaxMetrics][HistogramBuckets];
+            uint64_t cacheHits[MaxMetrics];
+            uint64_t cacheMisses[MaxMetrics];
+
+            Snapshot(){
+                for (uint16_t m = 0; m < MaxMetrics; m++){
+                    counts[m] = samples[m] = sampledNanos[m] = 0;
+                    cacheHits[m] = cacheMisses[m] = 0;
+                    for (uint16_t b = 0; b < HistogramBuckets; b++)
+                        histogram[m][b] = 0;
+                }
+            }
+
+            uint64_t getTotal() const{
+                uint64_t total = 0;
+                for (uint16_t m = 0; m < MaxMetrics; m++)
+                    total += counts[m];
+                return total;
+            }
+
+            uint64_t getCacheHits(uint16_t metric) const{
+                return cacheHits[slot(metric)];
+            }
+
+            uint64_t getCacheMisses(uint16_t metric) const{
+                return cacheMisses[slot(metric)];
+            }
+
+            /**
+            * Gets the mean sampled latency of one distance.
+            * @return The latency in nanoseconds, 0 if nothing was sampled.
+            */
+            double getMeanLatency(uint16_t metric) const{
+                uint16_t m = slot(metric);
+                return (samples[m] == 0) ? 0.0 : (double) sampledNanos[m] / samples[m];
+            }
+
+            /**
+            * Gets an upper bound of a latency percentile from the histogram.
+            * @param q The percentile, in [0, 1].
+            * @return The upper edge of the bucket holding it, in nanoseconds.
+            */
+            uint64_t getLatencyPercentile(uint16_t metric, double q) const{
+                uint16_t m = slot(metric);
+                uint64_t rank = (uint64_t) (q * samples[m]), seen = 0;
+                for (uint16_t b = 0; b < HistogramBuckets; b++){
+                    seen += histogram[m][b];
+                    if ((seen > rank) && (seen > 0))
+                        return (b == 0) ? 0 : ((uint64_t) 1 << b);
+                }
+                return 0;
+            }
+
+            /**
+            * Writes the non-empty metrics as a JSON object.
+            */
+            void exportJson(std::ostream &out) const{
+                out << "{\"total\":" << getTotal() << ",\"metrics\":[";
+                bool first = true;
+                for (uint16_t m = 0; m < MaxMetrics; m++){
+                    if ((counts[m] == 0) && (samples[m] == 0) && (cacheHits[m] == 0) && (cacheMisses[m] == 0))
+                        continue;
+                    out << (first ? "" : ",") << "{\"type\":" << m << ",\"name\":\"" << metricName(m)
+                        << "\",\"count\":" << counts[m] << ",\"cacheHits\":" << cacheHits[m]
+                        << ",\"cacheMisses\":" << cacheMisses[m] << ",\"samples\":" << samples[m]
+                        << ",\"meanNs\":" << getMeanLatency(m)
+                        << ",\"p50Ns\":" << getLatencyPercentile(m, 0.5)
+                        << ",\"p99Ns\":" << getLatencyPercentile(m, 0.99) << ",\"histogram\":[";
+                    for (uint16_t b = 0; b < HistogramBuckets; b++)
+                        out << (b ? "," : "") << histogram[m][b];
+                    out << "]}";
+                    first = false;
+                }
+                out << "]}";
+            }
+        };
+
+        /**
+        * Times a sampled distance call and records it on destruction.
+        */
+        class Timer{
+
+            private:
+                uint16_t metric;
+                uint64_t n;
+                bool active;
+                std::chrono::steady_clock::time_point start;
+
+            public:
+                Timer(uint16_t metric, uint64_t n = 1){
+#ifndef HERMES_NO_INSTRUMENTATION
+                    active = shouldSample();
+                    if (active){
+                        this->metric = metric;
+                        this->n = n;
+                        start = std::chrono::steady_clock::now();
+                    }
+#else
+                    (void) metric;
+                    (void) n;
+                    active = false;
+#endif
+                }
+
+                ~Timer(){
+                    if (active){
+                        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+                        record(metric, (uint64_t) elapsed.count(), n);
+                    }
+                }
+        };
+
+        static bool isEnabled(){
+
+            return enabledFlag().load(std::memory_order_relaxed);
+        }
+
+        /**
+        * Turns the counting hooks on or off.
+        */
+        static void setEnabled(bool enabled){
+
+            enabledFlag().store(enabled, std::memory_order_relaxed);
+        }
+
+        /**
+        * Times one call out of every n, per thread.
+        * @param n The sampling period, 0 to disable timing.
+        */
+        static void setSampling(uint32_t n){
+
+            samplingPeriod().store(n, std::memory_order_relaxed);
+        }
+
+        static uint32_t getSampling(){
+
+            return samplingPeriod().load(std::memory_order_relaxed);
+        }
+
+        /**
+        * Gets the query the distances of the current thread are attributed
+        * to, NULL if none. Worker threads of a query open a QueryScope on it.
+        */
+        static QueryCounters *getCurrentQuery(){
+
+            return currentQuery();
+        }
+
+        /**
+        * Accounts n distance computations of a metric. The hot path.
+        */
+        static inline void count(uint16_t metric, uint64_t n = 1){
+
+#ifndef HERMES_NO_INSTRUMENTATION
+            if (!isEnabled())
+                return;
+            std::atomic<uint64_t> &c = shard().counts[slot(metric)];
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            QueryCounters *query = currentQuery();
+            if (query != NULL)
+                query->counts[slot(metric)].fetch_add(n, std::memory_order_relaxed);
+#else
+            (void) metric;
+            (void) n;
+#endif
+        }
+
+        /**
+        * Accounts a DistanceCache lookup of a metric.
+        * @param hit Whether the distance was found in the cache.
+        */
+        static inline void countCache(uint16_t metric, bool hit){
+
+#ifndef HERMES_NO_INSTRUMENTATION
+            if (!isEnabled())
+                return;
+            Shard &s = shard();
+            bump(hit ? s.cacheHits[slot(metric)] : s.cacheMisses[slot(metric)], 1);
+#else
+            (void) metric;
+            (void) hit;
+#endif
+        }
+
+        /**
+        * Adds up every thread's counters.
+        */
+        static Snapshot snapshot(){
+
+            Snapshot s;
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            add(s, r.retired);
+            for (size_t x = 0; x < r.shards.size(); x++)
+                add(s, *r.shards[x]);
+            subtract(s, r.baseline);
+            return s;
+        }
+
+        /**
+        * Zeroes the counters seen by snapshot(). Only their owner threads
+        * write the shards, so the counts so far are kept as a baseline that
+        * snapshot() subtracts, rather than cleared under the writers.
+        */
+        static void reset(){
+
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.baseline = Snapshot();
+            add(r.baseline, r.retired);
+            for (size_t x = 0; x < r.shards.size(); x++)
+                add(r.baseline, *r.shards[x]);
+        }
+
+        /**
+        * Gets a printable name of an Evaluator type number.
+        */
+        static const char *metricName(uint16_t metric){
+
+            static const char *names[] = {"other", "euclidean", "cityblock", "chebyshev", "jeffrey",
+                                          "canberra", "braycurtis", "chisquare", "hamming", "cosine", "dotproduct",
+                                          "minkowski"};
+            return (metric < sizeof(names) / sizeof(names[0])) ? names[metric] : "other";
+        }
+
+    private:
+
+        struct Shard{
+            std::atomic<uint64_t> counts[MaxMetrics];
+            std::atomic<uint64_t> samples[MaxMetrics];
+            std::atomic<uint64_t> sampledNanos[MaxMetrics];
+            std::atomic<uint64_t> histogram[MaxMetrics][HistogramBuckets];
+            std::atomic<uint64_t> cacheHits[MaxMetrics];
+            std::atomic<uint64_t> cacheMisses[MaxMetrics];
+            uint32_t tick;
+
+            Shard(){
+                clear(*this);
+                tick = 0;
+            }
+        };
+
+        struct Registry{
+            std::mutex mutex;
+            std::vector<Shard *> shards;
+            Shard retired;
+            // The counts at the last reset().
+            Snapshot baseline;
+        };
+
+        // Registers the calling thread's shard, and folds it into the retired
+        // one when the thread exits.
+        struct ShardOwner{
+            Shard *shard;
+
+            ShardOwner(){
+                shard = new Shard();
+                Registry &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.shards.push_back(shard);
+            }
+
+            ~ShardOwner(){
+                Registry &r = registry();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                for (size_t x = 0; x < r.shards.size(); x++){
+                    if (r.shards[x] == shard){
+                        r.shards.erase(r.shards.begin() + x);
+                        break;
+                    }
+                }
+                fold(r.retired, *shard);
+                delete shard;
+            }
+        };
+
+        static inline uint16_t slot(uint16_t metric){
+
+            return (metric < MaxMetrics) ? metric : 0;
+        }
+
+        static std::atomic<bool> &enabledFlag(){
+
+            static std::atomic<bool> enabled(true);
+            return enabled;
+        }
+
+        static std::atomic<uint32_t> &samplingPeriod(){
+
+            static std::atomic<uint32_t> period(0);
+            return period;
+        }
+
+        static Registry &registry(){
+
+            static Registry r;
+            return r;
+        }
+
+        static inline Shard &shard(){
+
+            static thread_local ShardOwner owner;
+            return *owner.shard;
+        }
+
+        static inline QueryCounters *&currentQuery(){
+
+            static thread_local QueryCounters *query = NULL;
+            return query;
+        }
+
+        static inline bool shouldSample(){
+
+            uint32_t period = getSampling();
+            if ((period == 0) || !isEnabled())
+                return false;
+            Shard &s = shard();
+            if (++s.tick < period)
+                return false;
+            s.tick = 0;
+            return true;
+        }
+
+        static void record(uint16_t metric, uint64_t nanos, uint64_t n){
+
+            Shard &s = shard();
+            uint16_t m = slot(metric);
+            uint64_t each = (n == 0) ? nanos : nanos / n;
+            uint16_t bucket = 0;
+            while ((bucket + 1 < HistogramBuckets) && (((uint64_t) 1 << bucket) <= each))
+                bucket++;
+            bump(s.samples[m], 1);
+            bump(s.sampledNanos[m], each);
+            bump(s.histogram[m][bucket], 1);
+        }
+
+        static inline void bump(std::atomic<uint64_t> &c, uint64_t n){
+
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        static void add(Snapshot &s, const Shard &shard){
+
+            for (uint16_t m = 0; m < MaxMetrics; m++){
+                s.counts[m] += shard.counts[m].load(std::memory_order_relaxed);
+                s.samples[m] += shard.samples[m].load(std::memory_order_relaxed);
+                s.sampledNanos[m] += shard.sampledNanos[m].load(std::memory_order_relaxed);
+                s.cacheHits[m] += shard.cacheHits[m].load(std::memory_order_relaxed);
+                s.cacheMisses[m] += shard.cacheMisses[m].load(std::memory_order_relaxed);
+                for (uint16_t b = 0; b < HistogramBuckets; b++)
+                    s.histogram[m][b] += shard.histogram[m][b].load(std::memory_order_relaxed);
+            }
+        }
+
+        static void subtract(Snapshot &s, const Snapshot &baseline){
+
+            for (uint16_t m = 0; m < MaxMetrics; m++){
+                s.counts[m] -= baseline.counts[m];
+                s.samples[m] -= baseline.samples[m];
+                s.sampledNanos[m] -= baseline.sampledNanos[m];
+                s.cacheHits[m] -= baseline.cacheHits[m];
+                s.cacheMisses[m] -= baseline.cacheMisses[m];
+                for (uint16_t b = 0; b < HistogramBuckets; b++)
+                    s.histogram[m][b] -= baseline.histogram[m][b];
+            }
+        }
+
+        static void fold(Shard &into, const Shard &from){
+
+            for (uint16_t m = 0; m < MaxMetrics; m++){
+                into.counts[m].fetch_add(from.counts[m].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                into.samples[m].fetch_add(from.samples[m].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                into.sampledNanos[m].fetch_add(from.sampledNanos[m].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                into.cacheHits[m].fetch_add(from.cacheHits[m].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                into.cacheMisses[m].fetch_add(from.cacheMisses[m].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                for (uint16_t b = 0; b < HistogramBuckets; b++)
+                    into.histogram[m][b].fetch_add(from.histogram[m][b].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+
+        static void clear(Shard &s){
+
+            for (uint16_t m = 0; m < MaxMetrics; m++){
+                s.counts[m].store(0, std::memory_order_relaxed);
+                s.samples[m].store(0, std::memory_order_relaxed);
+                s.sampledNanos[m].store(0, std::memory_order_relaxed);
+                s.cacheHits[m].store(0, std::memory_order_relaxed);
+                s.cacheMisses[m].store(0, std::memory_order_relaxed);
+                for (uint16_t b = 0; b < HistogramBuckets; b++)
+                    s.histogram[m][b].store(0, std::memory_order_relaxed);
+            }
+        }
+};
+
+#endif // DISTANCESTATISTICS_H
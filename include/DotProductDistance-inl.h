@@ -0,0 +1,71 @@
+template <class ObjectType>
+DotProductDistance<ObjectType>::DotProductDistance(){
+
+    this->metricType = MetricType;
+}
+
+template <class ObjectType>
+DotProductDistance<ObjectType>::~DotProductDistance(){
+}
+
+template <class ObjectType>
+double DotProductDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
+
+    return getDistance(obj1, obj2);
+}
+
+template <class ObjectType>
+double DotProductDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    double d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void DotProductDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    DistanceKernels::computeObjectBatch<DotProductDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+template <class T>
+double DotProductDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return -DistanceKernels::compute<DotProductKernel>(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+double DotProductDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    // Terms of either sign: no partial sum bounds the result.
+    (void) bound;
+    (void) order;
+    return compute(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+void DotProductDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<DotProductKernel>(q, c, count, n, out);
+    for (size_t x = 0; x < count; x++)
+        out[x] = -out[x];
+}
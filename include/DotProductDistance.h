@@ -0,0 +1,42 @@
+#ifndef DOTPRODUCTDISTANCE_H
+#define DOTPRODUCTDISTANCE_H
+
+#include "DistanceFunction.h"
+#include "DistanceKernels.h"
+#include <cmath>
+#include <stdexcept>
+
+/**
+* Dot product dissimilarity: -a.b, so that the nearest vectors are the ones
+* with the largest inner product (maximum inner product search). On vectors
+* of unit norm it ranks as CosineDistance, at the cost of one dot product.
+* Not a metric: it can be negative and breaks the triangle inequality, so it
+* must not be used with pivot or tree indexes.
+*/
+template <class ObjectType>
+class DotProductDistance : public DistanceFunction <ObjectType>{
+
+    public:
+
+        // Same number as Evaluator::DOTPRODUCT.
+        static const uint16_t MetricType = 10;
+
+        DotProductDistance();
+        virtual ~DotProductDistance();
+
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
+};
+
+#include "DotProductDistance-inl.h"
+#endif // DOTPRODUCTDISTANCE_H
@@ -1,5 +1,7 @@
 template <class ObjectType>
 EuclideanDistance<ObjectType>::EuclideanDistance(){
+
+    this->metricType = MetricType;
 }
 
 template <class ObjectType>
@@ -7,28 +9,99 @@ EuclideanDistance<ObjectType>::~EuclideanDistance(){
 }
 
 template <class ObjectType>
-double EuclideanDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double EuclideanDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
 
     return getDistance(obj1, obj2);
 }
 
 template <class ObjectType>
-double EuclideanDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double EuclideanDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
 
     if (obj1.size() != obj2.size()){
         throw std::length_error("The feature vectors do not have the same size.");
     }
 
-    double d = 0;
-    double tmp;
+    double d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void EuclideanDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    DistanceKernels::computeObjectBatch<EuclideanDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+double EuclideanDistance<ObjectType>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
 
-    for (size_t i = 0; i < obj1.size(); i++){
-        tmp = obj1[i] - obj2[i];
-        d = d + (tmp * tmp);
+    if ((order != NULL) && (order->size() != obj1.size())){
+        throw std::length_error("The dimension order does not match the feature vectors size.");
     }
 
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+
     // Statistic support
     this->updateDistanceCount();
 
-    return sqrt(d);
+    return d;
+}
+
+template <class ObjectType>
+template <class T>
+double EuclideanDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return sqrt(DistanceKernels::compute<SquaredEuclideanKernel>(a, b, n));
+}
+
+template <class ObjectType>
+template <class T>
+double EuclideanDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    return sqrt(DistanceKernels::computeBounded<SquaredEuclideanKernel>(a, b, n, squaredLimit(bound), order));
+}
+
+template <class ObjectType>
+double EuclideanDistance<ObjectType>::squaredLimit(double bound){
+
+    // bound * bound alone may be rounded down: a partial sum just above it
+    // would then have a square root equal to bound, and pass as a distance.
+    // Both loops run for at most an ulp or two, as sqrt is correctly rounded.
+    if (bound < 0.0)
+        return -1.0;
+    double limit = bound * bound;
+    if (!std::isfinite(limit))
+        return limit;
+    while (sqrt(limit) > bound)
+        limit = std::nextafter(limit, 0.0);
+    while (sqrt(std::nextafter(limit, HUGE_VAL)) <= bound)
+        limit = std::nextafter(limit, HUGE_VAL);
+    return limit;
+}
+
+template <class ObjectType>
+template <class T>
+void EuclideanDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<SquaredEuclideanKernel>(q, c, count, n, out);
+    for (size_t x = 0; x < count; x++){
+        out[x] = sqrt(out[x]);
+    }
 }
@@ -0,0 +1,108 @@
+template <class ObjectType>
+HammingDistance<ObjectType>::HammingDistance(){
+
+    this->metricType = MetricType;
+}
+
+
+template <class ObjectType>
+HammingDistance<ObjectType>::~HammingDistance(){
+}
+
+
+template <class ObjectType>
+double HammingDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
+
+    return getDistance(obj1, obj2);
+}
+
+
+template <class ObjectType>
+double HammingDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
+
+    if (obj1.size() != obj2.size())
+        throw std::length_error("The feature vectors do not have the same size.");
+
+    double d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void HammingDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    DistanceKernels::computeObjectBatch<HammingDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+double HammingDistance<ObjectType>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size())
+        throw std::length_error("The feature vectors do not have the same size.");
+
+    if ((order != NULL) && !BitPacked<ObjectType>::value && (order->size() != obj1.size()))
+        throw std::length_error("The dimension order does not match the feature vectors size.");
+
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+template <class T>
+double HammingDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    if constexpr (BitPacked<ObjectType>::value)
+        return (double) DistanceKernels::hamming(a, b, words(n));
+    else
+        return DistanceKernels::compute<HammingKernel>(a, b, n);
+}
+
+
+template <class ObjectType>
+template <class T>
+double HammingDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    if constexpr (BitPacked<ObjectType>::value){
+        (void) order;
+        size_t w = words(n);
+        uint64_t d = 0;
+        for (size_t i = 0; i < w; i += BoundedWords){
+            d += DistanceKernels::hamming(a + i, b + i, (w - i < BoundedWords) ? w - i : BoundedWords);
+            if (d > bound)
+                break;
+        }
+        return (double) d;
+    } else {
+        return DistanceKernels::computeBounded<HammingKernel>(a, b, n, bound, order);
+    }
+}
+
+
+template <class ObjectType>
+template <class T>
+void HammingDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    if constexpr (BitPacked<ObjectType>::value){
+        for (size_t x = 0; x < count; x++)
+            out[x] = (double) DistanceKernels::hamming(q, c[x], words(n));
+    } else {
+        DistanceKernels::computeBatch<HammingKernel>(q, c, count, n, out);
+    }
+}
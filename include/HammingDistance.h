@@ -0,0 +1,62 @@
+#ifndef HAMMINGDISTANCE_H
+#define HAMMINGDISTANCE_H
+
+#include "DistanceFunction.h"
+#include "DistanceKernels.h"
+#include <cmath>
+#include <stdexcept>
+
+/**
+* Tells whether a feature vector type packs one bit per dimension into 64-bit
+* words, size() being the number of bits and getRawData() the words (see
+* BitArrayObject, which specializes it).
+*/
+template <class ObjectType>
+struct BitPacked{
+    static const bool value = false;
+};
+
+/**
+* Hamming distance: the number of dimensions that differ.
+* Bit-packed vectors are compared a word at a time with popcount (see
+* DistanceKernels::hamming()); other vectors element by element.
+*/
+template <class ObjectType>
+class HammingDistance : public DistanceFunction <ObjectType>{
+
+    public:
+
+        // Same number as Evaluator::HAMMING.
+        static const uint16_t MetricType = 8;
+
+        HammingDistance();
+        virtual ~HammingDistance();
+
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+        double getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order = NULL);
+
+        // Unchecked versions over raw arrays of n elements (n bits for
+        // bit-packed vectors, whose bounded version ignores order), for
+        // compile-time dispatch (see MetricEvaluator): no size check, no
+        // statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
+
+    private:
+
+        // Words checked between two bound tests of bit-packed vectors.
+        static const size_t BoundedWords = 8;
+
+        static size_t words(size_t bits){
+            return (bits + 63) / 64;
+        }
+};
+
+#include "HammingDistance-inl.h"
+#endif // HAMMINGDISTANCE_H
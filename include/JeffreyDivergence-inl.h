@@ -0,0 +1,113 @@
+template <class ObjectType>
+JeffreyDivergence<ObjectType>::JeffreyDivergence(){
+
+    this->metricType = MetricType;
+}
+
+template <class ObjectType>
+JeffreyDivergence<ObjectType>::~JeffreyDivergence(){
+}
+
+template <class ObjectType>
+double JeffreyDivergence<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
+
+    return getDistance(obj1, obj2);
+}
+
+template <class ObjectType>
+double JeffreyDivergence<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    double d;
+    if constexpr (HasAuxiliaries<ObjectType>::value){
+        d = computeWithAuxiliaries(obj1.getRawData(), obj1.getAuxiliaries(), obj2.getRawData(), obj2.getAuxiliaries(), obj1.size());
+    } else {
+        d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+    }
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void JeffreyDivergence<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    DistanceKernels::computeObjectBatch<JeffreyDivergence>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+double JeffreyDivergence<ObjectType>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    if ((order != NULL) && (order->size() != obj1.size())){
+        throw std::length_error("The dimension order does not match the feature vectors size.");
+    }
+
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d;
+    if constexpr (HasAuxiliaries<ObjectType>::value){
+        // The full distance, so that it agrees with getDistance().
+        d = computeWithAuxiliaries(obj1.getRawData(), obj1.getAuxiliaries(), obj2.getRawData(), obj2.getAuxiliaries(), obj1.size());
+    } else {
+        d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+    }
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+template <class T>
+double JeffreyDivergence<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return DistanceKernels::compute<JeffreyKernel>(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+double JeffreyDivergence<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    return DistanceKernels::computeBounded<JeffreyKernel>(a, b, n, bound, order);
+}
+
+template <class ObjectType>
+template <class T>
+void JeffreyDivergence<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<JeffreyKernel>(q, c, count, n, out);
+}
+
+template <class ObjectType>
+template <class T>
+double JeffreyDivergence<ObjectType>::computeWithAuxiliaries(const T *a, const VectorAuxiliaries &xa, const T *b, const VectorAuxiliaries &xb, size_t n){
+
+    // sum a ln a + b ln b - 2 m ln m, with the first two sums known. For
+    // close vectors this difference of large sums cancels: below a small
+    // fraction of their size, the pair kernel computes it again, which
+    // also keeps agreeing with the plain-array paths.
+    double mean = DistanceKernels::compute<MeanXLogXKernel>(a, b, n);
+    double d = xa.xLogX + xb.xLogX - 2.0 * mean;
+    double scale = std::fabs(xa.xLogX) + std::fabs(xb.xLogX) + 2.0 * std::fabs(mean);
+    if (d <= CancellationRatio * scale)
+        return DistanceKernels::compute<JeffreyKernel>(a, b, n);
+    return d;
+}
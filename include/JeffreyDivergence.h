@@ -0,0 +1,51 @@
+#ifndef JEFFREYDIVERGENCE_H
+#define JEFFREYDIVERGENCE_H
+
+#include "DistanceFunction.h"
+#include "DistanceKernels.h"
+#include "VectorAuxiliaries.h"
+#include <cmath>
+#include <stdexcept>
+
+/**
+* Jeffrey divergence of non-negative histograms:
+* sum a ln(2a / (a + b)) + b ln(2b / (a + b)).
+* Logarithms use a fast approximation whose absolute error is below 2e-11 per
+* logarithm, so the result is within 1e-10 * (sum a + sum b) of the exact value.
+* getDistance() on feature vectors keeping VectorAuxiliaries takes the x ln x
+* sums from them and computes one logarithm per bin instead of three.
+*/
+template <class ObjectType>
+class JeffreyDivergence : public DistanceFunction <ObjectType>{
+
+    public:
+
+        // Same number as Evaluator::JEFFREY.
+        static const uint16_t MetricType = 4;
+
+        JeffreyDivergence();
+        virtual ~JeffreyDivergence();
+
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+        double getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order = NULL);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
+        // computeWithAuxiliaries() falls back to the pair kernel below this
+        // fraction of the sums it subtracts.
+        static constexpr double CancellationRatio = 1e-6;
+
+        template <class T>
+        static double computeWithAuxiliaries(const T *a, const VectorAuxiliaries &xa, const T *b, const VectorAuxiliaries &xb, size_t n);
+};
+
+#include "JeffreyDivergence-inl.h"
+#endif // JEFFREYDIVERGENCE_H
@@ -1,5 +1,7 @@
 template <class ObjectType>
 ManhattanDistance<ObjectType>::ManhattanDistance(){
+
+    this->metricType = MetricType;
 }
 
 
@@ -8,28 +10,78 @@ ManhattanDistance<ObjectType>::~ManhattanDistance(){
 }
 
 template <class ObjectType>
-double ManhattanDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double ManhattanDistance<ObjectType>::GetDistance(ObjectType &obj1, ObjectType &obj2){
 
     return getDistance(obj1, obj2);
 }
 
 template <class ObjectType>
-double ManhattanDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error){
+double ManhattanDistance<ObjectType>::getDistance(ObjectType &obj1, ObjectType &obj2){
 
     if (obj1.size() != obj2.size()){
         throw std::length_error("The feature vectors do not have the same size.");
     }
 
-    double d = 0;
-    double tmp;
+    double d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType>
+void ManhattanDistance<ObjectType>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    DistanceKernels::computeObjectBatch<ManhattanDistance>(query.getRawData(), candidates, count, query.size(), out);
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType>
+double ManhattanDistance<ObjectType>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
 
-    for (size_t i = 0; i < obj1.size(); i++){
-        tmp = fabs(obj1[i] - obj2[i]);
-        d = d + tmp;
+    if ((order != NULL) && (order->size() != obj1.size())){
+        throw std::length_error("The dimension order does not match the feature vectors size.");
     }
 
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+
     // Statistic support
     this->updateDistanceCount();
 
     return d;
 }
+
+template <class ObjectType>
+template <class T>
+double ManhattanDistance<ObjectType>::compute(const T *a, const T *b, size_t n){
+
+    return DistanceKernels::compute<ManhattanKernel>(a, b, n);
+}
+
+template <class ObjectType>
+template <class T>
+double ManhattanDistance<ObjectType>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    return DistanceKernels::computeBounded<ManhattanKernel>(a, b, n, bound, order);
+}
+
+template <class ObjectType>
+template <class T>
+void ManhattanDistance<ObjectType>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    DistanceKernels::computeBatch<ManhattanKernel>(q, c, count, n, out);
+}
@@ -2,6 +2,7 @@
 #define MANHATTANDISTANCE_H
 
 #include "DistanceFunction.h"
+#include "DistanceKernels.h"
 #include <cmath>
 #include <stdexcept>
 
@@ -9,11 +10,25 @@ template <class ObjectType>
 class ManhattanDistance : public DistanceFunction<ObjectType> {
 
     public:
+        // Same number as Evaluator::CITYBLOCK.
+        static const uint16_t MetricType = 2;
+
         ManhattanDistance();
         ~ManhattanDistance();
 
-        double GetDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error);
-        double getDistance(ObjectType &obj1, ObjectType &obj2) throw (std::length_error);
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+        double getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order = NULL);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
 };
 
 
@@ -0,0 +1,226 @@
+template <class ObjectType, int PNum, int PDen>
+MinkowskiDistance<ObjectType, PNum, PDen>::MinkowskiDistance(double p){
+
+    checkOrder(p);
+    if ((PNum > 0) && (p != (double) PNum / PDen)){
+        throw std::invalid_argument("The order does not match the compile-time one.");
+    }
+
+    this->p = p;
+    this->metricType = MetricType;
+}
+
+template <class ObjectType, int PNum, int PDen>
+MinkowskiDistance<ObjectType, PNum, PDen>::~MinkowskiDistance(){
+}
+
+template <class ObjectType, int PNum, int PDen>
+double MinkowskiDistance<ObjectType, PNum, PDen>::getOrder() const{
+
+    return p;
+}
+
+template <class ObjectType, int PNum, int PDen>
+double MinkowskiDistance<ObjectType, PNum, PDen>::GetDistance(ObjectType &obj1, ObjectType &obj2){
+
+    return getDistance(obj1, obj2);
+}
+
+template <class ObjectType, int PNum, int PDen>
+double MinkowskiDistance<ObjectType, PNum, PDen>::getDistance(ObjectType &obj1, ObjectType &obj2){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    double d;
+    if constexpr (PNum > 0){
+        d = compute(obj1.getRawData(), obj2.getRawData(), obj1.size());
+    } else {
+        d = computeRuntime(obj1.getRawData(), obj2.getRawData(), obj1.size(), p);
+    }
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType, int PNum, int PDen>
+void MinkowskiDistance<ObjectType, PNum, PDen>::getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out){
+
+    for (size_t x = 0; x < count; x++){
+        if (candidates[x]->size() != query.size()){
+            throw std::length_error("The feature vectors do not have the same size.");
+        }
+    }
+
+    if constexpr (PNum > 0){
+        DistanceKernels::computeObjectBatch<MinkowskiDistance>(query.getRawData(), candidates, count, query.size(), out);
+    } else {
+        for (size_t x = 0; x < count; x++){
+            out[x] = computeRuntime(query.getRawData(), candidates[x]->getRawData(), query.size(), p);
+        }
+    }
+
+    // Statistic support
+    this->updateDistanceCount(count);
+}
+
+template <class ObjectType, int PNum, int PDen>
+double MinkowskiDistance<ObjectType, PNum, PDen>::getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order){
+
+    if (obj1.size() != obj2.size()){
+        throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    if ((order != NULL) && (order->size() != obj1.size())){
+        throw std::length_error("The dimension order does not match the feature vectors size.");
+    }
+
+    const uint32_t *dims = (order != NULL) ? order->data() : NULL;
+    double d;
+    if constexpr (PNum > 0){
+        d = computeBounded(obj1.getRawData(), obj2.getRawData(), obj1.size(), bound, dims);
+    } else {
+        d = computeBoundedRuntime(obj1.getRawData(), obj2.getRawData(), obj1.size(), p, bound, dims);
+    }
+
+    // Statistic support
+    this->updateDistanceCount();
+
+    return d;
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class T>
+double MinkowskiDistance<ObjectType, PNum, PDen>::compute(const T *a, const T *b, size_t n){
+
+    static_assert(PNum > 0, "Use computeRuntime() for an order given at runtime.");
+    return root(DistanceKernels::compute< MinkowskiKernel<PNum, PDen> >(a, b, n), (double) PNum / PDen);
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class T>
+double MinkowskiDistance<ObjectType, PNum, PDen>::computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order){
+
+    static_assert(PNum > 0, "Use computeBoundedRuntime() for an order given at runtime.");
+    double limit = -1.0;
+    if (bound >= 0.0){
+        MinkowskiKernel<PNum, PDen>::power(limit, bound);
+        limit = fitLimit(limit, bound, (double) PNum / PDen);
+    }
+    return root(DistanceKernels::computeBounded< MinkowskiKernel<PNum, PDen> >(a, b, n, limit, order), (double) PNum / PDen);
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class T>
+void MinkowskiDistance<ObjectType, PNum, PDen>::computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out){
+
+    static_assert(PNum > 0, "Use computeBatchRuntime() for an order given at runtime.");
+    DistanceKernels::computeBatch< MinkowskiKernel<PNum, PDen> >(q, c, count, n, out);
+    for (size_t x = 0; x < count; x++){
+        out[x] = root(out[x], (double) PNum / PDen);
+    }
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class T>
+double MinkowskiDistance<ObjectType, PNum, PDen>::computeRuntime(const T *a, const T *b, size_t n, double p){
+
+    double d = 0.0;
+    if (visitOrder(p, [&](auto o){ d = MinkowskiDistance<ObjectType, decltype(o)::Num, decltype(o)::Den>::compute(a, b, n); }))
+        return d;
+    return root(powerSum(a, b, n, p, HUGE_VAL, NULL), p);
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class T>
+double MinkowskiDistance<ObjectType, PNum, PDen>::computeBoundedRuntime(const T *a, const T *b, size_t n, double p, double bound, const uint32_t *order){
+
+    double d = 0.0;
+    if (visitOrder(p, [&](auto o){ d = MinkowskiDistance<ObjectType, decltype(o)::Num, decltype(o)::Den>::computeBounded(a, b, n, bound, order); }))
+        return d;
+    double limit = (bound < 0.0) ? -1.0 : fitLimit(std::pow(bound, p), bound, p);
+    return root(powerSum(a, b, n, p, limit, order), p);
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class T>
+void MinkowskiDistance<ObjectType, PNum, PDen>::computeBatchRuntime(const T *q, const T *const *c, size_t count, size_t n, double p, double *out){
+
+    if (visitOrder(p, [&](auto o){ MinkowskiDistance<ObjectType, decltype(o)::Num, decltype(o)::Den>::computeBatch(q, c, count, n, out); }))
+        return;
+    for (size_t x = 0; x < count; x++){
+        out[x] = root(powerSum(q, c[x], n, p, HUGE_VAL, NULL), p);
+    }
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class Visitor>
+bool MinkowskiDistance<ObjectType, PNum, PDen>::visitOrder(double p, const Visitor &visitor){
+
+    if (p == 0.25) visitor(MinkowskiOrder<1, 4>());
+    else if (p == 0.5) visitor(MinkowskiOrder<1, 2>());
+    else if (p == 0.75) visitor(MinkowskiOrder<3, 4>());
+    else if (p == 1.0) visitor(MinkowskiOrder<1, 1>());
+    else if (p == 1.5) visitor(MinkowskiOrder<3, 2>());
+    else if (p == 2.0) visitor(MinkowskiOrder<2, 1>());
+    else if (p == 3.0) visitor(MinkowskiOrder<3, 1>());
+    else if (p == 4.0) visitor(MinkowskiOrder<4, 1>());
+    else if (p == 5.0) visitor(MinkowskiOrder<5, 1>());
+    else if (p == 6.0) visitor(MinkowskiOrder<6, 1>());
+    else if (p == 8.0) visitor(MinkowskiOrder<8, 1>());
+    else return false;
+    return true;
+}
+
+template <class ObjectType, int PNum, int PDen>
+void MinkowskiDistance<ObjectType, PNum, PDen>::checkOrder(double p){
+
+    if (!(p > 0.0) || !std::isfinite(p)){
+        throw std::invalid_argument("The Minkowski order must be a positive finite number.");
+    }
+}
+
+template <class ObjectType, int PNum, int PDen>
+double MinkowskiDistance<ObjectType, PNum, PDen>::root(double s, double p){
+
+    if (p == 1.0)
+        return s;
+    if (p == 2.0)
+        return sqrt(s);
+    if (p == 0.5)
+        return s * s;
+    return std::pow(s, 1.0 / p);
+}
+
+template <class ObjectType, int PNum, int PDen>
+double MinkowskiDistance<ObjectType, PNum, PDen>::fitLimit(double limit, double bound, double p){
+
+    // bound^p may be rounded down: a partial sum just above it would then
+    // have a root equal to bound, and pass as a distance. The rounding errors
+    // are a few ulps; the steps are capped for roots that underflow.
+    if (!std::isfinite(limit))
+        return limit;
+    for (int x = 0; (x < FitSteps) && (limit > 0.0) && (root(limit, p) > bound); x++)
+        limit = std::nextafter(limit, 0.0);
+    for (int x = 0; (x < FitSteps) && (root(std::nextafter(limit, HUGE_VAL), p) <= bound); x++)
+        limit = std::nextafter(limit, HUGE_VAL);
+    return limit;
+}
+
+template <class ObjectType, int PNum, int PDen>
+template <class T>
+double MinkowskiDistance<ObjectType, PNum, PDen>::powerSum(const T *a, const T *b, size_t n, double p, double limit, const uint32_t *order){
+
+    // Checked against the limit every 64 dimensions, like DistanceKernels::computeBounded().
+    double s = 0.0;
+    for (size_t i = 0; i < n; i++){
+        size_t x = (order != NULL) ? order[i] : i;
+        s += std::pow(std::fabs((double) a[x] - (double) b[x]), p);
+        if (((i & 63) == 63) && (s > limit))
+            return s;
+    }
+    return s;
+}
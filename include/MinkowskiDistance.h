@@ -0,0 +1,108 @@
+#ifndef MINKOWSKIDISTANCE_H
+#define MINKOWSKIDISTANCE_H
+
+#include "DistanceFunction.h"
+#include "DistanceKernels.h"
+#include <cmath>
+#include <stdexcept>
+
+/**
+* A Minkowski order p = Num / Den, used as a tag by MinkowskiDistance::visitOrder().
+*/
+template <int PNum, int PDen>
+struct MinkowskiOrder{
+    static const int Num = PNum;
+    static const int Den = PDen;
+};
+
+/**
+* Minkowski distance of order p: (sum |a - b|^p)^(1/p).
+* p = 1 and p = 2 give the CityBlock and Euclidean distances; below 1 it is
+* not a metric (the triangle inequality fails).
+*
+* With PNum > 0 the order PNum / PDen is fixed at compile time and the
+* kernels take no pow() call per dimension (see MinkowskiKernel); PDen must
+* be 1, 2 or 4. With PNum = 0 the order is given to the constructor: the
+* orders of visitOrder() still run the compile-time kernels, the other ones
+* a pow() per dimension.
+*
+* Bounded distances compare the sum with bound^p, before taking the root.
+*
+* Example:
+*   MinkowskiDistance<FeatureVector, 3> l3;
+*   MinkowskiDistance<FeatureVector, 1, 2> lHalf;
+*   MinkowskiDistance<FeatureVector> lp(2.7);
+*/
+template <class ObjectType, int PNum = 0, int PDen = 1>
+class MinkowskiDistance : public DistanceFunction <ObjectType>{
+
+    private:
+        double p;
+
+    public:
+
+        // Same number as Evaluator::MINKOWSKI.
+        static const uint16_t MetricType = 11;
+
+        /**
+        * Constructor.
+        *
+        * @param p The order; it must be PNum / PDen when PNum > 0.
+        */
+        MinkowskiDistance(double p = (PNum > 0) ? (double) PNum / PDen : 2.0);
+        virtual ~MinkowskiDistance();
+
+        double getOrder() const;
+
+        double GetDistance(ObjectType &obj1, ObjectType &obj2);
+        double getDistance(ObjectType &obj1, ObjectType &obj2);
+        void getDistances(ObjectType &query, ObjectType *const *candidates, size_t count, double *out);
+        double getBoundedDistance(ObjectType &obj1, ObjectType &obj2, double bound, const std::vector<uint32_t> *order = NULL);
+
+        // Unchecked versions over raw arrays of n elements, for compile-time
+        // dispatch (see MetricEvaluator): no size check, no statistics.
+        // Only for a compile-time order (PNum > 0).
+        template <class T>
+        static double compute(const T *a, const T *b, size_t n);
+        template <class T>
+        static double computeBounded(const T *a, const T *b, size_t n, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatch(const T *q, const T *const *c, size_t count, size_t n, double *out);
+
+        // The same for an order given at runtime.
+        template <class T>
+        static double computeRuntime(const T *a, const T *b, size_t n, double p);
+        template <class T>
+        static double computeBoundedRuntime(const T *a, const T *b, size_t n, double p, double bound, const uint32_t *order = NULL);
+        template <class T>
+        static void computeBatchRuntime(const T *q, const T *const *c, size_t count, size_t n, double p, double *out);
+
+        /**
+        * Calls visitor(MinkowskiOrder<Num, Den>()) if p is one of the orders
+        * with a compile-time kernel: 1/4, 1/2, 3/4, 1, 3/2, 2, 3, 4, 5, 6 or 8.
+        *
+        * @return Whether p is one of them.
+        */
+        template <class Visitor>
+        static bool visitOrder(double p, const Visitor &visitor);
+
+        /**
+        * Checks that p is a valid order.
+        * @throw std::invalid_argument If p is not a positive finite number.
+        */
+        static void checkOrder(double p);
+
+    private:
+        // Ulps fitLimit() may move the limit in each direction.
+        static const int FitSteps = 16;
+
+        // Applies the 1/p root to a sum of |a - b|^p.
+        static double root(double s, double p);
+        // Adjusts limit = bound^p to the largest sum whose root is <= bound.
+        static double fitLimit(double limit, double bound, double p);
+        template <class T>
+        static double powerSum(const T *a, const T *b, size_t n, double p, double limit, const uint32_t *order);
+};
+
+#include "MinkowskiDistance-inl.h"
+#endif // MINKOWSKIDISTANCE_H
@@ -0,0 +1,465 @@
+#ifndef QUANTIZEDKERNELS_H
+#define QUANTIZEDKERNELS_H
+
+#include "DistanceKernels.h"
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+/**
+* Vector types of L int32 lanes, with the int8 codes, float weights and
+* binary16 codes they are widened from.
+*/
+template <int L>
+struct SimdQuantized;
+
+typedef int8_t SimdByte4 __attribute__((vector_size(4)));
+typedef int8_t SimdByte8 __attribute__((vector_size(8)));
+typedef int8_t SimdByte16 __attribute__((vector_size(16)));
+typedef uint16_t SimdHalf4 __attribute__((vector_size(8)));
+typedef uint16_t SimdHalf8 __attribute__((vector_size(16)));
+typedef uint16_t SimdHalf16 __attribute__((vector_size(32)));
+typedef int32_t SimdWord4 __attribute__((vector_size(16)));
+typedef int32_t SimdWord8 __attribute__((vector_size(32)));
+typedef int32_t SimdWord16 __attribute__((vector_size(64)));
+typedef float SimdFloat16 __attribute__((vector_size(64)));
+
+template <> struct SimdQuantized<4>{ typedef SimdByte4 Byte; typedef SimdHalf4 Half; typedef SimdWord4 Word; typedef SimdFloat4 Single; };
+template <> struct SimdQuantized<8>{ typedef SimdByte8 Byte; typedef SimdHalf8 Half; typedef SimdWord8 Word; typedef SimdFloat8 Single; };
+template <> struct SimdQuantized<16>{ typedef SimdByte16 Byte; typedef SimdHalf16 Half; typedef SimdWord16 Word; typedef SimdFloat16 Single; };
+#endif
+
+/**
+* Operations over L int32 lanes. The scalar specialization (L = 1) follows.
+*/
+template <int L>
+struct QuantizedLanes{
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+    typedef typename SimdQuantized<L>::Byte Byte;
+    typedef typename SimdQuantized<L>::Half Half;
+    typedef typename SimdQuantized<L>::Word Word;
+    typedef typename SimdQuantized<L>::Single Single;
+
+    static inline void zero(Word &w){
+        w = Word();
+    }
+
+    static inline void zero(Single &f){
+        f = Single();
+    }
+
+    static inline void load(Word &w, const int8_t *p){
+        Byte b;
+        memcpy(&b, p, sizeof(Byte));
+        w = __builtin_convertvector(b, Word);
+    }
+
+    static inline void load(Single &f, const float *p){
+        memcpy(&f, p, sizeof(Single));
+    }
+
+    // Decodes L binary16 values (see QuantizedKernels::halfToFloat).
+    static inline void loadHalf(Single &f, const uint16_t *p){
+        Half h;
+        memcpy(&h, p, sizeof(Half));
+        Word bits = __builtin_convertvector(h, Word);
+        Word magnitude = (bits & 0x7fff) << 13;
+        Word sign = (bits & 0x8000) << 16;
+        f = (Single) magnitude * 0x1p112f;
+        f = (Single) ((Word) f | sign);
+    }
+
+    static inline void toSingle(Single &f, const Word &w){
+        f = __builtin_convertvector(w, Single);
+    }
+
+    static inline void store(float *p, const Single &f){
+        memcpy(p, &f, sizeof(Single));
+    }
+
+    static inline int64_t sum(const Word &w){
+        int64_t s = 0;
+        for (int k = 0; k < L; k++)
+            s += w[k];
+        return s;
+    }
+
+    static inline double sum(const Single &f){
+        double s = 0.0;
+        for (int k = 0; k < L; k++)
+            s += f[k];
+        return s;
+    }
+#endif
+};
+
+template <>
+struct QuantizedLanes<1>{
+
+    typedef int32_t Word;
+    typedef float Single;
+
+    static inline void zero(Word &w){
+        w = 0;
+    }
+
+    static inline void zero(Single &f){
+        f = 0.0f;
+    }
+
+    static inline void load(Word &w, const int8_t *p){
+        w = *p;
+    }
+
+    static inline void load(Single &f, const float *p){
+        f = *p;
+    }
+
+    static inline void loadHalf(Single &f, const uint16_t *p){
+        uint32_t bits = ((uint32_t) (*p & 0x7fff)) << 13;
+        memcpy(&f, &bits, sizeof(float));
+        f *= 0x1p112f;
+        if (*p & 0x8000)
+            f = -f;
+    }
+
+    static inline void toSingle(Single &f, const Word &w){
+        f = (float) w;
+    }
+
+    static inline void store(float *p, const Single &f){
+        *p = f;
+    }
+
+    static inline int64_t sum(const Word &w){
+        return w;
+    }
+
+    static inline double sum(const Single &f){
+        return f;
+    }
+};
+
+/**
+* Kernels over scalar-quantized codes (see ScalarQuantizer).
+*
+* The int8 kernels widen the codes to int32 lanes and reduce them with
+* integer multiplies and absolute differences, so a vector of d dimensions
+* moves d bytes instead of 8 d. Codes must lie in [-127, 127]; the int32
+* accumulators are flushed to int64 every IntBlock elements, so any n is
+* exact. The weighted kernels multiply the integer terms by a float weight per
+* dimension, for codes with a scale per dimension.
+*
+* binary16 codes are decoded to float in registers. Values are finite by
+* construction (floatToHalf() saturates), so infinities and NaNs are not
+* handled by the decoder.
+*
+* The instruction set is the one chosen by DistanceKernels::level().
+*/
+class QuantizedKernels{
+
+    public:
+
+        /**
+        * Sum of (a - b)^2 over int8 codes.
+        */
+        static int64_t squaredEuclidean(const int8_t *a, const int8_t *b, size_t n){
+
+            return compute<SquaredTerm>(a, b, n);
+        }
+
+        /**
+        * Sum of |a - b| over int8 codes.
+        */
+        static int64_t manhattan(const int8_t *a, const int8_t *b, size_t n){
+
+            return compute<AbsoluteTerm>(a, b, n);
+        }
+
+        /**
+        * Sum of a * b over int8 codes.
+        */
+        static int64_t dotProduct(const int8_t *a, const int8_t *b, size_t n){
+
+            return compute<ProductTerm>(a, b, n);
+        }
+
+        /**
+        * Sum of w * (a - b)^2 over int8 codes.
+        * @param w One weight per dimension.
+        */
+        static double weightedSquaredEuclidean(const int8_t *a, const int8_t *b, const float *w, size_t n){
+
+            return computeWeighted<SquaredTerm>(a, b, w, n);
+        }
+
+        /**
+        * Sum of w * |a - b| over int8 codes.
+        * @param w One weight per dimension.
+        */
+        static double weightedManhattan(const int8_t *a, const int8_t *b, const float *w, size_t n){
+
+            return computeWeighted<AbsoluteTerm>(a, b, w, n);
+        }
+
+        /**
+        * Decodes n binary16 values.
+        */
+        static void decodeHalf(const uint16_t *h, float *out, size_t n){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (DistanceKernels::level()){
+                case DistanceKernels::AVX512: decodeAvx512(h, out, n); return;
+                case DistanceKernels::AVX2: decodeAvx2(h, out, n); return;
+                case DistanceKernels::SSE2: decodeSse2(h, out, n); return;
+                default: break;
+            }
+#endif
+            decode<1>(h, out, n);
+        }
+
+        static float halfToFloat(uint16_t h){
+
+            float f;
+            QuantizedLanes<1>::loadHalf(f, &h);
+            return f;
+        }
+
+        /**
+        * Rounds a float to the nearest binary16 value, ties to even.
+        * Magnitudes beyond the binary16 range, and NaNs, saturate to +-65504.
+        */
+        static uint16_t floatToHalf(float f){
+
+            uint32_t x;
+            memcpy(&x, &f, sizeof(float));
+            uint16_t sign = (x >> 16) & 0x8000;
+            x &= 0x7fffffff;
+
+            // At least 65520, which rounds to infinity.
+            if (x >= 0x477ff000)
+                return sign | 0x7bff;
+
+            // Below 2^-14: a subnormal binary16, i.e. a multiple of 2^-24.
+            if (x < 0x38800000){
+                float a;
+                memcpy(&a, &x, sizeof(float));
+                return sign | (uint16_t) nearbyintf(a * 0x1p24f);
+            }
+
+            // Rebias the exponent (127 - 15) and round the 13 dropped bits.
+            x += 0xc8000fff + ((x >> 13) & 1);
+            return sign | (uint16_t) (x >> 13);
+        }
+
+        // Elements reduced in int32 lanes before flushing to int64. A term is
+        // at most 254^2, so a lane holds IntBlock / L of them without overflow.
+        static const size_t IntBlock = 16384;
+
+    private:
+
+        /**
+        * Term policies: the per-dimension integer term of two code lanes.
+        */
+        struct SquaredTerm{
+            template <class W>
+            static inline void term(W &r, const W &a, const W &b){
+                W d = a - b;
+                r = d * d;
+            }
+        };
+
+        struct AbsoluteTerm{
+            template <class W>
+            static inline void term(W &r, const W &a, const W &b){
+                W d = a - b;
+                W m = d >> 31;
+                r = (d ^ m) - m;
+            }
+        };
+
+        struct ProductTerm{
+            template <class W>
+            static inline void term(W &r, const W &a, const W &b){
+                r = a * b;
+            }
+        };
+
+        template <class K>
+        static int64_t compute(const int8_t *a, const int8_t *b, size_t n){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (DistanceKernels::level()){
+                case DistanceKernels::AVX512: return computeAvx512<K>(a, b, n);
+                case DistanceKernels::AVX2: return computeAvx2<K>(a, b, n);
+                case DistanceKernels::SSE2: return computeSse2<K>(a, b, n);
+                default: break;
+            }
+#endif
+            return reduce<K, 1>(a, b, n);
+        }
+
+        template <class K>
+        static double computeWeighted(const int8_t *a, const int8_t *b, const float *w, size_t n){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (DistanceKernels::level()){
+                case DistanceKernels::AVX512: return weightedAvx512<K>(a, b, w, n);
+                case DistanceKernels::AVX2: return weightedAvx2<K>(a, b, w, n);
+                case DistanceKernels::SSE2: return weightedSse2<K>(a, b, w, n);
+                default: break;
+            }
+#endif
+            return reduceWeighted<K, 1>(a, b, w, n);
+        }
+
+        /**
+        * The integer driver: L lanes, two accumulators, flushed every
+        * IntBlock elements. The tail is finished one element at a time.
+        */
+        template <class K, int L>
+        static inline int64_t reduce(const int8_t *a, const int8_t *b, size_t n){
+
+            typedef QuantizedLanes<L> Q;
+            typename Q::Word s0, s1, va, vb, r;
+            int64_t total = 0;
+
+            size_t i = 0;
+            while (i + L <= n){
+                size_t end = (n - i > IntBlock) ? i + IntBlock : n;
+                Q::zero(s0);
+                Q::zero(s1);
+                for (; i + 2 * L <= end; i += 2 * L){
+                    Q::load(va, a + i);
+                    Q::load(vb, b + i);
+                    K::term(r, va, vb);
+                    s0 += r;
+                    Q::load(va, a + i + L);
+                    Q::load(vb, b + i + L);
+                    K::term(r, va, vb);
+                    s1 += r;
+                }
+                if (i + L <= end){
+                    Q::load(va, a + i);
+                    Q::load(vb, b + i);
+                    K::term(r, va, vb);
+                    s0 += r;
+                    i += L;
+                }
+                s0 += s1;
+                total += Q::sum(s0);
+            }
+            for (; i < n; i++){
+                int32_t t;
+                K::term(t, (int32_t) a[i], (int32_t) b[i]);
+                total += t;
+            }
+            return total;
+        }
+
+        /**
+        * The weighted driver: integer terms converted to float and scaled per
+        * dimension. Float lanes are flushed to double every FloatBlock
+        * elements to bound the rounding error.
+        */
+        template <class K, int L>
+        static inline double reduceWeighted(const int8_t *a, const int8_t *b, const float *w, size_t n){
+
+            typedef QuantizedLanes<L> Q;
+            typename Q::Word va, vb, r;
+            typename Q::Single s, f, vw;
+            double total = 0.0;
+
+            size_t i = 0;
+            while (i + L <= n){
+                size_t end = (n - i > FloatBlock) ? i + FloatBlock : n;
+                Q::zero(s);
+                for (; i + L <= end; i += L){
+                    Q::load(va, a + i);
+                    Q::load(vb, b + i);
+                    Q::load(vw, w + i);
+                    K::term(r, va, vb);
+                    Q::toSingle(f, r);
+                    s += vw * f;
+                }
+                total += Q::sum(s);
+            }
+            for (; i < n; i++){
+                int32_t t;
+                K::term(t, (int32_t) a[i], (int32_t) b[i]);
+                total += (double) w[i] * t;
+            }
+            return total;
+        }
+
+        template <int L>
+        static inline void decode(const uint16_t *h, float *out, size_t n){
+
+            typedef QuantizedLanes<L> Q;
+            typename Q::Single f;
+
+            size_t i = 0;
+            for (; i + L <= n; i += L){
+                Q::loadHalf(f, h + i);
+                Q::store(out + i, f);
+            }
+            for (; i < n; i++)
+                out[i] = halfToFloat(h[i]);
+        }
+
+        static const size_t FloatBlock = 256;
+
+#ifdef HERMES_X86_DISPATCH
+        template <class K>
+        __attribute__((target("sse2"), flatten))
+        static int64_t computeSse2(const int8_t *a, const int8_t *b, size_t n){
+            return reduce<K, 4>(a, b, n);
+        }
+
+        template <class K>
+        __attribute__((target("avx2,fma"), flatten))
+        static int64_t computeAvx2(const int8_t *a, const int8_t *b, size_t n){
+            return reduce<K, 8>(a, b, n);
+        }
+
+        template <class K>
+        __attribute__((target("avx512f"), flatten))
+        static int64_t computeAvx512(const int8_t *a, const int8_t *b, size_t n){
+            return reduce<K, 16>(a, b, n);
+        }
+
+        template <class K>
+        __attribute__((target("sse2"), flatten))
+        static double weightedSse2(const int8_t *a, const int8_t *b, const float *w, size_t n){
+            return reduceWeighted<K, 4>(a, b, w, n);
+        }
+
+        template <class K>
+        __attribute__((target("avx2,fma"), flatten))
+        static double weightedAvx2(const int8_t *a, const int8_t *b, const float *w, size_t n){
+            return reduceWeighted<K, 8>(a, b, w, n);
+        }
+
+        template <class K>
+        __attribute__((target("avx512f"), flatten))
+        static double weightedAvx512(const int8_t *a, const int8_t *b, const float *w, size_t n){
+            return reduceWeighted<K, 16>(a, b, w, n);
+        }
+
+        __attribute__((target("sse2"), flatten))
+        static void decodeSse2(const uint16_t *h, float *out, size_t n){
+            decode<4>(h, out, n);
+        }
+
+        __attribute__((target("avx2,fma"), flatten))
+        static void decodeAvx2(const uint16_t *h, float *out, size_t n){
+            decode<8>(h, out, n);
+        }
+
+        __attribute__((target("avx512f"), flatten))
+        static void decodeAvx512(const uint16_t *h, float *out, size_t n){
+            decode<16>(h, out, n);
+        }
+#endif
+};
+
+#endif // QUANTIZEDKERNELS_H
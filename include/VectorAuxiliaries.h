@@ -0,0 +1,82 @@
+#ifndef VECTORAUXILIARIES_H
+#define VECTORAUXILIARIES_H
+
+#include "DistanceKernels.h"
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+
+/**
+* Terms of a single feature vector that some distance functions would
+* otherwise recompute for every pair: computed once per vector (see
+* BasicArrayObject::getAuxiliaries()), they leave the pair kernels only the
+* terms mixing both vectors.
+*
+* - squaredNorm, sum x^2: CosineDistance needs it for both vectors.
+* - absSum, sum |x|: when both vectors are non-negative, the denominator of
+*   BrayCurtisDistance is absSum(a) + absSum(b).
+* - xLogX, sum x ln x over x > 0: JeffreyDivergence is xLogX(a) + xLogX(b)
+*   - 2 sum m ln m, m = (a + b) / 2, one logarithm per bin instead of three.
+*
+* The sums are rounded in another order than in the pair kernels, so these
+* distances may differ in the last bits from the ones of plain arrays (e.g.
+* FeatureVectorView). The Jeffrey difference of sums would lose every digit
+* for close vectors; JeffreyDivergence then falls back to the pair kernel.
+* Evaluator, MetricEvaluator and the distance classes use
+* them for both full and bounded distances, which thus always agree.
+*/
+struct VectorAuxiliaries{
+
+    double squaredNorm;
+    double absSum;
+    double xLogX;
+    bool nonNegative;
+
+    /**
+    * Computes the terms of an array.
+    * @param p The array.
+    * @param n The number of elements.
+    */
+    template <class T>
+    static VectorAuxiliaries compute(const T *p, size_t n){
+
+        VectorAuxiliaries aux;
+        aux.squaredNorm = DistanceKernels::compute<DotProductKernel>(p, p, n);
+        aux.absSum = DistanceKernels::compute<AbsSumKernel>(p, p, n);
+        aux.xLogX = DistanceKernels::compute<XLogXKernel>(p, p, n);
+        aux.nonNegative = (DistanceKernels::compute<NegativeKernel>(p, p, n) <= 0.0);
+        return aux;
+    }
+};
+
+/**
+* Tells whether a feature vector type keeps its VectorAuxiliaries, through a
+* getAuxiliaries() method (see BasicArrayObject).
+*/
+template <class ObjectType, class = void>
+struct HasAuxiliaries{
+    static const bool value = false;
+};
+
+template <class ObjectType>
+struct HasAuxiliaries<ObjectType, decltype((void) std::declval<const ObjectType &>().getAuxiliaries())>{
+    static const bool value = true;
+};
+
+/**
+* Tells whether a distance function class has a faster version using the
+* VectorAuxiliaries of both vectors, as
+* static double computeWithAuxiliaries(const T *a, const VectorAuxiliaries &xa,
+*                                      const T *b, const VectorAuxiliaries &xb, size_t n).
+*/
+template <class Metric, class = void>
+struct AuxiliaryMetric{
+    static const bool value = false;
+};
+
+template <class Metric>
+struct AuxiliaryMetric<Metric, decltype((void) &Metric::template computeWithAuxiliaries<double>)>{
+    static const bool value = true;
+};
+
+#endif // VECTORAUXILIARIES_H
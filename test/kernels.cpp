@@ -0,0 +1,260 @@
+/**
+* Hermes kernel tests.
+*
+* Runs every kernel policy of DistanceKernels at every level this CPU
+* supports, through compute(), computeBatch() and computeBounded(), and
+* compares the results with the portable scalar path. Lengths cover every
+* tail of 0 to 17 elements past 0, 64 and 256, on aligned rows and rows one
+* element off. hamming() is compared with a word-by-word popcount.
+*
+* The vector paths add the terms in another order, so sums may differ from
+* the scalar ones by a few ulps of the magnitude of their terms (see
+* DistanceKernels); every other difference is a failure.
+*
+* Usage: kernels [--verbose]
+* Returns 0 when every check passes, 1 otherwise.
+*/
+#include <DistanceKernels.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace{
+
+const size_t Bases[] = {0, 64, 256};
+const size_t MaxTail = 17;
+// Candidates of a batch: enough for the groups of 4 and every remainder.
+const size_t BatchCount = 9;
+
+bool verbose = false;
+uint64_t checks = 0;
+uint64_t failures = 0;
+
+template <class T> const char *typeName();
+template <> const char *typeName<double>(){ return "float64"; }
+template <> const char *typeName<float>(){ return "float32"; }
+template <> const char *typeName<int32_t>(){ return "int32"; }
+
+void check(bool ok, const char *kernel, const char *type, const char *entry, size_t n, size_t offset, double got, double expected){
+
+    checks++;
+    if (ok)
+        return;
+    failures++;
+    if (verbose || (failures <= 20))
+        printf("FAIL %-12s %-8s %-8s %-8s n=%-4zu offset=%zu got %.17g expected %.17g\n",
+               DistanceKernels::levelName(DistanceKernels::level()), kernel, type, entry, n, offset, got, expected);
+}
+
+// Whether got matches the scalar value up to the reordering of a sum whose
+// terms add up to scale in magnitude.
+bool close(double got, double expected, double scale, size_t n){
+
+    if ((got == expected) || (std::isnan(got) && std::isnan(expected)))
+        return true;
+    return std::fabs(got - expected) <= 4.0 * (n + 1) * std::numeric_limits<double>::epsilon() * (scale + std::fabs(expected));
+}
+
+/**
+* Rows of values in [0, 2), or [-1, 1) when negative is set (x100 for
+* integers), with zeros and equal pairs so that the masked dimensions of
+* Canberra, Chi-square, Jeffrey and Hamming are exercised.
+*/
+template <class T>
+void fill(std::vector<T> &a, std::vector<T> &b, bool negative, std::mt19937 &random){
+
+    std::uniform_real_distribution<double> value(negative ? -1.0 : 0.0, negative ? 1.0 : 2.0);
+    double unit = std::is_integral<T>::value ? 100.0 : 1.0;
+    for (size_t i = 0; i < a.size(); i++){
+        uint32_t kind = random() % 8;
+        a[i] = (kind == 0) ? T(0) : (T) (unit * value(random));
+        b[i] = (kind <= 1) ? a[i] : (T) (unit * value(random));
+    }
+}
+
+// The magnitude of the terms of every kernel below, for the tolerance.
+template <class T>
+double magnitude(const T *a, const T *b, size_t n){
+
+    double s = 0.0;
+    for (size_t i = 0; i < n; i++){
+        double x = std::fabs((double) a[i]), y = std::fabs((double) b[i]);
+        s += 1.0 + x + y + x * y + x * x + y * y + (x + y) * (1.0 + std::fabs(std::log(x + y + 1.0)));
+    }
+    return s;
+}
+
+template <class K, class T>
+void testCompute(const char *kernel, const T *a, const T *b, size_t n, size_t offset){
+
+    double expected = DistanceKernels::computeScalar<K>(a, b, n);
+    double got = DistanceKernels::compute<K>(a, b, n);
+    check(close(got, expected, magnitude(a, b, n), n), kernel, typeName<T>(), "compute", n, offset, got, expected);
+}
+
+template <class K, class T>
+void testBatch(const char *kernel, const std::vector<T> &rows, size_t stride, size_t n, size_t offset){
+
+    const T *q = &rows[offset];
+    const T *c[BatchCount];
+    for (size_t j = 0; j < BatchCount; j++)
+        c[j] = &rows[(j + 1) * stride + offset];
+
+    for (size_t count = 0; count <= BatchCount; count++){
+        double out[BatchCount];
+        DistanceKernels::computeBatch<K>(q, c, count, n, out);
+        for (size_t j = 0; j < count; j++){
+            double expected = DistanceKernels::computeScalar<K>(q, c[j], n);
+            check(close(out[j], expected, magnitude(q, c[j], n), n), kernel, typeName<T>(), "batch", n, offset, out[j], expected);
+        }
+    }
+}
+
+/**
+* Bounded reductions: exact under an infinite limit, in the natural and in
+* the reversed order, and past any limit they stop at.
+*/
+template <class K, class T>
+void testBounded(const char *kernel, const T *a, const T *b, size_t n, size_t offset){
+
+    double expected = DistanceKernels::computeScalar<K>(a, b, n);
+    double scale = magnitude(a, b, n);
+    double infinity = std::numeric_limits<double>::infinity();
+
+    double got = DistanceKernels::computeBounded<K>(a, b, n, infinity);
+    check(close(got, expected, scale, n), kernel, typeName<T>(), "bounded", n, offset, got, expected);
+
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = n - 1 - i;
+    got = DistanceKernels::computeBounded<K>(a, b, n, infinity, order.data());
+    check(close(got, expected, scale, n), kernel, typeName<T>(), "ordered", n, offset, got, expected);
+
+    double limit = expected / 2;
+    if (expected > 0.0){
+        got = DistanceKernels::computeBounded<K>(a, b, n, limit);
+        check(got > limit, kernel, typeName<T>(), "abandon", n, offset, got, expected);
+        got = DistanceKernels::computeBounded<K>(a, b, n, limit, order.data());
+        check(got > limit, kernel, typeName<T>(), "abandon", n, offset, got, expected);
+    }
+}
+
+/**
+* @param bounded Whether finish() returns the accumulator, as
+* computeBounded() requires.
+* @param negative Whether the kernel takes negative values.
+*/
+template <class K, class T>
+void testKernel(const char *kernel, bool bounded, bool negative){
+
+    size_t longest = Bases[sizeof(Bases) / sizeof(Bases[0]) - 1] + MaxTail;
+    // One element of slack per row, for the rows one element off.
+    size_t stride = longest + 1;
+    std::vector<T> rows(stride * (BatchCount + 1));
+
+    for (size_t base : Bases){
+        for (size_t tail = 0; tail <= MaxTail; tail++){
+            size_t n = base + tail;
+            std::mt19937 random(n);
+            std::vector<T> a(stride), b(stride);
+            fill(a, b, negative, random);
+            for (size_t j = 0; j <= BatchCount; j++){
+                std::vector<T> &source = (j % 2 == 0) ? a : b;
+                std::copy(source.begin(), source.end(), rows.begin() + j * stride);
+            }
+            // Candidates differ from each other, not only from the query.
+            for (size_t j = 1; j <= BatchCount; j++)
+                rows[j * stride + (j % stride)] = (T) j;
+
+            for (size_t offset = 0; offset < 2; offset++){
+                testCompute<K>(kernel, &a[offset], &b[offset], n, offset);
+                if (bounded)
+                    testBounded<K>(kernel, &a[offset], &b[offset], n, offset);
+            }
+            for (size_t offset = 0; offset < 2; offset++)
+                testBatch<K>(kernel, rows, stride, n, offset);
+        }
+    }
+}
+
+template <class T>
+void testKernels(){
+
+    testKernel<SquaredEuclideanKernel, T>("euclidean", true, true);
+    testKernel<DotProductKernel, T>("dotproduct", false, true);
+    testKernel<ManhattanKernel, T>("cityblock", true, true);
+    testKernel<ChebyshevKernel, T>("chebyshev", true, true);
+    testKernel<MinkowskiKernel<3>, T>("minkowski3", true, true);
+    testKernel<MinkowskiKernel<1, 2>, T>("minkowski0.5", true, true);
+    testKernel<MinkowskiKernel<3, 4>, T>("minkowski0.75", true, true);
+    testKernel<CanberraKernel, T>("canberra", true, true);
+    testKernel<BrayCurtisKernel, T>("braycurtis", false, true);
+    testKernel<ChiSquareKernel, T>("chisquare", true, false);
+    testKernel<JeffreyKernel, T>("jeffrey", false, false);
+    testKernel<MeanXLogXKernel, T>("meanxlogx", false, false);
+    testKernel<AbsSumKernel, T>("abssum", false, true);
+    testKernel<NegativeKernel, T>("negative", false, true);
+    testKernel<XLogXKernel, T>("xlogx", false, false);
+    testKernel<HammingKernel, T>("hamming", true, true);
+}
+
+void testHammingWords(){
+
+    size_t longest = Bases[sizeof(Bases) / sizeof(Bases[0]) - 1] + MaxTail;
+    std::vector<uint64_t> a(longest + 1), b(longest + 1);
+    std::mt19937_64 random(7);
+    for (size_t i = 0; i < a.size(); i++){
+        a[i] = random();
+        b[i] = (i % 5 == 0) ? a[i] : random();
+    }
+
+    for (size_t base : Bases){
+        for (size_t tail = 0; tail <= MaxTail; tail++){
+            size_t n = base + tail;
+            for (size_t offset = 0; offset < 2; offset++){
+                uint64_t expected = 0;
+                for (size_t i = 0; i < n; i++)
+                    expected += DistanceKernels::popcount(a[offset + i] ^ b[offset + i]);
+                uint64_t got = DistanceKernels::hamming(&a[offset], &b[offset], n);
+                check(got == expected, "hamming", "bits", "words", n, offset, (double) got, (double) expected);
+            }
+        }
+    }
+}
+
+}
+
+int main(int argc, char **argv){
+
+    for (int x = 1; x < argc; x++){
+        if (std::string(argv[x]) == "--verbose"){
+            verbose = true;
+        } else {
+            fprintf(stderr, "Usage: kernels [--verbose]\n");
+            return 2;
+        }
+    }
+
+    DistanceKernels::Level best = DistanceKernels::detectLevel();
+    for (int l = DistanceKernels::SCALAR; l <= best; l++){
+        DistanceKernels::setLevel((DistanceKernels::Level) l);
+        uint64_t before = failures, checked = checks;
+        testKernels<double>();
+        testKernels<float>();
+        testKernels<int32_t>();
+        testHammingWords();
+        printf("%-8s %8llu checks, %llu failures\n", DistanceKernels::levelName(DistanceKernels::level()),
+               (unsigned long long) (checks - checked), (unsigned long long) (failures - before));
+    }
+    DistanceKernels::setLevel(best);
+
+    printf("%s\n", (failures == 0) ? "OK" : "FAILED");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,460 @@
+#ifndef ASYNCSCAN_H
+#define ASYNCSCAN_H
+
+#include <Evaluator.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/**
+* A linear k-nearest neighbor or range scan run in small, time-bounded
+* chunks, for hosts where a long scan must not block an event loop (a Qt
+* GUI thread, a single-threaded WebAssembly page).
+*
+* After each chunk the scan hands its continuation to a scheduler hook,
+* which queues it in the host loop, e.g. with QTimer::singleShot(0, ...) or
+* emscripten_async_call(). Hosts pumping the scan themselves (e.g. once per
+* animation frame) call step() instead. Between chunks the scan reports its
+* progress, can be cancelled, and getResults() gives the answer over the
+* part scanned so far.
+*
+* Candidates are ranked by (distance, position) as in ScanEngine, so the
+* final answer does not depend on the chunk sizes.
+*
+* The list must outlive the scan and stay unchanged while it runs. All calls
+* but cancel() must come from the thread running the scheduled chunks.
+* Destroying the scan cancels it: its queued continuation then does nothing.
+*
+* Example:
+*   AsyncScan<FeatureVector> scan = AsyncScan<FeatureVector>::kNearest(query, list, Evaluator<FeatureVector>::EUCLIDEAN, 10);
+*   scan.setScheduler([](const std::function<void()> &task){ QTimer::singleShot(0, task); });
+*   scan.setProgressCallback([&](size_t done, size_t total){ bar->setValue(100 * done / total); });
+*   scan.setCompletionCallback([&](AsyncScan<FeatureVector>::Status){ scan.getResults(best); });
+*   scan.start();
+*
+* @arg FeatureVector The feature vector type.
+*/
+template <class FeatureVector = BasicArrayObject<double> >
+class AsyncScan{
+
+    public:
+        enum Status{
+            READY = 0,
+            RUNNING = 1,
+            FINISHED = 2,
+            CANCELLED = 3,
+            // A distance threw; see getError().
+            FAILED = 4
+        };
+
+        /**
+        * A query answer: the distance and the OID of the feature vector.
+        */
+        typedef std::pair<double, uint32_t> Result;
+
+        /**
+        * Queues a task to be run later by the host event loop.
+        */
+        typedef std::function<void(const std::function<void()> &)> Scheduler;
+        typedef std::function<void(size_t, size_t)> ProgressCallback;
+        typedef std::function<void(Status)> CompletionCallback;
+
+    private:
+        struct Candidate{
+            double dist;
+            uint32_t position;
+
+            bool operator<(const Candidate &other) const{
+                return (dist < other.dist) || ((dist == other.dist) && (position < other.position));
+            }
+        };
+
+        // The clock is read once every ClockInterval distances.
+        static const size_t ClockInterval = 32;
+
+        // The state shared with the queued continuations.
+        struct Job{
+            std::vector<FeatureVector> *list;
+            FeatureVector query;
+            Evaluator<FeatureVector> evaluator;
+            bool nearest;
+            size_t k;
+            double radius;
+
+            size_t next;
+            uint64_t chunks;
+            // A max-heap of the k best candidates, or the range answers.
+            std::vector<Candidate> candidates;
+            Status status;
+            // Whether a continuation waits in the scheduler.
+            bool queued;
+            std::atomic<bool> cancelRequested;
+            std::exception_ptr error;
+
+            Scheduler scheduler;
+            ProgressCallback progress;
+            CompletionCallback completion;
+            std::chrono::nanoseconds budget;
+            size_t chunkLimit;
+
+            Job(FeatureVector &query, std::vector<FeatureVector> &list, uint16_t types)
+                : list(&list), query(query), evaluator(types), nearest(true), k(0), radius(0.0),
+                  next(0), chunks(0), status(READY), queued(false), cancelRequested(false),
+                  budget(std::chrono::milliseconds(4)), chunkLimit(0){
+            }
+        };
+
+        std::shared_ptr<Job> job;
+
+        AsyncScan(FeatureVector &query, std::vector<FeatureVector> &list, uint16_t types)
+            : job(std::make_shared<Job>(query, list, types)){
+        }
+
+    public:
+
+        /**
+        * Creates a scan for the k nearest feature vectors to the query. The
+        * query is copied.
+        *
+        * @param query The query feature vector.
+        * @param list The feature vectors to be scanned.
+        * @param types The distance function number, as in Evaluator.
+        * @param k The number of neighbors.
+        */
+        static AsyncScan kNearest(FeatureVector &query, std::vector<FeatureVector> &list, uint16_t types, size_t k){
+
+            AsyncScan scan(query, list, types);
+            scan.job->nearest = true;
+            scan.job->k = k;
+            return scan;
+        }
+
+        /**
+        * Creates a scan for every feature vector within radius of the query.
+        * The query is copied.
+        *
+        * @param query The query feature vector.
+        * @param list The feature vectors to be scanned.
+        * @param types The distance function number, as in Evaluator.
+        * @param radius The query radius.
+        */
+        static AsyncScan range(FeatureVector &query, std::vector<FeatureVector> &list, uint16_t types, double radius){
+
+            AsyncScan scan(query, list, types);
+            scan.job->nearest = false;
+            scan.job->radius = radius;
+            return scan;
+        }
+
+        AsyncScan(AsyncScan &&) = default;
+        AsyncScan &operator=(AsyncScan &&other){
+
+            if (this != &other){
+                abandon();
+                job = std::move(other.job);
+            }
+            return *this;
+        }
+
+        AsyncScan(const AsyncScan &) = delete;
+        AsyncScan &operator=(const AsyncScan &) = delete;
+
+        ~AsyncScan(){
+
+            abandon();
+        }
+
+        /**
+        * Sets the order p of the MINKOWSKI type, as in Evaluator (2 by
+        * default). Set it before the first chunk runs.
+        *
+        * @param p The order.
+        * @throw std::invalid_argument If p is not a positive finite number.
+        */
+        void setMinkowskiOrder(double p){
+
+            job->evaluator.setMinkowskiOrder(p);
+        }
+
+        double getMinkowskiOrder() const{
+
+            return job->evaluator.getMinkowskiOrder();
+        }
+
+        /**
+        * Sets the hook queueing the next chunk; start() requires one.
+        */
+        void setScheduler(const Scheduler &scheduler){
+
+            job->scheduler = scheduler;
+        }
+
+        /**
+        * Sets the time a chunk may run before yielding (4 ms by default).
+        * At least one distance is computed per chunk.
+        */
+        void setChunkBudget(std::chrono::nanoseconds budget){
+
+            job->budget = budget;
+        }
+
+        /**
+        * Caps the number of distances per chunk, 0 for no cap (the default).
+        */
+        void setChunkLimit(size_t limit){
+
+            job->chunkLimit = limit;
+        }
+
+        /**
+        * Sets a function called after every chunk with the number of
+        * feature vectors scanned and the total.
+        */
+        void setProgressCallback(const ProgressCallback &callback){
+
+            job->progress = callback;
+        }
+
+        /**
+        * Sets a function called once, when the scan finishes, is cancelled
+        * or fails.
+        */
+        void setCompletionCallback(const CompletionCallback &callback){
+
+            job->completion = callback;
+        }
+
+        /**
+        * Runs the scan through the scheduler: the first chunk is queued, and
+        * every chunk queues the next one until the scan ends. Does nothing if
+        * the scan already ended or a chunk is already queued.
+        *
+        * @throw std::runtime_error If no scheduler was set.
+        */
+        void start(){
+
+            if (!job->scheduler)
+                throw std::runtime_error("The asynchronous scan has no scheduler.");
+            if (!isDone() && !job->queued){
+                job->status = RUNNING;
+                schedule(job);
+            }
+        }
+
+        /**
+        * Runs one chunk on the calling thread, without the scheduler.
+        *
+        * @return Whether the scan still has work left.
+        */
+        bool step(){
+
+            // A callback may destroy this handle.
+            std::shared_ptr<Job> self = job;
+            return runChunk(*self);
+        }
+
+        /**
+        * Runs the scan to its end on the calling thread.
+        */
+        void run(){
+
+            std::shared_ptr<Job> self = job;
+            while (runChunk(*self)){
+            }
+        }
+
+        /**
+        * Asks the scan to stop before its next chunk. May be called from any
+        * thread; the results found so far stay available.
+        */
+        void cancel(){
+
+            job->cancelRequested = true;
+        }
+
+        Status getStatus() const{
+
+            return job->status;
+        }
+
+        bool isDone() const{
+
+            return (job->status != READY) && (job->status != RUNNING);
+        }
+
+        /**
+        * Gets the exception that failed the scan, if any.
+        */
+        std::exception_ptr getError() const{
+
+            return job->error;
+        }
+
+        /**
+        * Gets the number of feature vectors scanned so far.
+        */
+        size_t getProcessed() const{
+
+            return job->next;
+        }
+
+        size_t size() const{
+
+            return job->list->size();
+        }
+
+        /**
+        * Gets the fraction of the list scanned so far, in [0, 1].
+        */
+        double getProgress() const{
+
+            return job->list->empty() ? 1.0 : (double) job->next / job->list->size();
+        }
+
+        /**
+        * Gets the number of chunks run so far.
+        */
+        uint64_t getChunks() const{
+
+            return job->chunks;
+        }
+
+        /**
+        * Returns the number of distances computed so far.
+        */
+        uint64_t getStatistics(){
+
+            return job->evaluator.getStatistics();
+        }
+
+        /**
+        * Gets the answer over the feature vectors scanned so far, nearest
+        * first; once the scan finished, the exact answer.
+        *
+        * @param result Receives (distance, OID) pairs.
+        */
+        void getResults(std::vector<Result> &result) const{
+
+            std::vector<Candidate> sorted(job->candidates);
+            std::sort(sorted.begin(), sorted.end());
+            result.resize(sorted.size());
+            for (size_t x = 0; x < sorted.size(); x++)
+                result[x] = Result(sorted[x].dist, (*job->list)[sorted[x].position].getOID());
+        }
+
+    private:
+
+        void abandon(){
+
+            if (job){
+                job->cancelRequested = true;
+                job->progress = ProgressCallback();
+                job->completion = CompletionCallback();
+            }
+        }
+
+        static void schedule(const std::shared_ptr<Job> &job){
+
+            // The task keeps the job alive until it runs.
+            std::shared_ptr<Job> self = job;
+            job->queued = true;
+            job->scheduler([self](){
+                self->queued = false;
+                if (runChunk(*self) && !self->queued)
+                    schedule(self);
+            });
+        }
+
+        // Runs one chunk and returns whether work is left.
+        static bool runChunk(Job &job){
+
+            if ((job.status != READY) && (job.status != RUNNING))
+                return false;
+            job.status = RUNNING;
+            if (job.cancelRequested){
+                finish(job, CANCELLED);
+                return false;
+            }
+
+            size_t n = job.list->size();
+            try {
+                scan(job, n);
+            } catch (...){
+                job.error = std::current_exception();
+                finish(job, FAILED);
+                return false;
+            }
+            job.chunks++;
+
+            if (job.progress){
+                // A copy, as the callback may destroy the scan.
+                ProgressCallback progress = job.progress;
+                progress(job.next, n);
+            }
+            if (job.next >= n){
+                finish(job, FINISHED);
+                return false;
+            }
+            return true;
+        }
+
+        static void scan(Job &job, size_t n){
+
+            typedef std::chrono::steady_clock Clock;
+            Clock::time_point deadline = Clock::now() + job.budget;
+            size_t end = (job.chunkLimit > 0) ? std::min(n, job.next + job.chunkLimit) : n;
+            std::vector<Candidate> &heap = job.candidates;
+            if (job.nearest && (job.k == 0)){
+                job.next = n;
+                return;
+            }
+
+            for (size_t done = 0; job.next < end; done++){
+                if ((done > 0) && (done % ClockInterval == 0) && (Clock::now() >= deadline))
+                    break;
+
+                uint32_t x = job.next;
+                FeatureVector &object = (*job.list)[x];
+                if (job.nearest){
+                    double limit = (heap.size() == job.k) ? heap.front().dist : std::numeric_limits<double>::infinity();
+                    Candidate c = {job.evaluator.getBoundedDistance(job.query, object, limit), x};
+                    if (c.dist <= limit){
+                        if (heap.size() < job.k){
+                            heap.push_back(c);
+                            std::push_heap(heap.begin(), heap.end());
+                        } else if (c < heap.front()){
+                            std::pop_heap(heap.begin(), heap.end());
+                            heap.back() = c;
+                            std::push_heap(heap.begin(), heap.end());
+                        }
+                    }
+                } else {
+                    Candidate c = {job.evaluator.getBoundedDistance(job.query, object, job.radius), x};
+                    if (c.dist <= job.radius)
+                        job.candidates.push_back(c);
+                }
+                job.next++;
+            }
+        }
+
+        static void finish(Job &job, Status status){
+
+            job.status = status;
+            if (job.completion){
+                // Called once: the callback may destroy the scan.
+                CompletionCallback completion = job.completion;
+                job.completion = CompletionCallback();
+                completion(status);
+            }
+        }
+};
+
+#endif // ASYNCSCAN_H
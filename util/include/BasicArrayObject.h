@@ -1,11 +1,27 @@
 #ifndef BASICARRAYOBJECT_H
 #define BASICARRAYOBJECT_H
 
+#include <TextCodec.h>
+#include <VectorAuxiliaries.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 #include <iostream>
 
+/**
+* The last content version handed out by BasicArrayObject::getVersion().
+* It is shared by every DType, so that versions are unique process-wide.
+*/
+inline std::atomic<uint64_t> &lastFeatureVectorVersion(){
+
+    static std::atomic<uint64_t> last(0);
+    return last;
+}
+
 /**
 * For illustration, consider the feature vector as follows:
 * +-----+------+------------------+
@@ -27,15 +43,57 @@ class BasicArrayObject{
         //A previous directive that can allow store and retrieve
         //the feature vector from BLOB or FILE
         unsigned char *serialized;
+        //The version of the contents (see getVersion()), 0 until asked for
+        mutable std::atomic<uint64_t> version;
+        //The per-vector terms of the data (see getAuxiliaries()), valid in
+        //the AuxReady state
+        mutable VectorAuxiliaries auxiliaries;
+        mutable std::atomic<uint8_t> auxState;
+
+        static const uint8_t AuxNone = 0;
+        static const uint8_t AuxBusy = 1;
+        static const uint8_t AuxReady = 2;
+
+        /**
+        * Drops the serialized version, the content version and the
+        * auxiliaries, which no longer match the data. Every method that may
+        * change the OID or the data calls it.
+        */
+        void invalidate(){
+
+            if (serialized != NULL){
+                delete [] serialized;
+                serialized = NULL;
+            }//end if
+            version.store(0, std::memory_order_relaxed);
+            auxState.store(AuxNone, std::memory_order_relaxed);
+        }
+
+        // Takes the auxiliaries of other if they are ready; they match
+        // the data just copied or moved from it.
+        void copyAuxiliaries(const BasicArrayObject<DType> &other){
+
+            if (other.auxState.load(std::memory_order_acquire) == AuxReady){
+                auxiliaries = other.auxiliaries;
+                auxState.store(AuxReady, std::memory_order_relaxed);
+            } else {
+                auxState.store(AuxNone, std::memory_order_relaxed);
+            }
+        }
 
     public:
 
+        /**
+        * The data type stored by each position of the feature vector.
+        */
+        typedef DType value_type;
+
         /**
         * Constructor Method.
         * Sets data and size to empty and 0, respectively.
         */
-        BasicArrayObject(){
-            data.clear();
+        BasicArrayObject() : version(0), auxState(AuxNone){
+            OID = 0;
             serialized = NULL;
         }
 
@@ -43,22 +101,82 @@ class BasicArrayObject{
         * Constructor Method.
         * Sets the values of the vector to current.
         */
-        BasicArrayObject(const uint32_t OID, const std::vector<DType> &data){
+        BasicArrayObject(const uint32_t OID, const std::vector<DType> &data) : data(data), version(0), auxState(AuxNone){
+
+            this->OID = OID;
+            serialized = NULL;
+        }
+
+        /**
+        * Constructor Method.
+        * Takes over the values of the vector, without copying them.
+        */
+        BasicArrayObject(const uint32_t OID, std::vector<DType> &&data) : data(std::move(data)), version(0), auxState(AuxNone){
 
             this->OID = OID;
-            for(int x = 0; x < data.size(); x++)
-                set(data[x]);
             serialized = NULL;
         }
 
+        /**
+        * Copy constructor. The serialized version is not shared: the copy
+        * builds its own when asked for it. The content version is, as long
+        * as neither is changed.
+        */
+        BasicArrayObject(const BasicArrayObject<DType> &other) : data(other.data), version(other.version.load(std::memory_order_relaxed)){
+
+            OID = other.OID;
+            serialized = NULL;
+            copyAuxiliaries(other);
+        }
+
+        /**
+        * Move constructor. The storage and the serialized version are taken
+        * over, and other is left empty.
+        */
+        BasicArrayObject(BasicArrayObject<DType> &&other) noexcept : data(std::move(other.data)), version(other.version.load(std::memory_order_relaxed)){
+
+            OID = other.OID;
+            serialized = other.serialized;
+            copyAuxiliaries(other);
+            other.serialized = NULL;
+            other.version.store(0, std::memory_order_relaxed);
+            other.auxState.store(AuxNone, std::memory_order_relaxed);
+        }
+
+        BasicArrayObject<DType> &operator=(const BasicArrayObject<DType> &other){
+
+            if (this != &other){
+                invalidate();
+                data = other.data;
+                OID = other.OID;
+                version.store(other.version.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                copyAuxiliaries(other);
+            }
+            return *this;
+        }
+
+        BasicArrayObject<DType> &operator=(BasicArrayObject<DType> &&other) noexcept{
+
+            if (this != &other){
+                invalidate();
+                data = std::move(other.data);
+                OID = other.OID;
+                serialized = other.serialized;
+                version.store(other.version.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                copyAuxiliaries(other);
+                other.serialized = NULL;
+                other.version.store(0, std::memory_order_relaxed);
+                other.auxState.store(AuxNone, std::memory_order_relaxed);
+            }
+            return *this;
+        }
+
         /**
         * Destructor.
         */
         ~BasicArrayObject(){
 
-            data.clear();
-            if (serialized != NULL)
-                delete[] serialized;
+            invalidate();
         }
 
         /**
@@ -78,6 +196,7 @@ class BasicArrayObject{
         */
         void setOID(uint32_t OID){
             this->OID = OID;
+            invalidate();
         }
 
         /**
@@ -98,45 +217,81 @@ class BasicArrayObject{
             return getOID();
         }
 
+        /**
+        * Gets a number identifying the current contents (OID and data): it
+        * changes whenever they may have changed, and is only shared with
+        * copies that were not changed since. Caches of values computed from
+        * the feature vector (e.g. DistanceCache) compare it to tell whether
+        * they are stale. Writes through a pointer or reference obtained
+        * before the call are not seen.
+        * @return A process-wide unique version, never 0.
+        */
+        uint64_t getVersion() const{
+
+            uint64_t v = version.load(std::memory_order_relaxed);
+            if (v == 0){
+                uint64_t fresh = lastFeatureVectorVersion().fetch_add(1, std::memory_order_relaxed) + 1;
+                if (version.compare_exchange_strong(v, fresh, std::memory_order_relaxed))
+                    v = fresh;
+            }
+            return v;
+        }
+
+        /**
+        * Gets the per-vector terms used by CosineDistance, BrayCurtisDistance
+        * and JeffreyDivergence. They are computed on the first call after
+        * any change, e.g. once after unserialize(), and kept until the next
+        * change. Safe to call from several threads at once.
+        * @return The terms of the current data.
+        */
+        VectorAuxiliaries getAuxiliaries() const{
+
+            if (auxState.load(std::memory_order_acquire) == AuxReady)
+                return auxiliaries;
+
+            VectorAuxiliaries aux = VectorAuxiliaries::compute(getRawData(), data.size());
+            uint8_t expected = AuxNone;
+            // One thread publishes; the others just use their own copy.
+            if (auxState.compare_exchange_strong(expected, AuxBusy, std::memory_order_acquire)){
+                auxiliaries = aux;
+                auxState.store(AuxReady, std::memory_order_release);
+            }
+            return aux;
+        }
+
         /**
         * Re-sizes a Basic Array Object.
-        * All previous stored values are cleaned according to previous size.
+        * The first min(size, getSize()) values are kept and new elements
+        * are value-initialized (0 for arithmetic types).
         * @param size The new Basic Array size.
         */
         void resize(uint32_t size){
 
-            DType aux2;
-            std::vector<DType> aux;
-            for (uint32_t x = 0; x < std::min((size_t) size, data.size()); x++){
-                aux.push_back(data[x]);
-            }
-            data.clear();
-            aux.clear();
-            data = aux;
-            for (uint32_t x = std::min((size_t) size, data.size()); x < size; x++){
-                data.push_back(aux2);
-            }
+            data.resize(size);
+            invalidate();
         }
 
         /**
         * Re-sizes a Basic Array Object.
-        * All previous stored values are cleaned according to previous size.
+        * The first min(size, getSize()) values are kept.
         * New elements receives 'value' as the default value.
         * @param size The new Basic Array size.
         * @param value The default value to be set.
         */
         void resize(uint32_t size, DType value){
 
-            std::vector<DType> aux;
-            for (uint32_t x = 0; x < std::min((size_t) size, data.size()); x++){
-                aux.push_back(data[x]);
-            }
-            data.clear();
-            aux.clear();
-            data = aux;
-            for (uint32_t x = std::min((size_t) size, data.size()); x < size; x++){
-                data.push_back(value);
-            }
+            data.resize(size, value);
+            invalidate();
+        }
+
+        /**
+        * Makes room for size elements, so that adding up to them does not
+        * reallocate.
+        * @param size The expected number of elements.
+        */
+        void reserve(uint32_t size){
+
+            data.reserve(size);
         }
 
 
@@ -161,6 +316,7 @@ class BasicArrayObject{
         */
         void set(DType value){
             data.push_back(value);
+            invalidate();
         }
 
         /**
@@ -174,7 +330,7 @@ class BasicArrayObject{
 
         /**
         * Sets a specific value in a specific position.
-        * @todo Throw a out-of-bounds exception.
+        * Positions between the current size and pos are value-initialized.
         * @param pos The position of the insertion.
         * @param value The value to be pushed.
         */
@@ -184,27 +340,61 @@ class BasicArrayObject{
                 data.push_back(value);
             } else {
                 if (pos > data.size()){
-                    DType aux;
-                    for (int x = 0; x < (pos-data.size()); x++)
-                        data.push_back(aux);
-                    data[pos] = value;
-                } else {
-                    data[pos] = value;
+                    data.resize(pos + 1);
                 }
+                data[pos] = value;
             }
+            invalidate();
         }
 
         /**
         * Gets the entire stored data.
-        * @return The entire stored data.
+        * @return The entire stored data, without copying it.
         */
-        std::vector<DType> getData(){
+        const std::vector<DType> &getData() const{
 
             return data;
         }
 
         /**
-        * Overloaded operator allowing modifications.
+        * Gets a pointer to the contiguous stored data, as used by the
+        * vectorized distance kernels.
+        * @return The address of the first element (NULL if empty).
+        */
+        const DType *getRawData() const{
+
+            return data.empty() ? NULL : &data[0];
+        }
+
+        /**
+        * Gets a writable pointer to the contiguous stored data, e.g. to fill
+        * a vector resized beforehand. Drops the serialized version.
+        * @return The address of the first element (NULL if empty).
+        */
+        DType *getMutableData(){
+
+            invalidate();
+            return data.empty() ? NULL : &data[0];
+        }
+
+        /**
+        * Gets the bounds of the stored data, for range-based loops and
+        * standard algorithms.
+        */
+        const DType *begin() const{
+
+            return getRawData();
+        }
+
+        const DType *end() const{
+
+            return getRawData() + data.size();
+        }
+
+        /**
+        * Overloaded operator allowing modifications. Like any held reference,
+        * writes through it are not seen by getVersion(), serialize() or the
+        * auxiliaries: modify the contents with set() or getMutableData().
         * @param idx The index to be queried.
         */
         DType& operator[] (uint32_t idx) {
@@ -232,6 +422,11 @@ class BasicArrayObject{
             return (&data[idx]);
         }
 
+        const DType *get(uint32_t idx) const{
+
+            return (&data[idx]);
+        }
+
         /**
         * @brief This method is deprecated, but still necessary for arboretum
         * template functions.
@@ -247,12 +442,12 @@ class BasicArrayObject{
         * Gets the number of elements in the feature vector.
         * @return The number of elements of the feature vector.
         */
-        uint32_t getSize(){
+        uint32_t getSize() const{
 
             return data.size();
         }
 
-        uint32_t size(){
+        uint32_t size() const{
 
             return getSize();
         }
@@ -263,7 +458,7 @@ class BasicArrayObject{
         * @deprecated This method is deprecated. Use getSize() instead.
         * @copydoc getSize().
         */
-        uint32_t GetSize(){
+        uint32_t GetSize() const{
 
             return getSize();
         }
@@ -272,7 +467,7 @@ class BasicArrayObject{
         * @deprecated
         * @copydoc getObject().
         */
-        BasicArrayObject<DType> GetObject(){
+        const BasicArrayObject<DType> &GetObject() const{
 
             return getObject();
         }
@@ -281,18 +476,18 @@ class BasicArrayObject{
         * Return the instance of the current Basic Array Object.
         * @return The current instance of Basic Array Object.
         */
-        BasicArrayObject<DType> getObject(){
+        const BasicArrayObject<DType> &getObject() const{
 
-            return this;
+            return *this;
         }
 
         /**
         * Gets an instantied copy of the object.
         * @return A copy of the object.
         */
-        BasicArrayObject<DType> *clone(){
+        BasicArrayObject<DType> *clone() const{
 
-            return new BasicArrayObject<DType>(getOID(), getData());
+            return new BasicArrayObject<DType>(*this);
         }
 
         /**
@@ -301,7 +496,7 @@ class BasicArrayObject{
         * @deprecated This method is deprecated. Use clone() instead.
         * @copydoc clone().
         */
-        BasicArrayObject<DType> *Clone(){
+        BasicArrayObject<DType> *Clone() const{
 
             return clone();
         }
@@ -311,16 +506,9 @@ class BasicArrayObject{
         * @param obj The object to be compared.
         * @return True if the objects are equal, else otherwise.
         */
-        bool isEqual(BasicArrayObject<DType> *obj){
-
-            if ((getOID() != obj->GetOID()) || (getSize() != obj->GetSize()))
-                return false;
+        bool isEqual(const BasicArrayObject<DType> *obj) const{
 
-            for (int x = 0; x < getSize(); x++)
-                if (*(this->get(x)) != *((DType*) (obj->Get(x))))
-                    return false;
-
-            return true;
+            return (getOID() == obj->getOID()) && (data == obj->data);
         }
 
         /**
@@ -329,7 +517,7 @@ class BasicArrayObject{
         * @deprecated This method is deprecated. Use isEqual(stObject *obj) instead.
         * @copydoc isEqual(stObject *obj).
         */
-        bool IsEqual(BasicArrayObject<DType> *obj){
+        bool IsEqual(const BasicArrayObject<DType> *obj) const{
 
             return isEqual(obj);
         }
@@ -338,7 +526,7 @@ class BasicArrayObject{
         * Gets the size of the byte vector.
         * @return The size of the bytes vector.
         */
-        uint32_t getSerializedSize(){
+        uint32_t getSerializedSize() const{
 
             return (sizeof(uint32_t) + sizeof(uint32_t) +  (sizeof(DType) * data.size()));
         }
@@ -349,13 +537,14 @@ class BasicArrayObject{
         * @deprecated This method is deprecated. Use getSerializedSize() instead.
         * @copydoc getSerializedSize().
         */
-        uint32_t GetSerializedSize(){
+        uint32_t GetSerializedSize() const{
 
             return getSerializedSize();
         }
 
         /**
         * Gets the equivalent byte vector of the object.
+        * The result is cached until the object changes.
         * @return The equivalent byte vector of the object.
         */
         const unsigned char *serialize(){
@@ -365,8 +554,8 @@ class BasicArrayObject{
                 uint32_t size = getSize();
                 memcpy(serialized, &OID, sizeof(uint32_t));
                 memcpy(serialized + sizeof(uint32_t), &size, sizeof(uint32_t));
-                for (uint32_t x = 0; x < size; x++){
-                    memcpy(serialized + sizeof(uint32_t) + sizeof(uint32_t)+(sizeof(DType)*x), &data[x], sizeof(DType));
+                if (size > 0){
+                    memcpy(serialized + sizeof(uint32_t) + sizeof(uint32_t), &data[0], sizeof(DType) * size);
                 }
             }
             return serialized;
@@ -389,14 +578,8 @@ class BasicArrayObject{
         */
         std::string serializeToString(){
 
-            std::string answer;
-
             serialize();
-            for (int x = 0; x < getSerializedSize(); x++){
-                answer += serialized[x];
-            }
-
-            return answer;
+            return std::string((const char *) serialized, getSerializedSize());
         }
 
         /**
@@ -406,7 +589,6 @@ class BasicArrayObject{
         */
         void unserialize(const unsigned char *dataIn, uint32_t dataSize = 0){
 
-            DType *d = 0;
             uint32_t size_vector;
 
             // This is the reverse of Serialize(). So the steps are similar.
@@ -423,26 +605,16 @@ class BasicArrayObject{
                 memcpy(&size_vector, dataIn + sizeof(uint32_t), sizeof(uint32_t));
             }
 
-            d = new DType[size_vector];
-
-            for (uint32_t x = 0; x < size_vector; x++){
-                memcpy(&d[x], dataIn + sizeof(uint32_t) + sizeof(uint32_t) + (sizeof(DType)*x), sizeof(DType));
-            }
-
-            data.clear();
-
-            for (uint32_t x = 0; x < size_vector; x++){
-                data.push_back(d[x]);
+            // The payload is copied in one pass, straight into data. To read
+            // it in place instead, see SerializedArrayView.
+            data.resize(size_vector);
+            if (size_vector > 0){
+                memcpy(&data[0], dataIn + sizeof(uint32_t) + sizeof(uint32_t), sizeof(DType) * size_vector);
             }
 
             // Since we have changed the object contents, we must invalidate the old
-            // serialized version if it exists. In fact we, may copy the given serialized
-            // version of tbe new object to the buffer but we don't want to spend memory.
-            if (serialized != NULL){
-                delete [] serialized;
-                serialized = NULL;
-            }//end if
-            delete[] d;
+            // serialized version if it exists.
+            invalidate();
         }
 
         /**
@@ -460,10 +632,9 @@ class BasicArrayObject{
         /**
         * @copydoc unserialize(const unsigned char *dataIn, uint32_t dataSize).
         */
-        void unserializeFromString(std::string dataIn){
+        void unserializeFromString(const std::string &dataIn){
 
             uint32_t size_vector;
-            DType *d;
 
             // This is the reverse of Serialize(). So the steps are similar.
             // Remember, the format of the serizalized object is
@@ -473,149 +644,135 @@ class BasicArrayObject{
 
             memcpy(&OID, dataIn.c_str(), sizeof(uint32_t));
             memcpy(&size_vector, dataIn.c_str() + sizeof(uint32_t), sizeof(uint32_t));
-            d = new DType[size_vector];
-
-            for (uint32_t x = 0; x < size_vector; x++){
-                memcpy(&d[x], dataIn.c_str() + sizeof(uint32_t) + sizeof(uint32_t) + (sizeof(DType)*x), sizeof(DType));
-            }
-
-            data.clear();
-
-            for (uint32_t x = 0; x < size_vector; x++){
-                data.push_back(d[x]);
+            data.resize(size_vector);
+            if (size_vector > 0){
+                memcpy(&data[0], dataIn.c_str() + sizeof(uint32_t) + sizeof(uint32_t), sizeof(DType) * size_vector);
             }
 
             // Since we have changed the object contents, we must invalidate the old
-            // serialized version if it exists. In fact we, may copy the given serialized
-            // version of tbe new object to the buffer but we don't want to waste memory.
-            if (serialized != NULL){
-                delete [] serialized;
-                serialized = NULL;
-            }//end if
+            // serialized version if it exists.
+            invalidate();
         }
 
-        static std::string base64Chars(){
+        /**
+        * Gets the equivalent Base64 text of the object, as
+        * toBase64(serializeToString()) but without the intermediate string.
+        */
+        std::string serializeToBase64(){
 
-            return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+-";
+            serialize();
+            std::string answer(TextCodec::base64Size(getSerializedSize()), '\0');
+            if (!answer.empty()){
+                TextCodec::encodeBase64(serialized, getSerializedSize(), &answer[0]);
+            }
+            return answer;
         }
 
+        /**
+        * Transform Base64 text, as written by serializeToBase64(), into an
+        * object. The payload is decoded straight into the object storage.
+        * @param text The Base64 text.
+        * @param length The number of characters.
+        * @throw std::invalid_argument If the text is shorter than the object
+        * it describes. The object is left unchanged when the header already
+        * shows it, and otherwise holds partial contents under a new version.
+        */
+        void unserializeFromBase64(const char *text, size_t length){
 
+            // The first 12 characters hold the OID, the size and the first
+            // payload byte; the payload goes on at a group boundary.
+            unsigned char header[2 * sizeof(uint32_t) + 1];
+            uint32_t oid, size_vector;
+            size_t decoded = TextCodec::decodeBase64(text, std::min(length, (size_t) 12), header, sizeof(header));
+            if (decoded < 2 * sizeof(uint32_t)){
+                throw std::invalid_argument("The text does not hold a serialized feature vector.");
+            }
+            memcpy(&oid, header, sizeof(uint32_t));
+            memcpy(&size_vector, header + sizeof(uint32_t), sizeof(uint32_t));
 
-        static bool isBase64(char c){
+            // The size comes from the text: check it before allocating.
+            size_t bytes = sizeof(DType) * (size_t) size_vector;
+            if (TextCodec::base64DecodedSize(length) < 2 * sizeof(uint32_t) + bytes){
+                throw std::invalid_argument("The text does not hold a serialized feature vector.");
+            }
 
-            return (isalnum(c) || (c == '+') || (c == '-'));
+            invalidate();
+            OID = oid;
+            data.resize(size_vector);
+            if (bytes > 0){
+                unsigned char *payload = (unsigned char *) &data[0];
+                payload[0] = header[2 * sizeof(uint32_t)];
+                if (length > 12){
+                    decoded += TextCodec::decodeBase64(text + 12, length - 12, payload + 1, bytes - 1);
+                }
+                if (decoded < 2 * sizeof(uint32_t) + bytes){
+                    throw std::invalid_argument("The text does not hold a serialized feature vector.");
+                }
+            }
         }
 
+        /**
+        * @copydoc unserializeFromBase64(const char *text, size_t length).
+        */
+        void unserializeFromBase64(const std::string &text){
 
-        static std::string toBase64(std::string input){
-
-            unsigned char * bytes_to_encode = (unsigned char *) input.c_str();
-            int in_len = input.size();
-
-            std::string ret;
-            int i = 0;
-            int j = 0;
-            unsigned char char_array_3[3];
-            unsigned char char_array_4[4];
-
-            while (in_len--) {
-                char_array_3[i++] = *(bytes_to_encode++);
-                if (i == 3) {
-                    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-                    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-                    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-                    char_array_4[3] = char_array_3[2] & 0x3f;
+            unserializeFromBase64(text.data(), text.size());
+        }
 
-                    for(i = 0; (i <4) ; i++)
-                        ret += base64Chars()[char_array_4[i]];
-                    i = 0;
-                }
-            }
+        static std::string base64Chars(){
 
-            if (i)
-            {
-                for(j = i; j < 3; j++)
-                    char_array_3[j] = '\0';
+            return TextCodec::base64Alphabet();
+        }
 
-                char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-                char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-                char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-                char_array_4[3] = char_array_3[2] & 0x3f;
+        static bool isBase64(char c){
 
-                for (j = 0; (j < i + 1); j++)
-                    ret += base64Chars()[char_array_4[j]];
+            return TextCodec::base64Value(c) >= 0;
+        }
 
-                while((i++ < 3))
-                    ret += '=';
+        /**
+        * Encodes bytes as Base64 with the alphabet of base64Chars().
+        * @see TextCodec::encodeBase64() to encode into an existing buffer.
+        */
+        static std::string toBase64(const std::string &input){
 
+            std::string ret(TextCodec::base64Size(input.size()), '\0');
+            if (!ret.empty()){
+                TextCodec::encodeBase64((const unsigned char *) input.data(), input.size(), &ret[0]);
             }
-
             return ret;
         }
 
-        static std::string fromHexaDecimal(std::string input){
-
-            static const char* const lut = "0123456789ABCDEF";
-            uint32_t len = input.length();
-            //if (len & 1) throw std::invalid_argument("odd length");
-
-            std::string output;
-            output.reserve(len / 2);
-            for (uint32_t i = 0; i < len; i += 2)
-            {
-                char a = (char) input[i];
-                const char* p = std::lower_bound(lut, lut + 16, a);
-                //if (*p != a) throw std::invalid_argument("not a hex digit");
-
-                char b = input[i + 1];
-                const char* q = std::lower_bound(lut, lut + 16, b);
-                //if (*q != b) throw std::invalid_argument("not a hex digit");
+        /**
+        * Encodes bytes as upper case hexadecimal.
+        */
+        static std::string toHexaDecimal(const std::string &input){
 
-                output.push_back(((p - lut) << 4) | (q - lut));
+            std::string output(2 * input.size(), '\0');
+            if (!output.empty()){
+                TextCodec::encodeHex((const unsigned char *) input.data(), input.size(), &output[0]);
             }
-
             return output;
         }
 
-        static std::string fromBase64(std::string input){
-
-            uint32_t in_len = input.size();
-            uint32_t i = 0;
-            uint32_t j = 0;
-            int in_ = 0;
-            unsigned char char_array_4[4], char_array_3[3];
-            std::string ret;
+        static std::string fromHexaDecimal(const std::string &input){
 
-            while (in_len-- && ( input[in_] != '=') && isBase64(input[in_])) {
-                char_array_4[i++] = input[in_]; in_++;
-                if (i ==4) {
-                    for (i = 0; i <4; i++)
-                        char_array_4[i] = static_cast<unsigned char>(base64Chars().find(char_array_4[i]));
-
-                    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-                    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-                    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-                    for (i = 0; (i < 3); i++)
-                        ret += char_array_3[i];
-                    i = 0;
-                }
+            std::string output((input.size() + 1) / 2, '\0');
+            if (!output.empty()){
+                TextCodec::decodeHex(input.data(), input.size(), (unsigned char *) &output[0]);
             }
+            return output;
+        }
 
-            if (i) {
-                for (j = i; j <4; j++)
-                    char_array_4[j] = 0;
-
-                for (j = 0; j <4; j++)
-                    char_array_4[j] = static_cast<unsigned char>(base64Chars().find(char_array_4[j]));
-
-                char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-                char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-                char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+        /**
+        * Decodes Base64 text up to its first character outside base64Chars().
+        * @see TextCodec::decodeBase64() to decode into an existing buffer.
+        */
+        static std::string fromBase64(const std::string &input){
 
-                for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+            std::string ret(TextCodec::base64DecodedSize(input.size()), '\0');
+            if (!ret.empty()){
+                ret.resize(TextCodec::decodeBase64(input.data(), input.size(), (unsigned char *) &ret[0]));
             }
-
             return ret;
         }
 
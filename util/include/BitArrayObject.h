@@ -0,0 +1,357 @@
+#ifndef BITARRAYOBJECT_H
+#define BITARRAYOBJECT_H
+
+#include <HammingDistance.h>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+* A binary feature vector, one bit per dimension, serialized like
+* BasicArrayObject:
+* +-----+------+------------------+
+* | OID | Size | Bits []          |
+* +-----+------+------------------+
+*
+* Size is the number of bits, and the payload holds ceil(Size / 8) bytes, bit
+* i being bit (i % 8) of byte i / 8. In memory the bits are packed into 64-bit
+* words (bit i in word i / 64), and the bits past the size are kept at zero so
+* that whole words can be compared (see HammingDistance).
+*/
+class BitArrayObject{
+
+    private:
+        std::vector<uint64_t> words;
+        uint32_t bits;
+        uint32_t OID;
+        unsigned char *serialized;
+
+        void invalidate(){
+
+            if (serialized != NULL){
+                delete[] serialized;
+                serialized = NULL;
+            }
+        }
+
+        // The payload bytes and the words of a bit count, without
+        // overflowing near UINT32_MAX.
+        static uint32_t byteCount(uint32_t size){
+
+            return (uint32_t) (((uint64_t) size + 7) / 8);
+        }
+
+        static uint32_t wordCount(uint32_t size){
+
+            return (uint32_t) (((uint64_t) size + 63) / 64);
+        }
+
+    public:
+
+        /**
+        * The word type returned by getRawData().
+        */
+        typedef uint64_t value_type;
+
+        BitArrayObject(){
+            bits = 0;
+            OID = 0;
+            serialized = NULL;
+        }
+
+        /**
+        * Constructor Method.
+        * @param OID The OID of the feature vector.
+        * @param data One bool per dimension.
+        */
+        BitArrayObject(const uint32_t OID, const std::vector<bool> &data){
+
+            this->OID = OID;
+            bits = 0;
+            serialized = NULL;
+            for (size_t x = 0; x < data.size(); x++)
+                add(data[x]);
+        }
+
+        BitArrayObject(const BitArrayObject &other){
+
+            words = other.words;
+            bits = other.bits;
+            OID = other.OID;
+            serialized = NULL;
+        }
+
+        BitArrayObject &operator=(const BitArrayObject &other){
+
+            if (this != &other){
+                invalidate();
+                words = other.words;
+                bits = other.bits;
+                OID = other.OID;
+            }
+            return *this;
+        }
+
+        ~BitArrayObject(){
+
+            invalidate();
+        }
+
+        /**
+        * @deprecated
+        * @copydoc setOID(uint32_t OID).
+        */
+        void SetOID(uint32_t OID){
+
+            setOID(OID);
+        }
+
+        void setOID(uint32_t OID){
+
+            this->OID = OID;
+            invalidate();
+        }
+
+        uint32_t getOID() const{
+
+            return OID;
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use getOID() instead.
+        */
+        uint32_t GetOID() const{
+
+            return getOID();
+        }
+
+        /**
+        * Re-sizes the vector, keeping the first bits and clearing new ones.
+        * @param size The new number of bits.
+        */
+        void resize(uint32_t size){
+
+            words.resize(wordCount(size), 0);
+            bits = size;
+            if (bits % 64 != 0)
+                words.back() &= (((uint64_t) 1) << (bits % 64)) - 1;
+            invalidate();
+        }
+
+        /**
+        * Appends a bit.
+        */
+        void add(bool value){
+
+            set(bits, value);
+        }
+
+        void set(bool value){
+
+            add(value);
+        }
+
+        /**
+        * Sets a bit, growing the vector with zeros up to pos if needed.
+        * @param pos The bit position.
+        * @param value The bit value.
+        * @throw std::length_error If pos is UINT32_MAX, past the largest size.
+        */
+        void set(uint32_t pos, bool value){
+
+            if (pos == UINT32_MAX)
+                throw std::length_error("The bit position exceeds the maximum size.");
+            if (pos >= bits)
+                resize(pos + 1);
+            if (value){
+                words[pos / 64] |= ((uint64_t) 1) << (pos % 64);
+            } else {
+                words[pos / 64] &= ~(((uint64_t) 1) << (pos % 64));
+            }
+            invalidate();
+        }
+
+        void Set(uint32_t pos, bool value){
+
+            set(pos, value);
+        }
+
+        bool get(uint32_t pos) const{
+
+            return (words[pos / 64] >> (pos % 64)) & 1;
+        }
+
+        bool operator[](uint32_t idx) const{
+
+            return get(idx);
+        }
+
+        /**
+        * Gets the packed words, ceil(size() / 64) of them.
+        * @return The words, or NULL for an empty vector.
+        */
+        const uint64_t *getRawData() const{
+
+            return words.empty() ? NULL : &words[0];
+        }
+
+        uint32_t getWordCount() const{
+
+            return words.size();
+        }
+
+        /**
+        * Gets the number of bits.
+        */
+        uint32_t size() const{
+
+            return bits;
+        }
+
+        uint32_t getSize() const{
+
+            return size();
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use getSize() instead.
+        */
+        uint32_t GetSize() const{
+
+            return size();
+        }
+
+        /**
+        * Counts the bits set.
+        */
+        uint32_t count() const{
+
+            uint64_t c = 0;
+            for (size_t x = 0; x < words.size(); x++)
+                c += DistanceKernels::popcount(words[x]);
+            return c;
+        }
+
+        BitArrayObject *clone() const{
+
+            return new BitArrayObject(*this);
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use clone() instead.
+        */
+        BitArrayObject *Clone() const{
+
+            return clone();
+        }
+
+        bool isEqual(const BitArrayObject *obj) const{
+
+            return (OID == obj->OID) && (bits == obj->bits) && (words == obj->words);
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use isEqual() instead.
+        */
+        bool IsEqual(const BitArrayObject *obj) const{
+
+            return isEqual(obj);
+        }
+
+        uint32_t getSerializedSize() const{
+
+            return sizeof(uint32_t) + sizeof(uint32_t) + byteCount(bits);
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use getSerializedSize() instead.
+        */
+        uint32_t GetSerializedSize() const{
+
+            return getSerializedSize();
+        }
+
+        /**
+        * Gets the equivalent byte vector of the object.
+        * @return The equivalent byte vector of the object.
+        */
+        const unsigned char *serialize(){
+
+            if (serialized == NULL){
+                serialized = new unsigned char[getSerializedSize()];
+                memcpy(serialized, &OID, sizeof(uint32_t));
+                memcpy(serialized + sizeof(uint32_t), &bits, sizeof(uint32_t));
+                unsigned char *payload = serialized + 2 * sizeof(uint32_t);
+                for (uint32_t x = 0; x < byteCount(bits); x++)
+                    payload[x] = (unsigned char) (words[x / 8] >> (8 * (x % 8)));
+            }
+            return serialized;
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use serialize() instead.
+        */
+        const unsigned char *Serialize(){
+
+            return serialize();
+        }
+
+        std::string serializeToString(){
+
+            serialize();
+            return std::string((const char *) serialized, getSerializedSize());
+        }
+
+        /**
+        * Transform a byte vector into an object.
+        * @param dataIn The byte vector.
+        * @param dataSize The byte vector size, or 0 to trust the header. The
+        * bit count is always read from the header, and must fit in it.
+        * @throw std::invalid_argument If dataSize is too small for the header
+        * or for the bits it announces.
+        */
+        void unserialize(const unsigned char *dataIn, uint32_t dataSize = 0){
+
+            uint32_t oid, size;
+            if ((dataSize != 0) && (dataSize < 2 * sizeof(uint32_t)))
+                throw std::invalid_argument("The byte vector does not hold a serialized feature vector.");
+            memcpy(&oid, dataIn, sizeof(uint32_t));
+            memcpy(&size, dataIn + sizeof(uint32_t), sizeof(uint32_t));
+            if ((dataSize != 0) && (byteCount(size) > dataSize - 2 * sizeof(uint32_t)))
+                throw std::invalid_argument("The byte vector does not hold a serialized feature vector.");
+
+            OID = oid;
+            words.assign(wordCount(size), 0);
+            bits = size;
+            const unsigned char *payload = dataIn + 2 * sizeof(uint32_t);
+            for (uint32_t x = 0; x < byteCount(bits); x++)
+                words[x / 8] |= ((uint64_t) payload[x]) << (8 * (x % 8));
+            if (bits % 64 != 0)
+                words.back() &= (((uint64_t) 1) << (bits % 64)) - 1;
+
+            invalidate();
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use unserialize() instead.
+        */
+        void Unserialize(const unsigned char *dataIn, uint32_t dataSize = 0){
+
+            unserialize(dataIn, dataSize);
+        }
+
+        void unserializeFromString(const std::string &dataIn){
+
+            unserialize((const unsigned char *) dataIn.data(), dataIn.size());
+        }
+};
+
+template <>
+struct BitPacked<BitArrayObject>{
+    static const bool value = true;
+};
+
+#endif // BITARRAYOBJECT_H
@@ -0,0 +1,407 @@
+#ifndef BULKSERIALIZER_H
+#define BULKSERIALIZER_H
+
+#include <BasicArrayObject.h>
+#include <MappedCollection.h>
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+/**
+* The header of a bulk serialized collection. It is followed by the blocks
+* of at most blockRows feature vectors each; every block holds the OIDs of
+* its rows, then their values, row by row or dimension by dimension:
+* +--------+---------------------------+---------------------------+-----
+* | Header | OIDs [r] | Values [r * d] | OIDs [r] | Values [r * d] | ...
+* +--------+---------------------------+---------------------------+-----
+*
+* With blockRows >= count there is a single OID column and a single payload.
+* All fields are in the byte order of the machine that wrote the data, as in
+* MappedCollectionHeader.
+*/
+struct BulkHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t endianness;
+    uint32_t elementType;
+    uint32_t elementSize;
+    uint32_t layout;
+    uint32_t dimension;
+    uint32_t blockRows;
+    uint64_t count;
+};
+
+/**
+* Writes a whole list of feature vectors at once, into a single buffer or a
+* stream, instead of one serialize() buffer per feature vector. Read it back
+* with BulkReader.
+*
+* Example:
+*   std::ofstream out("export.hbk", std::ios::binary);
+*   BulkSerializer<double>::write(out, list);
+*
+*   std::ifstream in("export.hbk", std::ios::binary);
+*   BulkReader<double> reader(in);
+*   FeatureVectorList batch;
+*   while (reader.read(batch, 1024) > 0)
+*       process(batch);
+*
+* @arg DType The data type of each position.
+*/
+template <class DType = double>
+class BulkSerializer{
+
+    public:
+        static const uint32_t Version = 1;
+        static const uint32_t DefaultBlockRows = 1024;
+        // Rows moved together between the layouts.
+        static const uint32_t TransposeTile = 16;
+
+        enum Layout{
+            // The values of a block row after row.
+            ROW_MAJOR = 0,
+            // The values of a block dimension after dimension, e.g. for
+            // better compression of the exported files.
+            DIMENSION_MAJOR = 1
+        };
+
+    private:
+        struct StreamSink{
+            std::ostream *out;
+            void write(const void *p, size_t n){
+                out->write((const char *) p, n);
+            }
+        };
+
+        struct BufferSink{
+            unsigned char *p;
+            void write(const void *q, size_t n){
+                memcpy(p, q, n);
+                p += n;
+            }
+        };
+
+    public:
+
+        /**
+        * Gets the number of bytes written for a collection; it does not depend
+        * on the layout or the block size.
+        * @param count The number of feature vectors.
+        * @param dimension Their size.
+        */
+        static uint64_t getSerializedSize(uint64_t count, uint32_t dimension){
+
+            return sizeof(BulkHeader) + count * (sizeof(uint32_t) + (uint64_t) dimension * sizeof(DType));
+        }
+
+        /**
+        * Serializes a collection into a single buffer.
+        * @param list The feature vectors, all of the same size.
+        * @param layout The layout of the values of each block.
+        * @param blockRows The number of feature vectors per block.
+        * @throw std::length_error If the feature vectors differ in size.
+        */
+        static std::vector<unsigned char> serialize(std::vector< BasicArrayObject<DType> > &list, Layout layout = ROW_MAJOR, uint32_t blockRows = DefaultBlockRows){
+
+            std::vector<unsigned char> buffer;
+            serialize(list, buffer, layout, blockRows);
+            return buffer;
+        }
+
+        /**
+        * @copydoc serialize(std::vector< BasicArrayObject<DType> > &list, Layout layout, uint32_t blockRows).
+        * @param buffer Receives the data; its storage is reused.
+        */
+        static void serialize(std::vector< BasicArrayObject<DType> > &list, std::vector<unsigned char> &buffer, Layout layout = ROW_MAJOR, uint32_t blockRows = DefaultBlockRows){
+
+            uint32_t dimension = checkDimension(list);
+            buffer.resize(getSerializedSize(list.size(), dimension));
+            BufferSink sink = {buffer.data()};
+            writeTo(sink, list, dimension, layout, blockRows);
+        }
+
+        /**
+        * Writes a collection to a stream, one block at a time.
+        * @param out A binary stream.
+        * @param list The feature vectors, all of the same size.
+        * @param layout The layout of the values of each block.
+        * @param blockRows The number of feature vectors per block.
+        * @throw std::length_error If the feature vectors differ in size.
+        * @throw std::runtime_error If the stream fails.
+        */
+        static void write(std::ostream &out, std::vector< BasicArrayObject<DType> > &list, Layout layout = ROW_MAJOR, uint32_t blockRows = DefaultBlockRows){
+
+            uint32_t dimension = checkDimension(list);
+            StreamSink sink = {&out};
+            writeTo(sink, list, dimension, layout, blockRows);
+            if (!out)
+                throw std::runtime_error("Cannot write the serialized collection.");
+        }
+
+    private:
+
+        static uint32_t checkDimension(std::vector< BasicArrayObject<DType> > &list){
+
+            uint32_t dimension = list.empty() ? 0 : list[0].size();
+            for (size_t x = 1; x < list.size(); x++)
+                if (list[x].size() != dimension)
+                    throw std::length_error("The feature vectors do not have the same size.");
+            return dimension;
+        }
+
+        template <class Sink>
+        static void writeTo(Sink &sink, std::vector< BasicArrayObject<DType> > &list, uint32_t dimension, Layout layout, uint32_t blockRows){
+
+            BulkHeader h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, "HERMESBK", 8);
+            h.version = Version;
+            h.headerSize = sizeof(BulkHeader);
+            h.endianness = MappedCollection<DType>::EndiannessMark;
+            h.elementType = MappedCollection<DType>::getElementType();
+            h.elementSize = sizeof(DType);
+            h.layout = layout;
+            h.dimension = dimension;
+            h.blockRows = std::max(1u, blockRows);
+            h.count = list.size();
+            sink.write(&h, sizeof(h));
+
+            std::vector<uint32_t> oids;
+            std::vector<DType> values;
+            for (size_t first = 0; first < list.size(); first += h.blockRows){
+                size_t rows = std::min((size_t) h.blockRows, list.size() - first);
+                oids.resize(rows);
+                for (size_t r = 0; r < rows; r++)
+                    oids[r] = list[first + r].getOID();
+                sink.write(oids.data(), rows * sizeof(uint32_t));
+
+                if (dimension == 0)
+                    continue;
+                if (layout == ROW_MAJOR){
+                    for (size_t r = 0; r < rows; r++)
+                        sink.write(list[first + r].getRawData(), dimension * sizeof(DType));
+                } else {
+                    values.resize(rows * dimension);
+                    const DType *tileRows[TransposeTile];
+                    for (size_t t = 0; t < rows; t += TransposeTile){
+                        size_t tile = std::min((size_t) TransposeTile, rows - t);
+                        for (size_t r = 0; r < tile; r++)
+                            tileRows[r] = list[first + t + r].getRawData();
+                        DType *column = &values[t];
+                        for (uint32_t d = 0; d < dimension; d++, column += rows)
+                            for (size_t r = 0; r < tile; r++)
+                                column[r] = tileRows[r][d];
+                    }
+                    sink.write(values.data(), values.size() * sizeof(DType));
+                }
+            }
+        }
+};
+
+/**
+* Reads a bulk serialized collection (see BulkSerializer) in batches, from
+* a stream or a buffer, in a single pass. Row-major blocks are read straight
+* into the feature vectors; dimension-major ones go through one block of
+* values, so memory stays bounded by the block size whatever the collection
+* size.
+*
+* @arg DType The data type of each position.
+*/
+template <class DType = double>
+class BulkReader{
+
+    private:
+        std::istream *in;
+        const unsigned char *data;
+        size_t length, offset;
+
+        BulkHeader header;
+        uint64_t consumed;
+        // The OIDs, and for dimension-major blocks the values, of the block
+        // being read; blockNext of its blockSize rows were returned.
+        std::vector<uint32_t> oids;
+        std::vector<DType> values;
+        size_t blockSize, blockNext;
+
+    public:
+
+        /**
+        * Reads the header from a binary stream.
+        * @throw std::runtime_error If the stream does not hold a collection
+        * written by BulkSerializer for this DType on a machine of the same
+        * byte order.
+        */
+        BulkReader(std::istream &in) : in(&in), data(NULL), length(0), offset(0){
+
+            readHeader();
+        }
+
+        /**
+        * Reads the header from a buffer, which must outlive the reader.
+        * @copydoc BulkReader(std::istream &in).
+        */
+        BulkReader(const unsigned char *data, size_t length) : in(NULL), data(data), length(length), offset(0){
+
+            readHeader();
+        }
+
+        /**
+        * Gets the number of feature vectors of the collection.
+        */
+        uint64_t size() const{
+
+            return header.count;
+        }
+
+        uint32_t getDimension() const{
+
+            return header.dimension;
+        }
+
+        typename BulkSerializer<DType>::Layout getLayout() const{
+
+            return (typename BulkSerializer<DType>::Layout) header.layout;
+        }
+
+        uint32_t getBlockRows() const{
+
+            return header.blockRows;
+        }
+
+        /**
+        * Gets the number of feature vectors not read yet.
+        */
+        uint64_t getRemaining() const{
+
+            return header.count - consumed;
+        }
+
+        /**
+        * Reads the next feature vectors. The feature vectors already in batch
+        * are reused, so reading batches of the same size allocates nothing
+        * after the first one.
+        *
+        * @param batch Receives at most maxRows feature vectors; left as is
+        * at the end.
+        * @param maxRows The batch size.
+        * @return The number of feature vectors read, 0 at the end.
+        * @throw std::runtime_error If the data is truncated.
+        */
+        size_t read(std::vector< BasicArrayObject<DType> > &batch, size_t maxRows){
+
+            size_t rows = std::min((uint64_t) maxRows, getRemaining());
+            if (rows == 0)
+                return 0;
+            batch.resize(rows);
+            uint32_t d = header.dimension;
+            for (size_t x = 0; x < rows; ){
+                if (blockNext == blockSize)
+                    nextBlock();
+                size_t part = std::min(rows - x, blockSize - blockNext);
+                for (size_t r = 0; r < part; r++){
+                    BasicArrayObject<DType> &object = batch[x + r];
+                    object.setOID(oids[blockNext + r]);
+                    if (object.size() != d)
+                        object.resize(d);
+                    if ((d > 0) && (header.layout == BulkSerializer<DType>::ROW_MAJOR))
+                        readBytes(object.getMutableData(), d * sizeof(DType));
+                }
+                if ((d > 0) && (header.layout == BulkSerializer<DType>::DIMENSION_MAJOR))
+                    transpose(&batch[x], part);
+                blockNext += part;
+                consumed += part;
+                x += part;
+            }
+            return rows;
+        }
+
+        /**
+        * Reads every remaining feature vector.
+        * @param list Receives the feature vectors.
+        */
+        void readAll(std::vector< BasicArrayObject<DType> > &list){
+
+            read(list, getRemaining());
+        }
+
+    private:
+
+        void readHeader(){
+
+            consumed = 0;
+            blockSize = blockNext = 0;
+            readBytes(&header, sizeof(header));
+
+            const char *error = NULL;
+            if (memcmp(header.magic, "HERMESBK", 8) != 0)
+                error = "The data is not a serialized collection.";
+            else if (header.endianness != MappedCollection<DType>::EndiannessMark)
+                error = "The collection was written on a machine of another byte order.";
+            else if ((header.version != BulkSerializer<DType>::Version) || (header.headerSize != sizeof(BulkHeader)))
+                error = "The collection has an unsupported version.";
+            else if ((header.elementType != MappedCollection<DType>::getElementType()) || (header.elementSize != sizeof(DType)))
+                error = "The collection holds another element type.";
+            else if ((header.blockRows == 0) || (header.layout > BulkSerializer<DType>::DIMENSION_MAJOR))
+                error = "The collection is corrupt.";
+            else if ((data != NULL) && (BulkSerializer<DType>::getSerializedSize(header.count, header.dimension) > length))
+                error = "The collection is truncated.";
+            if (error != NULL)
+                throw std::runtime_error(error);
+        }
+
+        void nextBlock(){
+
+            blockSize = std::min((uint64_t) header.blockRows, header.count - consumed);
+            blockNext = 0;
+            oids.resize(blockSize);
+            readBytes(oids.data(), blockSize * sizeof(uint32_t));
+            if ((header.layout == BulkSerializer<DType>::DIMENSION_MAJOR) && (header.dimension > 0)){
+                values.resize(blockSize * header.dimension);
+                readBytes(values.data(), values.size() * sizeof(DType));
+            }
+        }
+
+        // Copies the next count rows of the block into objects, a tile of
+        // rows at a time so that both sides are read and written in order.
+        void transpose(BasicArrayObject<DType> *objects, size_t count){
+
+            uint32_t d = header.dimension;
+            DType *rows[BulkSerializer<DType>::TransposeTile];
+            for (size_t first = 0; first < count; first += BulkSerializer<DType>::TransposeTile){
+                size_t tile = std::min((size_t) BulkSerializer<DType>::TransposeTile, count - first);
+                for (size_t r = 0; r < tile; r++)
+                    rows[r] = objects[first + r].getMutableData();
+                const DType *column = &values[blockNext + first];
+                if (tile == BulkSerializer<DType>::TransposeTile){
+                    // A constant trip count, unrolled by the compiler.
+                    for (uint32_t y = 0; y < d; y++, column += blockSize)
+                        for (size_t r = 0; r < BulkSerializer<DType>::TransposeTile; r++)
+                            rows[r][y] = column[r];
+                } else {
+                    for (uint32_t y = 0; y < d; y++, column += blockSize)
+                        for (size_t r = 0; r < tile; r++)
+                            rows[r][y] = column[r];
+                }
+            }
+        }
+
+        void readBytes(void *p, size_t n){
+
+            if (in != NULL){
+                if (!in->read((char *) p, n))
+                    throw std::runtime_error("The collection is truncated.");
+            } else {
+                if (length - offset < n)
+                    throw std::runtime_error("The collection is truncated.");
+                memcpy(p, data + offset, n);
+                offset += n;
+            }
+        }
+};
+
+#endif // BULKSERIALIZER_H
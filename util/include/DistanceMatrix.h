@@ -0,0 +1,376 @@
+#ifndef DISTANCEMATRIX_H
+#define DISTANCEMATRIX_H
+
+#include <Evaluator.h>
+#include <DistanceKernels.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/**
+* Computes all the distances between two feature vector lists (N x M), or
+* within one list (N x N), at once.
+* Both inputs are split into tiles that fit in cache, and the tiles are spread
+* across threads. Euclidean distances use the expansion
+* |a - b|^2 = |a|^2 + |b|^2 - 2 a.b, so that a tile becomes a blocked matrix
+* multiply; every other metric runs the Evaluator batch path tile by tile.
+*
+* The expansion loses precision for vectors much closer to each other than to
+* the origin: the squared distance carries an absolute error of about
+* 2^-52 * d * (|a|^2 + |b|^2). Disable it with setExpansion(false) when that
+* matters.
+*
+* @arg FeatureVector The feature vector type (e.g. BasicArrayObject<double>).
+*/
+template <class FeatureVector>
+class DistanceMatrix{
+
+    public:
+        enum Layout{
+            // Row-major N x N matrix.
+            DENSE = 0,
+            // Upper triangle without the diagonal, row by row (N (N - 1) / 2 values).
+            CONDENSED = 1
+        };
+
+    private:
+        uint16_t types;
+        double minkowskiOrder;
+        uint32_t threads;
+        uint32_t tileSize;
+        bool expansion;
+        uint64_t ndf;
+
+        struct Tile{
+            uint32_t row;
+            uint32_t col;
+        };
+
+    public:
+
+        /**
+        * Constructor.
+        *
+        * @param types The distance function number, as in Evaluator.
+        */
+        DistanceMatrix(uint16_t types = Evaluator<FeatureVector>::EUCLIDEAN){
+
+            setType(types);
+            minkowskiOrder = 2.0;
+            setThreads(0);
+            setTileSize(128);
+            setExpansion(true);
+            resetStatistics();
+        }
+
+        void setType(uint16_t distanceFunction){
+
+            types = distanceFunction;
+        }
+
+        uint16_t getType() const{
+
+            return types;
+        }
+
+        /**
+        * Sets the order p of the MINKOWSKI type, as in Evaluator (2 by default).
+        *
+        * @param p The order.
+        * @throw std::invalid_argument If p is not a positive finite number.
+        */
+        void setMinkowskiOrder(double p){
+
+            MinkowskiDistance<FeatureVector>::checkOrder(p);
+            minkowskiOrder = p;
+        }
+
+        double getMinkowskiOrder() const{
+
+            return minkowskiOrder;
+        }
+
+        /**
+        * Sets the number of worker threads.
+        *
+        * @param n The number of threads, 0 meaning one per hardware thread.
+        */
+        void setThreads(uint32_t n){
+
+            threads = n;
+        }
+
+        uint32_t getThreads() const{
+
+            return threads;
+        }
+
+        /**
+        * Sets the number of rows and columns of a tile.
+        *
+        * @param size The tile size (at least 1).
+        */
+        void setTileSize(uint32_t size){
+
+            tileSize = (size == 0) ? 1 : size;
+        }
+
+        uint32_t getTileSize() const{
+
+            return tileSize;
+        }
+
+        /**
+        * Enables the dot product expansion for Euclidean distances.
+        *
+        * @param enabled False computes each Euclidean distance directly.
+        */
+        void setExpansion(bool enabled){
+
+            expansion = enabled;
+        }
+
+        bool getExpansion() const{
+
+            return expansion;
+        }
+
+        void resetStatistics(){
+
+            ndf = 0;
+        }
+
+        /**
+        * Returns the statistics value.
+        *
+        * @return The number of distances computed since the last reset.
+        */
+        uint64_t getStatistics() const{
+
+            return ndf;
+        }
+
+        /**
+        * Gets the number of values of a condensed N x N matrix.
+        */
+        static uint64_t condensedSize(uint64_t n){
+
+            return (n < 2) ? 0 : n * (n - 1) / 2;
+        }
+
+        /**
+        * Gets the position of the pair (i, j), i < j, in a condensed N x N matrix.
+        */
+        static uint64_t condensedIndex(uint64_t i, uint64_t j, uint64_t n){
+
+            return i * n - (i * (i + 1)) / 2 + (j - i - 1);
+        }
+
+        /**
+        * Computes the N x M distances between two lists.
+        *
+        * @param rows The N feature vectors of the rows.
+        * @param cols The M feature vectors of the columns.
+        * @param out Receives the row-major N x M matrix.
+        */
+        void compute(std::vector<FeatureVector> &rows, std::vector<FeatureVector> &cols, double *out){
+
+            run(rows, cols, false, DENSE, out);
+        }
+
+        /**
+        * Computes the N x N distances within a list, each pair once.
+        *
+        * @param objects The N feature vectors.
+        * @param out Receives N x N values for DENSE, or condensedSize(N) for CONDENSED.
+        * @param layout The output layout.
+        */
+        void compute(std::vector<FeatureVector> &objects, double *out, Layout layout = DENSE){
+
+            run(objects, objects, true, layout, out);
+        }
+
+    private:
+
+        void run(std::vector<FeatureVector> &rows, std::vector<FeatureVector> &cols, bool symmetric, Layout layout, double *out){
+
+            if (rows.empty() || cols.empty())
+                return;
+
+            uint32_t d = rows[0].size();
+            for (size_t x = 0; x < rows.size(); x++)
+                if (rows[x].size() != d)
+                    throw std::length_error("The feature vectors do not have the same size.");
+            for (size_t x = 0; x < cols.size(); x++)
+                if (cols[x].size() != d)
+                    throw std::length_error("The feature vectors do not have the same size.");
+
+            std::vector<Tile> tiles;
+            for (uint32_t i = 0; i < rows.size(); i += tileSize){
+                for (uint32_t j = (symmetric ? i : 0); j < cols.size(); j += tileSize){
+                    Tile t;
+                    t.row = i;
+                    t.col = j;
+                    tiles.push_back(t);
+                }
+            }
+
+            bool useExpansion = expansion && (getType() == Evaluator<FeatureVector>::EUCLIDEAN) && !BitPacked<FeatureVector>::value;
+            std::vector<double> rowNorms, colNorms;
+            if (useExpansion){
+                squaredNorms(rows, rowNorms);
+                if (symmetric){
+                    colNorms = rowNorms;
+                } else {
+                    squaredNorms(cols, colNorms);
+                }
+            }
+
+            uint32_t workers = threads;
+            if (workers == 0)
+                workers = std::thread::hardware_concurrency();
+            if (workers == 0)
+                workers = 1;
+            if (workers > tiles.size())
+                workers = tiles.size();
+
+            std::atomic<size_t> next(0);
+            std::atomic<uint64_t> computed(0);
+            Job job = {this, &rows, &cols, &rowNorms, &colNorms, &tiles, &next, &computed, symmetric, useExpansion, layout, out};
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+            workers = 1;
+#endif
+            // Workers take tiles from a shared counter, so whatever threads
+            // could not be started leave their tiles to the calling thread.
+            std::vector<std::exception_ptr> errors(workers);
+            auto body = [&job, &errors](uint32_t t){
+                try {
+                    work(job);
+                } catch (...){
+                    errors[t] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> pool;
+            pool.reserve(workers);
+            for (uint32_t x = 1; x < workers; x++){
+                try {
+                    pool.emplace_back(body, x);
+                } catch (std::system_error &){
+                    // No more threads on this platform.
+                    break;
+                }
+            }
+            body(0);
+            for (size_t x = 0; x < pool.size(); x++)
+                pool[x].join();
+
+            ndf += computed.load();
+            for (uint32_t x = 0; x < workers; x++)
+                if (errors[x])
+                    std::rethrow_exception(errors[x]);
+        }
+
+        struct Job{
+            DistanceMatrix *owner;
+            std::vector<FeatureVector> *rows;
+            std::vector<FeatureVector> *cols;
+            const std::vector<double> *rowNorms;
+            const std::vector<double> *colNorms;
+            const std::vector<Tile> *tiles;
+            std::atomic<size_t> *next;
+            std::atomic<uint64_t> *computed;
+            bool symmetric;
+            bool expansion;
+            Layout layout;
+            double *out;
+        };
+
+        static void work(Job job){
+
+            uint32_t size = job.owner->tileSize;
+            std::vector<double> block((size_t) size * size);
+            std::vector<double> panel(DistanceKernels::DotPanelSize);
+            Evaluator<FeatureVector> evaluator(job.owner->getType());
+            evaluator.setMinkowskiOrder(job.owner->getMinkowskiOrder());
+            uint64_t computed = 0;
+
+            typedef typename FeatureVector::value_type DType;
+            std::vector<const DType *> rowData(size), colData(size);
+
+            for (size_t t = job.next->fetch_add(1); t < job.tiles->size(); t = job.next->fetch_add(1)){
+                uint32_t i0 = (*job.tiles)[t].row;
+                uint32_t j0 = (*job.tiles)[t].col;
+                uint32_t ni = std::min<size_t>(size, job.rows->size() - i0);
+                uint32_t nj = std::min<size_t>(size, job.cols->size() - j0);
+                uint32_t d = (*job.rows)[0].size();
+
+                if (job.expansion){
+                    for (uint32_t i = 0; i < ni; i++)
+                        rowData[i] = (*job.rows)[i0 + i].getRawData();
+                    for (uint32_t j = 0; j < nj; j++)
+                        colData[j] = (*job.cols)[j0 + j].getRawData();
+                    DistanceKernels::computeDotTile(&rowData[0], ni, &colData[0], nj, d, &block[0], nj, &panel[0]);
+                    for (uint32_t i = 0; i < ni; i++){
+                        for (uint32_t j = 0; j < nj; j++){
+                            double sq = (*job.rowNorms)[i0 + i] + (*job.colNorms)[j0 + j] - 2.0 * block[i * nj + j];
+                            block[i * nj + j] = (sq > 0.0) ? sqrt(sq) : 0.0;
+                        }
+                    }
+                } else {
+                    for (uint32_t i = 0; i < ni; i++)
+                        evaluator.getDistances((*job.rows)[i0 + i], job.cols->begin() + j0, job.cols->begin() + j0 + nj, &block[i * nj]);
+                }
+                computed += (uint64_t) ni * nj;
+                // The Evaluator reports its own distances.
+                if (job.expansion)
+                    DistanceStatistics::count(job.owner->getType(), (uint64_t) ni * nj);
+
+                store(job, i0, j0, ni, nj, &block[0]);
+            }
+
+            job.computed->fetch_add(computed);
+        }
+
+        static void store(const Job &job, uint32_t i0, uint32_t j0, uint32_t ni, uint32_t nj, const double *block){
+
+            uint64_t n = job.rows->size();
+            uint64_t m = job.cols->size();
+
+            for (uint32_t i = 0; i < ni; i++){
+                uint64_t row = i0 + i;
+                for (uint32_t j = 0; j < nj; j++){
+                    uint64_t col = j0 + j;
+                    double v = block[i * nj + j];
+                    if (!job.symmetric){
+                        job.out[row * m + col] = v;
+                    } else if (job.layout == DENSE){
+                        if (row <= col){
+                            // The expansion leaves rounding noise where the
+                            // Euclidean distance is exactly 0; other metrics
+                            // keep their own d(x, x) (e.g. -|x|^2 for DOTPRODUCT).
+                            if ((row == col) && job.expansion)
+                                v = 0.0;
+                            job.out[row * n + col] = v;
+                            job.out[col * n + row] = v;
+                        }
+                    } else if (row < col){
+                        job.out[condensedIndex(row, col, n)] = v;
+                    }
+                }
+            }
+        }
+
+        static void squaredNorms(std::vector<FeatureVector> &objects, std::vector<double> &norms){
+
+            norms.resize(objects.size());
+            for (size_t x = 0; x < objects.size(); x++)
+                norms[x] = DistanceKernels::dotProduct(objects[x].getRawData(), objects[x].getRawData(), objects[x].size());
+        }
+};
+
+#endif // DISTANCEMATRIX_H
@@ -5,14 +5,60 @@
 #include <ManhattanDistance.h>
 #include <ChebyshevDistance.h>
 #include <CanberraDistance.h>
+#include <BrayCurtisDistance.h>
+#include <ChiSquareDistance.h>
+#include <JeffreyDivergence.h>
+#include <HammingDistance.h>
+#include <CosineDistance.h>
+#include <DotProductDistance.h>
+#include <MinkowskiDistance.h>
 #include <BasicArrayObject.h>
-
+#include <BitArrayObject.h>
+#include <DistanceCache.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+* Runtime-selectable distance function.
+* The distance function is resolved once, when the type is set, into direct
+* calls to the static kernels of its class; see MetricEvaluator for a version
+* fixed at compile time.
+*
+* The statistics of an Evaluator count its own calls and are not synchronized;
+* every update is also reported to DistanceStatistics, which is thread-safe
+* and breaks the counts down by metric.
+*
+* A DistanceCache set with setCache() answers repeated getDistance() and
+* getBoundedDistance() calls; the distances found there are not counted.
+*/
 template <class FeatureVector>
 class Evaluator{
 
 private:
+    typedef typename FeatureVector::value_type DType;
+    typedef double (*DistanceKernel)(const DType *, const DType *, size_t);
+    typedef double (*BoundedKernel)(const DType *, const DType *, size_t, double, const uint32_t *);
+    typedef void (*BatchKernel)(const DType *, const DType *const *, size_t, size_t, double *);
+    typedef double (*AuxiliaryKernel)(const DType *, const VectorAuxiliaries &, const DType *, const VectorAuxiliaries &, size_t);
+
     uint16_t types;
-    uint32_t ndf;
+    uint64_t ndf;
+    std::vector<uint32_t> order;
+    DistanceKernel distanceKernel;
+    BoundedKernel boundedKernel;
+    BatchKernel batchKernel;
+    // Set for the metrics that use the VectorAuxiliaries of feature
+    // vectors keeping them, NULL otherwise.
+    AuxiliaryKernel auxiliaryKernel;
+    DistanceCache *cache;
+    double minkowskiOrder;
+    // Set when the Minkowski order has no compile-time kernel: the three
+    // kernels above are then unused.
+    bool minkowskiRuntime;
 
 public:
     static const u_int16_t EUCLIDEAN = 1;
@@ -22,6 +68,10 @@ public:
     static const u_int16_t CANBERRA = 5;
     static const u_int16_t BRAYCURTIS = 6;
     static const u_int16_t QUISQUARE = 7;
+    static const u_int16_t HAMMING = 8;
+    static const u_int16_t COSINE = 9;
+    static const u_int16_t DOTPRODUCT = 10;
+    static const u_int16_t MINKOWSKI = 11;
 
 public:
     /**
@@ -30,6 +80,8 @@ public:
     * @param types The distance function number.
     */
     Evaluator(uint16_t types){
+        cache = NULL;
+        minkowskiOrder = 2.0;
         resetStatistics();
         setType(types);
     }
@@ -39,17 +91,21 @@ public:
     *
     */
     Evaluator(){
+        cache = NULL;
+        minkowskiOrder = 2.0;
         resetStatistics();
         setType(0);
     }
 
     /**
-    * Increments the statistics by one.
+    * Increments the statistics.
     *
+    * @param n The number of distance calculations to be accounted.
     */
-    void updateStatistics(){
+    void updateStatistics(uint64_t n = 1){
 
-        ndf++;
+        ndf += n;
+        DistanceStatistics::count(types, n);
     }
 
 
@@ -68,7 +124,7 @@ public:
     *
     * @return The number of distance function calculations.
     */
-    u_int32_t getStatistics(){
+    uint64_t getStatistics(){
 
         return ndf;
     }
@@ -82,6 +138,24 @@ public:
     void setType(uint16_t distanceFunction){
 
         this->types = distanceFunction;
+        minkowskiRuntime = false;
+
+        switch (distanceFunction){
+            case Evaluator::EUCLIDEAN: bind< EuclideanDistance<FeatureVector> >(); break;
+            case Evaluator::CITYBLOCK: bind< ManhattanDistance<FeatureVector> >(); break;
+            case Evaluator::CHEBYSHEV: bind< ChebyshevDistance<FeatureVector> >(); break;
+            case Evaluator::JEFFREY: bind< JeffreyDivergence<FeatureVector> >(); break;
+            case Evaluator::CANBERRA: bind< CanberraDistance<FeatureVector> >(); break;
+            case Evaluator::BRAYCURTIS: bind< BrayCurtisDistance<FeatureVector> >(); break;
+            case Evaluator::QUISQUARE: bind< ChiSquareDistance<FeatureVector> >(); break;
+            case Evaluator::HAMMING: bind< HammingDistance<FeatureVector> >(); break;
+            case Evaluator::COSINE: bind< CosineDistance<FeatureVector> >(); break;
+            case Evaluator::DOTPRODUCT: bind< DotProductDistance<FeatureVector> >(); break;
+            case Evaluator::MINKOWSKI: bindMinkowski(); break;
+            default:
+                // Unknown types keep answering 0.0.
+                unbind();
+        }
     }
 
     void setDistanceFunction(uint16_t distanceFunction){
@@ -106,6 +180,50 @@ public:
     }
 
 
+    /**
+    * Sets the order p of the MINKOWSKI type (2 by default). The orders of
+    * MinkowskiDistance::visitOrder() run compile-time kernels, the other
+    * ones a pow() per dimension. The order is part of the DistanceCache key,
+    * so Evaluators of different orders may share a cache.
+    *
+    * @param p The order.
+    * @throw std::invalid_argument If p is not a positive finite number.
+    */
+    void setMinkowskiOrder(double p){
+
+        MinkowskiDistance<FeatureVector>::checkOrder(p);
+        minkowskiOrder = p;
+        if (types == Evaluator::MINKOWSKI)
+            setType(types);
+    }
+
+
+    double getMinkowskiOrder() const{
+
+        return minkowskiOrder;
+    }
+
+
+    /**
+    * Puts a cache in front of getDistance() and getBoundedDistance(). It is
+    * only used with feature vectors numbering their contents (see
+    * BasicArrayObject::getVersion()), and may be shared by several
+    * Evaluators and threads.
+    *
+    * @param cache The cache, or NULL to compute every distance.
+    */
+    void setCache(DistanceCache *cache){
+
+        this->cache = cache;
+    }
+
+
+    DistanceCache *getCache() const{
+
+        return cache;
+    }
+
+
     /**
     * Calculates the similarity between two feature vectors.
     *
@@ -124,25 +242,313 @@ public:
     */
     double GetDistance(FeatureVector *obj1, FeatureVector *obj2){
 
+        if constexpr (Versioned<FeatureVector>::value){
+            if (cache != NULL){
+                uint64_t v1 = obj1->getVersion(), v2 = obj2->getVersion();
+                double d;
+                if (cache->lookup(types, obj1->getOID(), v1, obj2->getOID(), v2, d, cacheVariant()))
+                    return d;
+                d = computeDistance(obj1, obj2);
+                cache->insert(types, obj1->getOID(), v1, obj2->getOID(), v2, d, cacheVariant());
+                return d;
+            }
+        }
+        return computeDistance(obj1, obj2);
+    }
+
+
+    /**
+    * Calculates the distances between a query and a range of candidates.
+    * The distance function is resolved once for the whole range, and the
+    * candidates are compared in groups sharing the query in registers.
+    *
+    * @param query The query feature vector.
+    * @param first The first candidate.
+    * @param last One past the last candidate.
+    * @param out Receives one distance per candidate, in the range order.
+    */
+    template <class Iterator>
+    void getDistances(FeatureVector &query, Iterator first, Iterator last, double *out){
+
+        typedef typename std::decay<decltype(*first)>::type Candidate;
+        uint64_t count = 0;
+        if constexpr (HasAuxiliaries<FeatureVector>::value && HasAuxiliaries<Candidate>::value){
+            if (auxiliaryKernel != NULL){
+                // The batch kernels do not use the VectorAuxiliaries: run the
+                // kernel of getDistance(), so that both agree. Candidates
+                // without them (e.g. views) take the batch kernels.
+                VectorAuxiliaries aux = query.getAuxiliaries();
+                DistanceStatistics::Timer timer(types, std::distance(first, last));
+                for (; first != last; ++first){
+                    if (first->size() != query.size())
+                        throw std::length_error("The feature vectors do not have the same size.");
+                    out[count++] = auxiliaryKernel(query.getRawData(), aux, first->getRawData(), first->getAuxiliaries(), query.size());
+                }
+                updateStatistics(count);
+                return;
+            }
+        }
+
+        const DType *chunk[BatchChunk];
+        while (first != last){
+            uint32_t len = 0;
+            for (; (len < BatchChunk) && (first != last); ++first){
+                if (first->size() != query.size())
+                    throw std::length_error("The feature vectors do not have the same size.");
+                chunk[len++] = first->getRawData();
+            }
+            DistanceStatistics::Timer timer(types, len);
+            if (minkowskiRuntime)
+                MinkowskiDistance<FeatureVector>::computeBatchRuntime(query.getRawData(), chunk, len, query.size(), minkowskiOrder, out + count);
+            else
+                batchKernel(query.getRawData(), chunk, len, query.size(), out + count);
+            count += len;
+        }
+
+        // Update stats
+        updateStatistics(count);
+    }
+
+
+    /**
+    * @copydoc getDistances(FeatureVector &query, Iterator first, Iterator last, double *out).
+    */
+    void GetDistances(FeatureVector *query, FeatureVector *candidates, uint32_t count, double *out){
+
+        getDistances(*query, candidates, candidates + count, out);
+    }
+
+
+    /**
+    * Sets the order in which bounded distances visit the dimensions.
+    * An empty order restores the natural one.
+    *
+    * @param dimensionOrder A permutation of the dimensions, e.g. from varianceOrder().
+    * @throw std::invalid_argument If it is not a permutation of [0, size).
+    */
+    void setDimensionOrder(const std::vector<uint32_t> &dimensionOrder){
+
+        DistanceKernels::checkPermutation(dimensionOrder);
+        order = dimensionOrder;
+    }
+
+
+    /**
+    * Returns the order in which bounded distances visit the dimensions.
+    *
+    * @return The dimension order (empty for the natural one).
+    */
+    const std::vector<uint32_t> &getDimensionOrder() const{
+
+        return order;
+    }
+
+
+    /**
+    * Calculates the distance between two feature vectors, stopping as soon as
+    * it is known to be greater than bound (e.g. the query radius or the
+    * current k-th nearest distance).
+    *
+    * @return The exact distance if it is <= bound, otherwise any value greater than bound.
+    */
+    double getBoundedDistance(FeatureVector &obj1, FeatureVector &obj2, double bound){
+
+        return GetBoundedDistance(&obj1, &obj2, bound);
+    }
+
+
+    /**
+    * @copydoc getBoundedDistance(FeatureVector &obj1, FeatureVector &obj2, double bound).
+    */
+    double GetBoundedDistance(FeatureVector *obj1, FeatureVector *obj2, double bound){
+
+        if constexpr (Versioned<FeatureVector>::value){
+            if (cache != NULL){
+                uint64_t v1 = obj1->getVersion(), v2 = obj2->getVersion();
+                double d;
+                if (cache->lookup(types, obj1->getOID(), v1, obj2->getOID(), v2, d, cacheVariant()))
+                    return d;
+                d = computeBoundedDistance(obj1, obj2, bound);
+                // Only distances within the bound are exact.
+                if (d <= bound)
+                    cache->insert(types, obj1->getOID(), v1, obj2->getOID(), v2, d, cacheVariant());
+                return d;
+            }
+        }
+        return computeBoundedDistance(obj1, obj2, bound);
+    }
+
+
+    /**
+    * Re-ranks the candidates of an approximate search (e.g. from
+    * ScalarQuantizer or ProductQuantizer): their distances are replaced by
+    * the exact ones against the original feature vectors, and the k nearest
+    * are kept, nearest first.
+    *
+    * @param query The query feature vector.
+    * @param objects The original feature vectors.
+    * @param candidates (distance, position in objects) pairs.
+    * @param k The number of candidates to keep.
+    */
+    void rerank(FeatureVector &query, std::vector<FeatureVector> &objects, std::vector< std::pair<double, uint32_t> > &candidates, size_t k){
+
+        for (size_t x = 0; x < candidates.size(); x++)
+            candidates[x].first = getDistance(query, objects[candidates[x].second]);
+
+        k = std::min(k, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+        candidates.resize(k);
+    }
+
+
+    /**
+    * Computes a dimension order for bounded distances: the dimensions with
+    * the highest variance over the sample come first, since they are the
+    * ones most likely to push a partial distance past the bound.
+    *
+    * @param sample A representative set of feature vectors of equal size.
+    * @return A permutation of the dimensions, by decreasing variance.
+    */
+    static std::vector<uint32_t> varianceOrder(const std::vector<FeatureVector> &sample){
+
+        std::vector<uint32_t> dims;
+        if (sample.empty())
+            return dims;
+
+        uint32_t size = sample[0].size();
+        std::vector<double> mean(size, 0.0), m2(size, 0.0);
+
+        // Welford's running variance, one dimension at a time.
+        for (size_t x = 0; x < sample.size(); x++){
+            if (sample[x].size() != size)
+                throw std::length_error("The feature vectors do not have the same size.");
+            for (uint32_t i = 0; i < size; i++){
+                double delta = sample[x][i] - mean[i];
+                mean[i] += delta / (x + 1);
+                m2[i] += delta * (sample[x][i] - mean[i]);
+            }
+        }
+
+        dims.resize(size);
+        for (uint32_t i = 0; i < size; i++)
+            dims[i] = i;
+        std::stable_sort(dims.begin(), dims.end(), VarianceGreater(m2));
+
+        return dims;
+    }
+
+private:
+    static const uint32_t BatchChunk = 256;
+
+    // The DistanceCache variant of the metric: the bits of the order for
+    // MINKOWSKI, 0 otherwise.
+    uint64_t cacheVariant() const{
+
+        uint64_t bits = 0;
+        if (types == Evaluator::MINKOWSKI)
+            std::memcpy(&bits, &minkowskiOrder, sizeof(bits));
+        return bits;
+    }
+
+    double computeDistance(FeatureVector *obj1, FeatureVector *obj2){
+
         // Update stats
         updateStatistics();
 
-        double answer = 0.0;
+        if (obj1->size() != obj2->size())
+            throw std::length_error("The feature vectors do not have the same size.");
 
-        if (getType() == Evaluator::EUCLIDEAN){
-            EuclideanDistance<FeatureVector> d;
-            answer = d.getDistance(*obj1, *obj2);
+        DistanceStatistics::Timer timer(types);
+        if constexpr (HasAuxiliaries<FeatureVector>::value){
+            if (auxiliaryKernel != NULL)
+                return auxiliaryKernel(obj1->getRawData(), obj1->getAuxiliaries(), obj2->getRawData(), obj2->getAuxiliaries(), obj1->size());
         }
-        if (getType() == Evaluator::CITYBLOCK){
-            ManhattanDistance<FeatureVector>  d;
-            answer = d.getDistance(*obj1, *obj2);
+        if (minkowskiRuntime)
+            return MinkowskiDistance<FeatureVector>::computeRuntime(obj1->getRawData(), obj2->getRawData(), obj1->size(), minkowskiOrder);
+        return distanceKernel(obj1->getRawData(), obj2->getRawData(), obj1->size());
+    }
+
+    double computeBoundedDistance(FeatureVector *obj1, FeatureVector *obj2, double bound){
+
+        // Update stats
+        updateStatistics();
+
+        if (obj1->size() != obj2->size())
+            throw std::length_error("The feature vectors do not have the same size.");
+        if (!order.empty() && (order.size() != obj1->size()))
+            throw std::length_error("The dimension order does not match the feature vectors size.");
+
+        const uint32_t *dims = order.empty() ? NULL : order.data();
+        DistanceStatistics::Timer timer(types);
+        if constexpr (HasAuxiliaries<FeatureVector>::value){
+            // The full distance, so that it agrees with getDistance().
+            if (auxiliaryKernel != NULL)
+                return auxiliaryKernel(obj1->getRawData(), obj1->getAuxiliaries(), obj2->getRawData(), obj2->getAuxiliaries(), obj1->size());
+        }
+        if (minkowskiRuntime)
+            return MinkowskiDistance<FeatureVector>::computeBoundedRuntime(obj1->getRawData(), obj2->getRawData(), obj1->size(), minkowskiOrder, bound, dims);
+        return boundedKernel(obj1->getRawData(), obj2->getRawData(), obj1->size(), bound, dims);
+    }
+
+    template <class Metric>
+    void bind(){
+
+        // Bit-packed vectors (e.g. BitArrayObject) only have a Hamming
+        // distance; the other types answer 0.0 like unknown ones.
+        if constexpr (BitPacked<FeatureVector>::value && (Metric::MetricType != HAMMING)){
+            unbind();
+        } else {
+            distanceKernel = &Metric::template compute<DType>;
+            boundedKernel = &Metric::template computeBounded<DType>;
+            batchKernel = &Metric::template computeBatch<DType>;
+            auxiliaryKernel = NULL;
+            if constexpr (HasAuxiliaries<FeatureVector>::value && AuxiliaryMetric<Metric>::value)
+                auxiliaryKernel = &Metric::template computeWithAuxiliaries<DType>;
         }
-        if (getType() == Evaluator::CHEBYSHEV){
-            ChebyshevDistance<FeatureVector>  d;
-            answer = d.getDistance(*obj1, *obj2);
+    }
+
+    void bindMinkowski(){
+
+        bool compiled = MinkowskiDistance<FeatureVector>::visitOrder(minkowskiOrder, [this](auto o){
+            bind< MinkowskiDistance<FeatureVector, decltype(o)::Num, decltype(o)::Den> >();
+        });
+        if (!compiled){
+            unbind();
+            minkowskiRuntime = !BitPacked<FeatureVector>::value;
         }
-        return answer;
     }
+
+    void unbind(){
+
+        distanceKernel = &Evaluator::zeroDistance;
+        boundedKernel = &Evaluator::zeroBoundedDistance;
+        batchKernel = &Evaluator::zeroDistances;
+        auxiliaryKernel = NULL;
+    }
+
+    static double zeroDistance(const DType *, const DType *, size_t){
+
+        return 0.0;
+    }
+
+    static double zeroBoundedDistance(const DType *, const DType *, size_t, double, const uint32_t *){
+
+        return 0.0;
+    }
+
+    static void zeroDistances(const DType *, const DType *const *, size_t count, size_t, double *out){
+
+        std::fill(out, out + count, 0.0);
+    }
+
+    struct VarianceGreater{
+        const std::vector<double> &m2;
+        VarianceGreater(const std::vector<double> &m2) : m2(m2){
+        }
+        bool operator()(uint32_t a, uint32_t b) const{
+            return m2[a] > m2[b];
+        }
+    };
 };
 
 typedef Evaluator<FeatureVector> WrapperDF;
@@ -0,0 +1,442 @@
+#ifndef FEATUREVECTORSTORE_H
+#define FEATUREVECTORSTORE_H
+
+#include <BasicArrayObject.h>
+#include <DistanceKernels.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <stdint.h>
+#include <vector>
+
+/**
+* A non-owning view of one feature vector of a FeatureVectorStore (or of any
+* array of values). It has the interface the distance functions, Evaluator
+* and MetricEvaluator need from a feature vector: size(), getRawData(),
+* getOID() and operator[].
+*
+* @arg DType The data type of each position.
+*/
+template <class DType>
+class FeatureVectorView{
+
+    private:
+        const DType *data;
+        uint32_t dimension;
+        uint32_t OID;
+
+    public:
+
+        typedef DType value_type;
+
+        FeatureVectorView(){
+            data = NULL;
+            dimension = 0;
+            OID = 0;
+        }
+
+        FeatureVectorView(uint32_t OID, const DType *data, uint32_t dimension){
+            this->OID = OID;
+            this->data = data;
+            this->dimension = dimension;
+        }
+
+        uint32_t getOID() const{
+            return OID;
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use getOID() instead.
+        */
+        uint32_t GetOID() const{
+            return getOID();
+        }
+
+        uint32_t size() const{
+            return dimension;
+        }
+
+        uint32_t getSize() const{
+            return dimension;
+        }
+
+        const DType *getRawData() const{
+            return data;
+        }
+
+        const DType &operator[](uint32_t idx) const{
+            return data[idx];
+        }
+
+        /**
+        * Copies the viewed values into an owning feature vector.
+        */
+        BasicArrayObject<DType> getObject() const{
+            BasicArrayObject<DType> obj;
+            obj.setOID(OID);
+            obj.resize(dimension);
+            std::copy(data, data + dimension, obj.getMutableData());
+            return obj;
+        }
+};
+
+/**
+* Iterates over the rows of a collection as views, for
+* Evaluator::getDistances() and similar range-based calls. The collection
+* must provide a View typedef and getView(i).
+*/
+template <class Collection>
+class FeatureVectorIterator{
+
+    private:
+        const Collection *collection;
+        size_t index;
+        mutable typename Collection::View view;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename Collection::View value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef const value_type &reference;
+
+        FeatureVectorIterator(const Collection *collection = NULL, size_t index = 0){
+            this->collection = collection;
+            this->index = index;
+        }
+
+        const value_type &operator*() const{
+            view = collection->getView(index);
+            return view;
+        }
+
+        const value_type *operator->() const{
+            return &operator*();
+        }
+
+        FeatureVectorIterator &operator++(){
+            index++;
+            return *this;
+        }
+
+        FeatureVectorIterator operator+(size_t n) const{
+            return FeatureVectorIterator(collection, index + n);
+        }
+
+        bool operator==(const FeatureVectorIterator &other) const{
+            return index == other.index;
+        }
+
+        bool operator!=(const FeatureVectorIterator &other) const{
+            return index != other.index;
+        }
+};
+
+/**
+* Stores the feature vectors of a collection in one 64-byte aligned buffer,
+* one row per vector, with the OIDs in a parallel array. Scanning it touches
+* memory sequentially instead of following one heap pointer per object.
+*
+* With ROW_MAJOR the rows follow each other with no gap. With PADDED every
+* row starts on a 64-byte boundary and is zero-filled up to it, so no row
+* shares a cache line with another; the padding is never seen by the
+* distance functions.
+*
+* Example:
+*   FeatureVectorStore<double> store(list);
+*   Evaluator<FeatureVector> e(Evaluator<FeatureVector>::EUCLIDEAN);
+*   e.getDistances(query, store.begin(), store.end(), out);
+*
+* @arg DType The data type of each position.
+*/
+template <class DType = double>
+class FeatureVectorStore{
+
+    public:
+        enum Layout{
+            ROW_MAJOR = 0,
+            PADDED = 1
+        };
+
+        static const size_t Alignment = 64;
+
+        typedef FeatureVectorView<DType> View;
+
+        typedef FeatureVectorIterator<FeatureVectorStore> const_iterator;
+
+    private:
+        DType *buffer;
+        size_t rows;
+        size_t capacity;
+        size_t stride;
+        uint32_t dimension;
+        Layout layout;
+        std::vector<uint32_t> oids;
+
+    public:
+
+        /**
+        * Constructor.
+        *
+        * @param dimension The number of values of every vector (0 takes the
+        * size of the first vector added).
+        * @param layout How rows are laid out.
+        */
+        FeatureVectorStore(uint32_t dimension = 0, Layout layout = PADDED){
+
+            init(dimension, layout);
+        }
+
+        /**
+        * Builds a store from a list of feature vectors.
+        */
+        FeatureVectorStore(std::vector< BasicArrayObject<DType> > &list, Layout layout = PADDED){
+
+            init(list.empty() ? 0 : list[0].size(), layout);
+            reserve(list.size());
+            for (size_t x = 0; x < list.size(); x++)
+                add(list[x]);
+        }
+
+        FeatureVectorStore(const FeatureVectorStore &other){
+
+            init(other.dimension, other.layout);
+            reserve(other.rows);
+            if (other.rows > 0)
+                memcpy(buffer, other.buffer, other.rows * stride * sizeof(DType));
+            rows = other.rows;
+            oids = other.oids;
+        }
+
+        FeatureVectorStore &operator=(const FeatureVectorStore &other){
+
+            if (this != &other){
+                FeatureVectorStore copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        ~FeatureVectorStore(){
+
+            release(buffer);
+        }
+
+        void swap(FeatureVectorStore &other){
+
+            std::swap(buffer, other.buffer);
+            std::swap(rows, other.rows);
+            std::swap(capacity, other.capacity);
+            std::swap(stride, other.stride);
+            std::swap(dimension, other.dimension);
+            std::swap(layout, other.layout);
+            oids.swap(other.oids);
+        }
+
+        /**
+        * Gets the number of vectors.
+        */
+        size_t size() const{
+
+            return rows;
+        }
+
+        bool empty() const{
+
+            return rows == 0;
+        }
+
+        uint32_t getDimension() const{
+
+            return dimension;
+        }
+
+        Layout getLayout() const{
+
+            return layout;
+        }
+
+        /**
+        * Gets the distance, in values, between the starts of two rows.
+        */
+        size_t getStride() const{
+
+            return stride;
+        }
+
+        /**
+        * Makes room for n vectors without reallocating.
+        */
+        void reserve(size_t n){
+
+            if (n <= capacity)
+                return;
+            if (stride == 0){
+                capacity = n;
+                oids.reserve(n);
+                return;
+            }
+            DType *grown = allocate(n * stride);
+            if (rows > 0)
+                memcpy(grown, buffer, rows * stride * sizeof(DType));
+            release(buffer);
+            buffer = grown;
+            capacity = n;
+            oids.reserve(n);
+        }
+
+        /**
+        * Appends a vector.
+        *
+        * @param OID The vector OID.
+        * @param values getDimension() values.
+        */
+        void add(uint32_t OID, const DType *values){
+
+            if (rows == capacity)
+                reserve((capacity < 16) ? 16 : 2 * capacity);
+            DType *row = buffer + rows * stride;
+            memcpy(row, values, dimension * sizeof(DType));
+            std::fill(row + dimension, row + stride, DType());
+            oids.push_back(OID);
+            rows++;
+        }
+
+        /**
+        * Appends a copy of a feature vector.
+        */
+        template <class FeatureVector>
+        void add(FeatureVector &obj){
+
+            if ((dimension == 0) && (rows == 0))
+                setDimension(obj.size());
+            if (obj.size() != dimension)
+                throw std::length_error("The feature vectors do not have the same size.");
+            add(obj.getOID(), obj.getRawData());
+        }
+
+        void clear(){
+
+            rows = 0;
+            oids.clear();
+        }
+
+        /**
+        * Gets the values of a row (getDimension() of them, then the padding).
+        */
+        const DType *row(size_t i) const{
+
+            return buffer + i * stride;
+        }
+
+        DType *row(size_t i){
+
+            return buffer + i * stride;
+        }
+
+        uint32_t getOID(size_t i) const{
+
+            return oids[i];
+        }
+
+        /**
+        * Gets the OIDs, one per row.
+        */
+        const uint32_t *getOIDs() const{
+
+            return oids.empty() ? NULL : &oids[0];
+        }
+
+        View getView(size_t i) const{
+
+            return View(oids[i], row(i), dimension);
+        }
+
+        View operator[](size_t i) const{
+
+            return getView(i);
+        }
+
+        /**
+        * Copies a row into an owning feature vector.
+        */
+        BasicArrayObject<DType> getObject(size_t i) const{
+
+            return getView(i).getObject();
+        }
+
+        const_iterator begin() const{
+
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const{
+
+            return const_iterator(this, rows);
+        }
+
+        /**
+        * Calculates the distances between a query and the rows [first, last)
+        * with the static kernels of a metric class, e.g.
+        * store.getDistances< EuclideanDistance<FeatureVector> >(query, 0, store.size(), out).
+        * The rows are fed to Metric::computeBatch(), which prefetches ahead
+        * of the rows it is reducing.
+        *
+        * @param query getDimension() values.
+        * @param out Receives last - first distances.
+        */
+        template <class Metric>
+        void getDistances(const DType *query, size_t first, size_t last, double *out) const{
+
+            const DType *chunk[BatchChunk];
+            for (size_t j = first; j < last; j += BatchChunk){
+                size_t len = std::min(last - j, (size_t) BatchChunk);
+                for (size_t x = 0; x < len; x++)
+                    chunk[x] = row(j + x);
+                Metric::computeBatch(query, chunk, len, dimension, out + (j - first));
+            }
+        }
+
+    private:
+        static const size_t BatchChunk = 256;
+
+        void init(uint32_t dimension, Layout layout){
+
+            buffer = NULL;
+            rows = 0;
+            capacity = 0;
+            this->layout = layout;
+            this->dimension = 0;
+            stride = 0;
+            setDimension(dimension);
+        }
+
+        void setDimension(uint32_t d){
+
+            dimension = d;
+            if (layout == PADDED){
+                size_t perLine = (Alignment % sizeof(DType) == 0) ? Alignment / sizeof(DType) : 1;
+                stride = ((d + perLine - 1) / perLine) * perLine;
+            } else {
+                stride = d;
+            }
+            if ((stride > 0) && (capacity > 0) && (buffer == NULL))
+                buffer = allocate(capacity * stride);
+        }
+
+        static DType *allocate(size_t n){
+
+            return static_cast<DType *>(::operator new(n * sizeof(DType), std::align_val_t(Alignment)));
+        }
+
+        static void release(DType *p){
+
+            if (p != NULL)
+                ::operator delete(p, std::align_val_t(Alignment));
+        }
+};
+
+#endif // FEATUREVECTORSTORE_H
@@ -0,0 +1,353 @@
+#ifndef MAPPEDCOLLECTION_H
+#define MAPPEDCOLLECTION_H
+
+#include <FeatureVectorStore.h>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+* The header of a collection file. It is followed, at payloadOffset, by
+* count rows of stride elements (dimension values, then zero padding), and
+* at oidOffset by count uint32_t OIDs:
+* +--------+------------------------------+-----------+
+* | Header | Rows [count * stride]        | OIDs []   |
+* +--------+------------------------------+-----------+
+*
+* All fields are in the byte order of the machine that wrote the file;
+* endianness holds EndiannessMark as written, so a reader on a machine with
+* the other byte order sees it swapped.
+*/
+struct MappedCollectionHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t endianness;
+    uint32_t elementType;
+    uint32_t elementSize;
+    uint32_t dimension;
+    uint32_t alignment;
+    uint32_t reserved;
+    uint64_t stride;
+    uint64_t count;
+    uint64_t payloadOffset;
+    uint64_t oidOffset;
+};
+
+/**
+* A read-only collection of feature vectors backed by a memory-mapped file,
+* so opening it costs the same however large the collection is, and the
+* pages are shared by every process that maps the file. Rows start on
+* getAlignment()-byte boundaries and are scanned in place through
+* FeatureVectorView, like the rows of a FeatureVectorStore.
+*
+* Example:
+*   MappedCollection<double>::write("sift.hfv", list);
+*   MappedCollection<double> collection("sift.hfv");
+*   Evaluator<FeatureVector> e(Evaluator<FeatureVector>::EUCLIDEAN);
+*   e.getDistances(query, collection.begin(), collection.end(), out);
+*
+* @arg DType The data type of each position.
+*/
+template <class DType = double>
+class MappedCollection{
+
+    public:
+        static const uint32_t Version = 1;
+        static const uint32_t EndiannessMark = 0x01020304;
+
+        // Element type codes of the header.
+        static const uint32_t FLOAT32 = 1;
+        static const uint32_t FLOAT64 = 2;
+        static const uint32_t INT8 = 3;
+        static const uint32_t UINT8 = 4;
+        static const uint32_t INT16 = 5;
+        static const uint32_t UINT16 = 6;
+        static const uint32_t INT32 = 7;
+        static const uint32_t UINT32 = 8;
+        static const uint32_t INT64 = 9;
+        static const uint32_t UINT64 = 10;
+
+        typedef FeatureVectorView<DType> View;
+        typedef FeatureVectorIterator<MappedCollection> const_iterator;
+
+    private:
+        const unsigned char *base;
+        size_t length;
+        const MappedCollectionHeader *header;
+        const DType *rows;
+        const uint32_t *oids;
+
+    public:
+
+        /**
+        * Maps a collection file.
+        * @param path The file written by write().
+        * @throw std::runtime_error If the file cannot be mapped, or was not
+        * written by write() for this DType on a machine of the same byte order.
+        */
+        MappedCollection(const std::string &path){
+
+            base = NULL;
+            length = 0;
+            header = NULL;
+            map(path);
+        }
+
+        MappedCollection(MappedCollection &&other){
+
+            base = other.base;
+            length = other.length;
+            header = other.header;
+            rows = other.rows;
+            oids = other.oids;
+            other.base = NULL;
+            other.length = 0;
+            other.header = NULL;
+            other.rows = NULL;
+            other.oids = NULL;
+        }
+
+        MappedCollection(const MappedCollection &) = delete;
+        MappedCollection &operator=(const MappedCollection &) = delete;
+
+        ~MappedCollection(){
+
+            if (base != NULL)
+                munmap((void *) base, length);
+        }
+
+        /**
+        * Gets the number of vectors, 0 once moved from.
+        */
+        size_t size() const{
+
+            return (header != NULL) ? header->count : 0;
+        }
+
+        bool empty() const{
+
+            return size() == 0;
+        }
+
+        uint32_t getDimension() const{
+
+            return (header != NULL) ? header->dimension : 0;
+        }
+
+        /**
+        * Gets the distance, in values, between the starts of two rows.
+        */
+        size_t getStride() const{
+
+            return (header != NULL) ? header->stride : 0;
+        }
+
+        uint32_t getAlignment() const{
+
+            return (header != NULL) ? header->alignment : 0;
+        }
+
+        const DType *row(size_t i) const{
+
+            return rows + i * getStride();
+        }
+
+        uint32_t getOID(size_t i) const{
+
+            return oids[i];
+        }
+
+        const uint32_t *getOIDs() const{
+
+            return oids;
+        }
+
+        View getView(size_t i) const{
+
+            return View(oids[i], row(i), getDimension());
+        }
+
+        View operator[](size_t i) const{
+
+            return getView(i);
+        }
+
+        /**
+        * Copies a row into an owning feature vector.
+        */
+        BasicArrayObject<DType> getObject(size_t i) const{
+
+            return getView(i).getObject();
+        }
+
+        const_iterator begin() const{
+
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const{
+
+            return const_iterator(this, size());
+        }
+
+        /**
+        * Asks the kernel to read the whole file ahead, for collections that
+        * are about to be scanned.
+        */
+        void willNeed() const{
+
+            if (base != NULL)
+                madvise((void *) base, length, MADV_WILLNEED);
+        }
+
+        /**
+        * Gets the element type code of DType.
+        */
+        static uint32_t getElementType(){
+
+            if (std::is_same<DType, float>::value) return FLOAT32;
+            if (std::is_same<DType, double>::value) return FLOAT64;
+            if (std::is_same<DType, int8_t>::value) return INT8;
+            if (std::is_same<DType, uint8_t>::value) return UINT8;
+            if (std::is_same<DType, int16_t>::value) return INT16;
+            if (std::is_same<DType, uint16_t>::value) return UINT16;
+            if (std::is_same<DType, int32_t>::value) return INT32;
+            if (std::is_same<DType, uint32_t>::value) return UINT32;
+            if (std::is_same<DType, int64_t>::value) return INT64;
+            if (std::is_same<DType, uint64_t>::value) return UINT64;
+            return 0;
+        }
+
+        /**
+        * Writes a collection file.
+        * @param path The file to create or replace.
+        * @param list The feature vectors, all of the same size.
+        * @param alignment The byte boundary every row starts on: a power of
+        * two, and a multiple of both sizeof(DType) and the 4 bytes of an OID.
+        * @throw std::invalid_argument If alignment is not such a value.
+        * @throw std::length_error If the feature vectors differ in size.
+        * @throw std::runtime_error If the file cannot be written.
+        */
+        static void write(const std::string &path, std::vector< BasicArrayObject<DType> > &list, uint32_t alignment = 64){
+
+            // Every row and the OID section then start aligned for their loads.
+            if (((alignment & (alignment - 1)) != 0) || (alignment < sizeof(DType)) || (alignment < sizeof(uint32_t)))
+                throw std::invalid_argument("The alignment must be a power of two multiple of the element and OID sizes.");
+
+            MappedCollectionHeader h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, "HERMESFV", 8);
+            h.version = Version;
+            h.headerSize = sizeof(MappedCollectionHeader);
+            h.endianness = EndiannessMark;
+            h.elementType = getElementType();
+            h.elementSize = sizeof(DType);
+            h.dimension = list.empty() ? 0 : list[0].size();
+            h.alignment = alignment;
+            h.stride = roundUp(h.dimension * sizeof(DType), h.alignment) / sizeof(DType);
+            h.count = list.size();
+            h.payloadOffset = roundUp(sizeof(MappedCollectionHeader), h.alignment);
+            h.oidOffset = h.payloadOffset + h.count * h.stride * sizeof(DType);
+
+            FILE *file = fopen(path.c_str(), "wb");
+            if (file == NULL)
+                throw std::runtime_error("Cannot create " + path + ".");
+
+            std::vector<DType> padded(h.stride, DType());
+            std::vector<unsigned char> gap(h.payloadOffset - sizeof(MappedCollectionHeader), 0);
+            bool ok = (fwrite(&h, sizeof(h), 1, file) == 1);
+            if (ok && !gap.empty())
+                ok = (fwrite(&gap[0], 1, gap.size(), file) == gap.size());
+            for (size_t x = 0; ok && (x < list.size()); x++){
+                if (list[x].size() != h.dimension){
+                    fclose(file);
+                    throw std::length_error("The feature vectors do not have the same size.");
+                }
+                if (h.dimension > 0)
+                    memcpy(&padded[0], list[x].getRawData(), h.dimension * sizeof(DType));
+                if (h.stride > 0)
+                    ok = (fwrite(&padded[0], sizeof(DType), h.stride, file) == h.stride);
+            }
+            for (size_t x = 0; ok && (x < list.size()); x++){
+                uint32_t oid = list[x].getOID();
+                ok = (fwrite(&oid, sizeof(uint32_t), 1, file) == 1);
+            }
+            if ((fclose(file) != 0) || !ok)
+                throw std::runtime_error("Cannot write " + path + ".");
+        }
+
+    private:
+
+        static uint64_t roundUp(uint64_t n, uint64_t alignment){
+
+            return (n + alignment - 1) / alignment * alignment;
+        }
+
+        // Whether the rows and OIDs of a header lie, aligned, within length
+        // bytes. Every product is bounded first, so corrupt values cannot
+        // overflow.
+        static bool fits(const MappedCollectionHeader &h, size_t length){
+
+            if ((h.stride < h.dimension) || (h.payloadOffset % sizeof(DType) != 0) || (h.oidOffset % sizeof(uint32_t) != 0))
+                return false;
+            if ((h.payloadOffset < sizeof(MappedCollectionHeader)) || (h.payloadOffset > h.oidOffset) || (h.oidOffset > length))
+                return false;
+            if (h.count > (length - h.oidOffset) / sizeof(uint32_t))
+                return false;
+
+            uint64_t rowBytes = h.oidOffset - h.payloadOffset;
+            if ((h.count == 0) || (h.stride == 0))
+                return rowBytes == 0;
+            return (h.count <= rowBytes / sizeof(DType) / h.stride) && (h.count * h.stride * sizeof(DType) == rowBytes);
+        }
+
+        void map(const std::string &path){
+
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open " + path + ".");
+            struct stat st;
+            if ((fstat(fd, &st) != 0) || ((size_t) st.st_size < sizeof(MappedCollectionHeader))){
+                close(fd);
+                throw std::runtime_error(path + " is not a collection file.");
+            }
+            length = st.st_size;
+            void *p = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+                throw std::runtime_error("Cannot map " + path + ".");
+            base = (const unsigned char *) p;
+            header = (const MappedCollectionHeader *) base;
+
+            const char *error = NULL;
+            if (memcmp(header->magic, "HERMESFV", 8) != 0)
+                error = " is not a collection file.";
+            else if (header->endianness != EndiannessMark)
+                error = " was written on a machine of another byte order.";
+            else if (header->version != Version)
+                error = " has an unsupported version.";
+            else if ((header->elementType != getElementType()) || (header->elementSize != sizeof(DType)))
+                error = " holds another element type.";
+            else if (!fits(*header, length))
+                error = " is truncated or corrupt.";
+            if (error != NULL){
+                munmap(p, length);
+                base = NULL;
+                header = NULL;
+                throw std::runtime_error(path + error);
+            }
+            rows = (const DType *) (base + header->payloadOffset);
+            oids = (const uint32_t *) (base + header->oidOffset);
+        }
+};
+
+#endif // MAPPEDCOLLECTION_H
@@ -0,0 +1,267 @@
+#ifndef METRICEVALUATOR_H
+#define METRICEVALUATOR_H
+
+#include <Evaluator.h>
+
+/**
+* Evaluator whose distance function is a template parameter.
+* Every call goes straight to the static kernels of the Metric class, with no
+* type branch, temporary object or virtual call, so it can be inlined into
+* scan loops. The *Unchecked methods also skip the per-call size check: call
+* validate() once per dataset (and check queries with validate(query)) before
+* using them.
+*
+* Statistics work as in Evaluator, reported under Metric::MetricType.
+*
+* Example:
+*   MetricEvaluator< EuclideanDistance<FeatureVector> > e;
+*   e.validate(list);
+*   double d = e.getDistanceUnchecked(list[0], list[1]);
+*
+* @arg Metric A distance function class, e.g. EuclideanDistance<FeatureVector>.
+* @arg FeatureVector The feature vector type.
+*/
+template <class Metric, class FeatureVector = BasicArrayObject<double> >
+class MetricEvaluator{
+
+private:
+    typedef typename FeatureVector::value_type DType;
+
+    uint64_t ndf;
+    uint32_t dimension;
+    std::vector<uint32_t> order;
+
+public:
+    /**
+    * Constructor.
+    *
+    * @param dimension The dimension expected by the unchecked methods.
+    */
+    MetricEvaluator(uint32_t dimension = 0){
+        resetStatistics();
+        setDimension(dimension);
+    }
+
+    /**
+    * Increments the statistics.
+    *
+    * @param n The number of distance calculations to be accounted.
+    */
+    void updateStatistics(uint64_t n = 1){
+
+        ndf += n;
+        DistanceStatistics::count(Metric::MetricType, n);
+    }
+
+    void resetStatistics(){
+
+        ndf = 0;
+    }
+
+    /**
+    * Returns the statistics value.
+    *
+    * @return The number of distance function calculations.
+    */
+    uint64_t getStatistics() const{
+
+        return ndf;
+    }
+
+    /**
+    * Sets the dimension used by the unchecked methods.
+    *
+    * @param d The number of elements of every feature vector.
+    */
+    void setDimension(uint32_t d){
+
+        dimension = d;
+    }
+
+    uint32_t getDimension() const{
+
+        return dimension;
+    }
+
+    /**
+    * Checks that every feature vector of a dataset has the same size and
+    * makes it the dimension of the unchecked methods.
+    *
+    * @param dataset The feature vectors to be compared.
+    * @return The dimension of the dataset.
+    */
+    uint32_t validate(std::vector<FeatureVector> &dataset){
+
+        if (dataset.empty())
+            return dimension;
+
+        uint32_t d = dataset[0].size();
+        for (size_t x = 0; x < dataset.size(); x++)
+            if (dataset[x].size() != d)
+                throw std::length_error("The feature vectors do not have the same size.");
+        if (!order.empty() && (order.size() != d))
+            throw std::length_error("The dimension order does not match the feature vectors size.");
+
+        setDimension(d);
+        return d;
+    }
+
+    /**
+    * Checks a single feature vector (e.g. a query) against the dimension.
+    */
+    void validate(FeatureVector &obj){
+
+        if (obj.size() != dimension)
+            throw std::length_error("The feature vectors do not have the same size.");
+    }
+
+    /**
+    * Sets the order in which bounded distances visit the dimensions.
+    *
+    * @param dimensionOrder A permutation of the dimensions, or empty.
+    * @throw std::invalid_argument If it is not a permutation of [0, size).
+    */
+    void setDimensionOrder(const std::vector<uint32_t> &dimensionOrder){
+
+        DistanceKernels::checkPermutation(dimensionOrder);
+        order = dimensionOrder;
+    }
+
+    const std::vector<uint32_t> &getDimensionOrder() const{
+
+        return order;
+    }
+
+    /**
+    * Calculates the distance between two feature vectors.
+    *
+    * @return The distance between the two compared objects.
+    */
+    double getDistance(FeatureVector &obj1, FeatureVector &obj2){
+
+        if (obj1.size() != obj2.size())
+            throw std::length_error("The feature vectors do not have the same size.");
+
+        updateStatistics();
+        DistanceStatistics::Timer timer(Metric::MetricType);
+        return compute(obj1, obj2, obj1.size());
+    }
+
+    /**
+    * Calculates the distance between two feature vectors of the validated
+    * dimension, without checking it.
+    *
+    * @return The distance between the two compared objects.
+    */
+    inline double getDistanceUnchecked(const FeatureVector &obj1, const FeatureVector &obj2){
+
+        updateStatistics();
+        DistanceStatistics::Timer timer(Metric::MetricType);
+        return compute(obj1, obj2, dimension);
+    }
+
+    /**
+    * Calculates a distance that may stop as soon as it exceeds bound.
+    *
+    * @return The exact distance if it is <= bound, otherwise any value greater than bound.
+    */
+    double getBoundedDistance(FeatureVector &obj1, FeatureVector &obj2, double bound){
+
+        if (obj1.size() != obj2.size())
+            throw std::length_error("The feature vectors do not have the same size.");
+        if (!order.empty() && (order.size() != obj1.size()))
+            throw std::length_error("The dimension order does not match the feature vectors size.");
+
+        updateStatistics();
+        DistanceStatistics::Timer timer(Metric::MetricType);
+        return computeBounded(obj1, obj2, obj1.size(), bound);
+    }
+
+    /**
+    * @copydoc getBoundedDistance(FeatureVector &obj1, FeatureVector &obj2, double bound).
+    * The feature vectors must have the validated dimension.
+    */
+    inline double getBoundedDistanceUnchecked(const FeatureVector &obj1, const FeatureVector &obj2, double bound){
+
+        updateStatistics();
+        DistanceStatistics::Timer timer(Metric::MetricType);
+        return computeBounded(obj1, obj2, dimension, bound);
+    }
+
+    /**
+    * Calculates the distances between a query and a range of candidates.
+    *
+    * @param out Receives one distance per candidate, in the range order.
+    */
+    template <class Iterator>
+    void getDistances(FeatureVector &query, Iterator first, Iterator last, double *out){
+
+        for (Iterator it = first; it != last; ++it)
+            if (it->size() != query.size())
+                throw std::length_error("The feature vectors do not have the same size.");
+        batch(query, first, last, query.size(), out);
+    }
+
+    /**
+    * @copydoc getDistances(FeatureVector &query, Iterator first, Iterator last, double *out).
+    * All feature vectors must have the validated dimension.
+    */
+    template <class Iterator>
+    void getDistancesUnchecked(const FeatureVector &query, Iterator first, Iterator last, double *out){
+
+        batch(query, first, last, dimension, out);
+    }
+
+private:
+    static const uint32_t BatchChunk = 256;
+    static const bool UsesAuxiliaries = HasAuxiliaries<FeatureVector>::value && AuxiliaryMetric<Metric>::value;
+
+    // With VectorAuxiliaries, bounded distances are the full ones, so that
+    // both agree to the last bit as in Evaluator.
+    static double compute(const FeatureVector &obj1, const FeatureVector &obj2, size_t n){
+
+        if constexpr (UsesAuxiliaries)
+            return Metric::computeWithAuxiliaries(obj1.getRawData(), obj1.getAuxiliaries(), obj2.getRawData(), obj2.getAuxiliaries(), n);
+        else
+            return Metric::compute(obj1.getRawData(), obj2.getRawData(), n);
+    }
+
+    double computeBounded(const FeatureVector &obj1, const FeatureVector &obj2, size_t n, double bound){
+
+        if constexpr (UsesAuxiliaries)
+            return compute(obj1, obj2, n);
+        else
+            return Metric::computeBounded(obj1.getRawData(), obj2.getRawData(), n, bound, order.empty() ? NULL : order.data());
+    }
+
+    template <class Iterator>
+    void batch(const FeatureVector &query, Iterator first, Iterator last, uint32_t d, double *out){
+
+        typedef typename std::decay<decltype(*first)>::type Candidate;
+        uint64_t count = 0;
+        if constexpr (UsesAuxiliaries && HasAuxiliaries<Candidate>::value){
+            // The batch kernels do not use the VectorAuxiliaries: run the
+            // kernel of compute(), so that the distances agree with
+            // getDistance(). Candidates without them (e.g. views) take the
+            // batch kernels.
+            VectorAuxiliaries aux = query.getAuxiliaries();
+            DistanceStatistics::Timer timer(Metric::MetricType, std::distance(first, last));
+            for (; first != last; ++first)
+                out[count++] = Metric::computeWithAuxiliaries(query.getRawData(), aux, first->getRawData(), first->getAuxiliaries(), d);
+        } else {
+            const DType *chunk[BatchChunk];
+            while (first != last){
+                uint32_t len = 0;
+                for (; (len < BatchChunk) && (first != last); ++first)
+                    chunk[len++] = first->getRawData();
+                DistanceStatistics::Timer timer(Metric::MetricType, len);
+                Metric::computeBatch(query.getRawData(), chunk, len, d, out + count);
+                count += len;
+            }
+        }
+
+        updateStatistics(count);
+    }
+};
+
+#endif // METRICEVALUATOR_H
@@ -0,0 +1,386 @@
+#ifndef PIVOTTABLE_H
+#define PIVOTTABLE_H
+
+#include <Evaluator.h>
+#include <FeatureVectorStore.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <random>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+* LAESA-style pivot table: the distances from every object to a few pivots
+* are computed once, and by the triangle inequality
+* max_p |d(q, p) - d(x, p)| is a lower bound of d(q, x). Queries compute the
+* bounds of all objects in one batched pass (the Chebyshev distance between
+* rows of the table, see DistanceKernels) and only call the real distance on
+* the objects whose bound does not rule them out.
+*
+* The table is stored as Entry values, one row per object: float (or double)
+* distances, or uint8_t / uint16_t codes of a fixed step. The bounds are
+* lowered by the worst rounding error of the entries, so results are exact
+* for every true metric (Euclidean, CityBlock, Chebyshev, Canberra, Hamming).
+* Jeffrey, Bray-Curtis and Chi-square do not satisfy the triangle
+* inequality: with them the answers are approximate.
+*
+* The table keeps positions in the list, not copies: the list must outlive
+* the table and stay unchanged.
+*
+* Example:
+*   PivotTable<FeatureVector> table(list, Evaluator<FeatureVector>::CANBERRA, 16);
+*   std::vector< std::pair<double, uint32_t> > best;
+*   table.kNearest(query, 10, best);
+*
+* @arg FeatureVector The feature vector type.
+* @arg Entry The type of the stored distances: float, double, uint8_t or uint16_t.
+*/
+template <class FeatureVector = BasicArrayObject<double>, class Entry = float>
+class PivotTable{
+
+    public:
+        enum Selection{
+            // Farthest-first traversal: each pivot is the object farthest
+            // from the pivots already chosen.
+            MAX_SEPARATION = 0,
+            // Incremental selection: each pivot is the candidate that most
+            // raises the mean lower bound over a sample of object pairs.
+            INCREMENTAL = 1
+        };
+
+        /**
+        * A query answer: the distance and the position of the object.
+        */
+        typedef std::pair<double, uint32_t> Result;
+
+    private:
+        // Candidates and object pairs sampled by INCREMENTAL selection.
+        static const uint32_t IncrementalCandidates = 16;
+        static const uint32_t IncrementalPairs = 256;
+
+        std::vector<FeatureVector> *objects;
+        Evaluator<FeatureVector> evaluator;
+        std::vector<uint32_t> pivots;
+        // Slot of every object in pivots, -1 for the other ones.
+        std::vector<int32_t> pivotSlot;
+        FeatureVectorStore<Entry> table;
+        // Distance of one code step (integer entries), 0 for floating ones.
+        double step;
+        double maxDistance;
+        uint64_t buildCount;
+
+    public:
+
+        /**
+        * Selects the pivots and fills the table.
+        *
+        * @param objects The objects to be indexed.
+        * @param types The distance function number, as in Evaluator.
+        * @param pivotCount The number of pivots.
+        * @param selection How pivots are selected.
+        * @param seed The seed of the random choices.
+        */
+        PivotTable(std::vector<FeatureVector> &objects, uint16_t types, uint32_t pivotCount = 16, Selection selection = MAX_SEPARATION, uint32_t seed = 5489)
+            : PivotTable(objects, Evaluator<FeatureVector>(types), pivotCount, selection, seed){
+        }
+
+        /**
+        * Selects the pivots and fills the table with a copy of a configured
+        * Evaluator, e.g. one of a Minkowski order other than 2.
+        *
+        * @param objects The objects to be indexed.
+        * @param evaluator The evaluator; its statistics are not carried over.
+        * @param pivotCount The number of pivots.
+        * @param selection How pivots are selected.
+        * @param seed The seed of the random choices.
+        */
+        PivotTable(std::vector<FeatureVector> &objects, const Evaluator<FeatureVector> &evaluator, uint32_t pivotCount = 16, Selection selection = MAX_SEPARATION, uint32_t seed = 5489)
+            : evaluator(evaluator), table(0, FeatureVectorStore<Entry>::ROW_MAJOR){
+
+            this->evaluator.resetStatistics();
+            this->objects = &objects;
+            pivotCount = std::min(pivotCount, (uint32_t) objects.size());
+            pivotSlot.assign(objects.size(), -1);
+
+            std::mt19937 random(seed);
+            std::vector<double> distances;
+            if (selection == INCREMENTAL)
+                selectIncremental(pivotCount, random, distances);
+            else
+                selectMaxSeparation(pivotCount, random, distances);
+            buildCount = this->evaluator.getStatistics();
+            this->evaluator.resetStatistics();
+
+            maxDistance = 0.0;
+            for (size_t x = 0; x < distances.size(); x++)
+                maxDistance = std::max(maxDistance, distances[x]);
+            if (std::is_integral<Entry>::value)
+                step = (maxDistance > 0.0) ? maxDistance / std::numeric_limits<Entry>::max() : 1.0;
+            else
+                step = 0.0;
+
+            // distances holds one column per pivot; the table one row per object.
+            uint32_t m = pivots.size();
+            table = FeatureVectorStore<Entry>(m, FeatureVectorStore<Entry>::ROW_MAJOR);
+            table.reserve(objects.size());
+            std::vector<Entry> row(m);
+            for (size_t x = 0; x < objects.size(); x++){
+                for (uint32_t p = 0; p < m; p++)
+                    row[p] = encode(distances[p * objects.size() + x]);
+                table.add(x, row.data());
+            }
+        }
+
+        size_t size() const{
+
+            return pivotSlot.size();
+        }
+
+        /**
+        * Gets the positions of the pivots.
+        */
+        const std::vector<uint32_t> &getPivots() const{
+
+            return pivots;
+        }
+
+        /**
+        * Returns the number of real distances computed by the queries,
+        * including the ones between queries and pivots.
+        */
+        uint64_t getStatistics(){
+
+            return evaluator.getStatistics();
+        }
+
+        void resetStatistics(){
+
+            evaluator.resetStatistics();
+        }
+
+        /**
+        * Returns the number of distances computed to select the pivots and
+        * fill the table.
+        */
+        uint64_t getBuildStatistics() const{
+
+            return buildCount;
+        }
+
+        /**
+        * Computes the lower bounds of the distances between the query and
+        * every object.
+        *
+        * @param query The query feature vector.
+        * @param queryDistances Receives the distances from the query to the pivots.
+        * @param bounds Receives one lower bound per object.
+        */
+        void lowerBounds(FeatureVector &query, std::vector<double> &queryDistances, std::vector<double> &bounds){
+
+            uint32_t m = pivots.size();
+            queryDistances.resize(m);
+            for (uint32_t p = 0; p < m; p++)
+                queryDistances[p] = evaluator.getDistance(query, (*objects)[pivots[p]]);
+
+            bounds.assign(size(), 0.0);
+            if ((m == 0) || bounds.empty())
+                return;
+
+            std::vector<Entry> row(m);
+            double queryMax = 0.0;
+            for (uint32_t p = 0; p < m; p++){
+                row[p] = encode(queryDistances[p]);
+                queryMax = std::max(queryMax, queryDistances[p]);
+            }
+            table.template getDistances< ChebyshevDistance< FeatureVectorView<Entry> > >(row.data(), 0, table.size(), bounds.data());
+
+            // |d(q, p) - d(x, p)| >= |q_p - x_p| - (rounding errors of q_p and x_p).
+            double slack;
+            if (step > 0.0)
+                slack = step;
+            else
+                slack = (queryMax + maxDistance) * std::numeric_limits<Entry>::epsilon();
+            for (size_t x = 0; x < bounds.size(); x++)
+                bounds[x] = std::max(0.0, ((step > 0.0) ? bounds[x] * step : bounds[x]) - slack);
+        }
+
+        /**
+        * Finds every object within radius of the query, nearest first.
+        *
+        * @param query The query feature vector.
+        * @param radius The query radius.
+        * @param result Receives (distance, position) pairs.
+        */
+        void range(FeatureVector &query, double radius, std::vector<Result> &result){
+
+            std::vector<double> queryDistances, bounds;
+            lowerBounds(query, queryDistances, bounds);
+
+            result.clear();
+            for (uint32_t x = 0; x < bounds.size(); x++){
+                if (bounds[x] > radius)
+                    continue;
+                double d = (pivotSlot[x] >= 0) ? queryDistances[pivotSlot[x]]
+                                               : evaluator.getBoundedDistance(query, (*objects)[x], radius);
+                if (d <= radius)
+                    result.push_back(Result(d, x));
+            }
+            std::sort(result.begin(), result.end());
+        }
+
+        /**
+        * Finds the k nearest objects to the query, nearest first. Ties at the
+        * k-th distance are broken arbitrarily.
+        *
+        * @param query The query feature vector.
+        * @param k The number of neighbors.
+        * @param result Receives (distance, position) pairs.
+        */
+        void kNearest(FeatureVector &query, size_t k, std::vector<Result> &result){
+
+            result.clear();
+            if ((k == 0) || (size() == 0))
+                return;
+
+            std::vector<double> queryDistances, bounds;
+            lowerBounds(query, queryDistances, bounds);
+
+            // The k objects of smallest bound go first, to get a tight
+            // k-th distance before the linear pass.
+            std::vector<Result> order(bounds.size());
+            for (uint32_t x = 0; x < bounds.size(); x++)
+                order[x] = Result(bounds[x], x);
+            size_t first = std::min(k, order.size());
+            std::nth_element(order.begin(), order.begin() + (first - 1), order.end());
+
+            std::priority_queue<Result> best;
+            double tau = std::numeric_limits<double>::infinity();
+            for (size_t y = 0; y < order.size(); y++){
+                if (order[y].first > tau)
+                    continue;
+                uint32_t x = order[y].second;
+                double d = (pivotSlot[x] >= 0) ? queryDistances[pivotSlot[x]]
+                                               : evaluator.getBoundedDistance(query, (*objects)[x], tau);
+                if (best.size() < k){
+                    best.push(Result(d, x));
+                } else if (d < tau){
+                    best.pop();
+                    best.push(Result(d, x));
+                }
+                if (best.size() == k)
+                    tau = best.top().first;
+            }
+
+            result.resize(best.size());
+            for (size_t x = result.size(); x > 0; x--){
+                result[x - 1] = best.top();
+                best.pop();
+            }
+        }
+
+    private:
+
+        Entry encode(double d) const{
+
+            if (step > 0.0)
+                return (Entry) std::min(std::floor(d / step + 0.5), (double) std::numeric_limits<Entry>::max());
+            return (Entry) d;
+        }
+
+        // Appends the column of distances from object p to every object.
+        void addPivot(uint32_t p, std::vector<double> &distances){
+
+            pivotSlot[p] = pivots.size();
+            pivots.push_back(p);
+            size_t n = objects->size();
+            size_t base = distances.size();
+            distances.resize(base + n);
+            for (size_t x = 0; x < n; x++)
+                distances[base + x] = (x == p) ? 0.0 : evaluator.getDistance((*objects)[p], (*objects)[x]);
+        }
+
+        void selectMaxSeparation(uint32_t count, std::mt19937 &random, std::vector<double> &distances){
+
+            size_t n = objects->size();
+            if (count == 0)
+                return;
+
+            // Start from the object farthest from a random one.
+            uint32_t start = random() % n, first = start;
+            double farthest = -1.0;
+            for (uint32_t x = 0; x < n; x++){
+                double d = (x == start) ? 0.0 : evaluator.getDistance((*objects)[start], (*objects)[x]);
+                if (d > farthest){
+                    farthest = d;
+                    first = x;
+                }
+            }
+
+            std::vector<double> nearest(n, std::numeric_limits<double>::infinity());
+            uint32_t next = first;
+            for (uint32_t c = 0; c < count; c++){
+                addPivot(next, distances);
+                const double *column = &distances[c * n];
+                double best = -1.0;
+                for (uint32_t x = 0; x < n; x++){
+                    nearest[x] = std::min(nearest[x], column[x]);
+                    if ((pivotSlot[x] < 0) && (nearest[x] > best)){
+                        best = nearest[x];
+                        next = x;
+                    }
+                }
+            }
+        }
+
+        void selectIncremental(uint32_t count, std::mt19937 &random, std::vector<double> &distances){
+
+            size_t n = objects->size();
+            if (count == 0)
+                return;
+
+            std::vector<uint32_t> a(IncrementalPairs), b(IncrementalPairs);
+            for (uint32_t i = 0; i < IncrementalPairs; i++){
+                a[i] = random() % n;
+                b[i] = random() % n;
+            }
+            std::vector<double> bound(IncrementalPairs, 0.0), trial(IncrementalPairs);
+
+            for (uint32_t c = 0; c < count; c++){
+                uint32_t chosen = 0;
+                double bestMean = -1.0;
+                std::vector<double> chosenBound;
+                for (uint32_t t = 0; t < IncrementalCandidates; t++){
+                    uint32_t candidate = random() % n;
+                    if (pivotSlot[candidate] >= 0)
+                        continue;
+                    double mean = 0.0;
+                    for (uint32_t i = 0; i < IncrementalPairs; i++){
+                        double da = evaluator.getDistance((*objects)[candidate], (*objects)[a[i]]);
+                        double db = evaluator.getDistance((*objects)[candidate], (*objects)[b[i]]);
+                        trial[i] = std::max(bound[i], std::fabs(da - db));
+                        mean += trial[i];
+                    }
+                    if (mean > bestMean){
+                        bestMean = mean;
+                        chosen = candidate;
+                        chosenBound = trial;
+                    }
+                }
+                if (bestMean < 0.0){
+                    // Every candidate drawn was a pivot already: take the
+                    // first free object.
+                    while (pivotSlot[chosen] >= 0)
+                        chosen++;
+                } else {
+                    bound = chosenBound;
+                }
+                addPivot(chosen, distances);
+            }
+        }
+};
+
+#endif // PIVOTTABLE_H
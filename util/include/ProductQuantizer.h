@@ -0,0 +1,541 @@
+#ifndef PRODUCTQUANTIZER_H
+#define PRODUCTQUANTIZER_H
+
+#include <Evaluator.h>
+#include <DistanceKernels.h>
+#include <DistanceStatistics.h>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+// Sixteen 4-bit table entries or codes, and their sixteen 16-bit sums.
+typedef uint8_t SimdLookup16 __attribute__((vector_size(16)));
+typedef uint16_t SimdLookupSum16 __attribute__((vector_size(32)));
+#endif
+
+/**
+* Product quantization for Euclidean distances.
+*
+* The dimensions are split into M contiguous sub-spaces and each sub-space is
+* quantized against its own k-means codebook of 2^bits centroids, so a vector
+* is stored as M codes of one byte. A query builds one table per sub-space
+* holding its squared distance to every centroid (computeTable()), and the
+* approximate distance to a vector is the root of the sum of M table
+* entries (asymmetric distance computation).
+*
+* With 4-bit codes the codes can also be packed by blocks of 32 vectors
+* (pack()) and scanned with scanPacked(): the tables are quantized to bytes
+* and looked up sixteen at a time with in-register shuffles. This adds a
+* rounding error of at most M * delta / 2 to the squared distance, delta being
+* the widest table range over 255.
+*
+* Approximate candidates are refined with Evaluator::rerank().
+*
+* Example:
+*   ProductQuantizer<FeatureVector> pq(8, 8);
+*   pq.train(list);
+*   std::vector<uint8_t> codes;
+*   pq.encode(list, codes);
+*   std::vector< std::pair<double, uint32_t> > best;
+*   pq.kNearest(query, codes, 4 * k, best);
+*   Evaluator<FeatureVector>(Evaluator<FeatureVector>::EUCLIDEAN).rerank(query, list, best, k);
+*
+* @arg FeatureVector The feature vector type.
+*/
+template <class FeatureVector = BasicArrayObject<double> >
+class ProductQuantizer{
+
+    private:
+        uint32_t subspaces;
+        uint32_t bits;
+        uint32_t iterations;
+        uint32_t seed;
+        uint32_t dimension;
+        uint64_t ndf;
+        // First dimension of each sub-space, plus the dimension at the end.
+        std::vector<uint32_t> bounds;
+        // Centroids of sub-space m start at centroids[bounds[m] * K]: K rows
+        // of (bounds[m + 1] - bounds[m]) values.
+        std::vector<double> centroids;
+
+    public:
+
+        // Vectors per block of the packed layout.
+        static const uint32_t PackedBlock = 32;
+
+        /**
+        * Constructor.
+        *
+        * @param subspaces The number of sub-spaces M (bytes per vector).
+        * @param bits The bits per code, 4 or 8.
+        */
+        ProductQuantizer(uint32_t subspaces = 8, uint32_t bits = 8){
+
+            if ((subspaces == 0) || ((bits != 4) && (bits != 8)))
+                throw std::invalid_argument("Product quantization needs at least one sub-space and 4 or 8 bits per code.");
+            this->subspaces = subspaces;
+            this->bits = bits;
+            dimension = 0;
+            setIterations(25);
+            setSeed(0);
+            resetStatistics();
+        }
+
+        /**
+        * Sets the number of k-means iterations per sub-space.
+        */
+        void setIterations(uint32_t n){
+
+            iterations = n;
+        }
+
+        /**
+        * Sets the seed of the k-means initialization.
+        */
+        void setSeed(uint32_t s){
+
+            seed = s;
+        }
+
+        uint32_t getSubspaces() const{
+
+            return subspaces;
+        }
+
+        uint32_t getBits() const{
+
+            return bits;
+        }
+
+        uint32_t getCentroids() const{
+
+            return 1u << bits;
+        }
+
+        /**
+        * Returns the trained dimension (0 before train()).
+        */
+        uint32_t getDimension() const{
+
+            return dimension;
+        }
+
+        /**
+        * Returns the number of code bytes per vector.
+        */
+        uint32_t getCodeSize() const{
+
+            return subspaces;
+        }
+
+        /**
+        * Returns the number of floats of a distance table.
+        */
+        uint32_t getTableSize() const{
+
+            return subspaces * getCentroids();
+        }
+
+        void resetStatistics(){
+
+            ndf = 0;
+        }
+
+        /**
+        * Returns the number of approximate distances computed.
+        */
+        uint64_t getStatistics() const{
+
+            return ndf;
+        }
+
+        /**
+        * Learns one codebook per sub-space with Lloyd's k-means, initialized
+        * with distinct random sample vectors.
+        *
+        * @param sample At least getCentroids() feature vectors of equal size.
+        */
+        void train(const std::vector<FeatureVector> &sample){
+
+            uint32_t k = getCentroids();
+            if (sample.size() < k)
+                throw std::invalid_argument("The training sample must have at least as many vectors as centroids.");
+
+            dimension = sample[0].size();
+            for (size_t x = 0; x < sample.size(); x++)
+                if (sample[x].size() != dimension)
+                    throw std::length_error("The feature vectors do not have the same size.");
+            if (dimension < subspaces)
+                throw std::invalid_argument("There are more sub-spaces than dimensions.");
+
+            bounds.resize(subspaces + 1);
+            for (uint32_t m = 0; m <= subspaces; m++)
+                bounds[m] = (uint64_t) m * dimension / subspaces;
+            centroids.assign((size_t) dimension * k, 0.0);
+
+            std::mt19937 random(seed);
+            std::vector<uint32_t> order(sample.size());
+            for (uint32_t x = 0; x < order.size(); x++)
+                order[x] = x;
+
+            std::vector<double> points;
+            for (uint32_t m = 0; m < subspaces; m++){
+                uint32_t d = bounds[m + 1] - bounds[m];
+                points.resize(sample.size() * d);
+                for (size_t x = 0; x < sample.size(); x++)
+                    for (uint32_t i = 0; i < d; i++)
+                        points[x * d + i] = sample[x][bounds[m] + i];
+
+                std::shuffle(order.begin(), order.end(), random);
+                double *c = &centroids[(size_t) bounds[m] * k];
+                for (uint32_t j = 0; j < k; j++)
+                    std::copy(&points[(size_t) order[j] * d], &points[(size_t) order[j] * d] + d, c + (size_t) j * d);
+
+                kmeans(&points[0], sample.size(), d, c, k);
+            }
+        }
+
+        /**
+        * Encodes one feature vector.
+        *
+        * @param codes Receives getCodeSize() codes.
+        */
+        void encode(const FeatureVector &obj, uint8_t *codes) const{
+
+            check(obj);
+            uint32_t k = getCentroids();
+            std::vector<double> sub;
+            for (uint32_t m = 0; m < subspaces; m++){
+                uint32_t d = bounds[m + 1] - bounds[m];
+                sub.resize(d);
+                for (uint32_t i = 0; i < d; i++)
+                    sub[i] = obj[bounds[m] + i];
+                codes[m] = (uint8_t) nearest(&sub[0], &centroids[(size_t) bounds[m] * k], k, d);
+            }
+        }
+
+        /**
+        * Encodes a list of feature vectors.
+        *
+        * @param codes Receives objects.size() * getCodeSize() codes, vector by vector.
+        */
+        void encode(const std::vector<FeatureVector> &objects, std::vector<uint8_t> &codes) const{
+
+            codes.resize(objects.size() * subspaces);
+            for (size_t x = 0; x < objects.size(); x++)
+                encode(objects[x], &codes[x * subspaces]);
+        }
+
+        /**
+        * Reconstructs a feature vector from its centroids.
+        */
+        FeatureVector decode(const uint8_t *codes) const{
+
+            uint32_t k = getCentroids();
+            FeatureVector obj;
+            for (uint32_t m = 0; m < subspaces; m++){
+                uint32_t d = bounds[m + 1] - bounds[m];
+                const double *c = &centroids[(size_t) bounds[m] * k + (size_t) codes[m] * d];
+                for (uint32_t i = 0; i < d; i++)
+                    obj.set((typename FeatureVector::value_type) c[i]);
+            }
+            return obj;
+        }
+
+        /**
+        * Builds the distance tables of a query: table[m * K + j] is the
+        * squared distance between the query and centroid j of sub-space m.
+        *
+        * @param table Receives getTableSize() values.
+        */
+        void computeTable(const FeatureVector &query, float *table) const{
+
+            check(query);
+            uint32_t k = getCentroids();
+            std::vector<double> sub;
+            for (uint32_t m = 0; m < subspaces; m++){
+                uint32_t d = bounds[m + 1] - bounds[m];
+                sub.resize(d);
+                for (uint32_t i = 0; i < d; i++)
+                    sub[i] = query[bounds[m] + i];
+                const double *c = &centroids[(size_t) bounds[m] * k];
+                for (uint32_t j = 0; j < k; j++)
+                    table[m * k + j] = (float) DistanceKernels::squaredEuclidean(&sub[0], c + (size_t) j * d, d);
+            }
+        }
+
+        /**
+        * Calculates the approximate distances of count encoded vectors.
+        *
+        * @param table The query tables, from computeTable().
+        * @param codes count * getCodeSize() codes.
+        * @param out Receives count distances.
+        */
+        void scan(const float *table, const uint8_t *codes, size_t count, double *out){
+
+            uint32_t k = getCentroids();
+            for (size_t x = 0; x < count; x++){
+                const uint8_t *c = codes + x * subspaces;
+                float s0 = 0.0f, s1 = 0.0f;
+                uint32_t m = 0;
+                for (; m + 2 <= subspaces; m += 2){
+                    s0 += table[m * k + c[m]];
+                    s1 += table[(m + 1) * k + c[m + 1]];
+                }
+                if (m < subspaces)
+                    s0 += table[m * k + c[m]];
+                out[x] = sqrt((double) s0 + s1);
+            }
+
+            ndf += count;
+            DistanceStatistics::count(EuclideanDistance<FeatureVector>::MetricType, count);
+        }
+
+        /**
+        * Rearranges 4-bit codes for scanPacked(): for every block of 32
+        * vectors and every sub-space, 16 bytes hold the codes of vectors j
+        * (low nibble) and j + 16 (high nibble). The last block is padded
+        * with zero codes.
+        *
+        * @param codes count * getCodeSize() codes, from encode().
+        * @param packed Receives ceil(count / 32) * getCodeSize() * 16 bytes.
+        */
+        void pack(const uint8_t *codes, size_t count, std::vector<uint8_t> &packed) const{
+
+            if (bits != 4)
+                throw std::logic_error("Only 4-bit codes can be packed.");
+
+            size_t blocks = (count + PackedBlock - 1) / PackedBlock;
+            packed.assign(blocks * subspaces * 16, 0);
+            for (size_t x = 0; x < count; x++){
+                size_t block = x / PackedBlock;
+                uint32_t lane = x % PackedBlock;
+                for (uint32_t m = 0; m < subspaces; m++){
+                    uint8_t &b = packed[(block * subspaces + m) * 16 + (lane % 16)];
+                    b |= (lane < 16) ? codes[x * subspaces + m] : (codes[x * subspaces + m] << 4);
+                }
+            }
+        }
+
+        /**
+        * Calculates the approximate distances of count packed vectors with
+        * byte tables and shuffle lookups.
+        *
+        * @param table The query tables, from computeTable().
+        * @param packed The codes, from pack().
+        * @param out Receives count distances.
+        */
+        void scanPacked(const float *table, const uint8_t *packed, size_t count, double *out){
+
+            if (bits != 4)
+                throw std::logic_error("Only 4-bit codes can be packed.");
+
+            // Byte tables: entry - min of its sub-space, in units of delta.
+            std::vector<uint8_t> lookup(subspaces * 16);
+            double bias = 0.0, range = 0.0;
+            for (uint32_t m = 0; m < subspaces; m++){
+                const float *t = table + m * 16;
+                float low = *std::min_element(t, t + 16), high = *std::max_element(t, t + 16);
+                bias += low;
+                range = std::max(range, (double) high - low);
+            }
+            double delta = (range > 0.0) ? range / 255.0 : 1.0;
+            for (uint32_t m = 0; m < subspaces; m++){
+                const float *t = table + m * 16;
+                float low = *std::min_element(t, t + 16);
+                for (uint32_t j = 0; j < 16; j++)
+                    lookup[m * 16 + j] = (uint8_t) nearbyint((t[j] - low) / delta);
+            }
+
+            size_t blocks = (count + PackedBlock - 1) / PackedBlock;
+            uint32_t sums[PackedBlock];
+            for (size_t block = 0; block < blocks; block++){
+                accumulate(&lookup[0], packed + block * subspaces * 16, subspaces, sums);
+                for (uint32_t j = 0; (j < PackedBlock) && (block * PackedBlock + j < count); j++){
+                    double sq = bias + delta * sums[j];
+                    out[block * PackedBlock + j] = (sq > 0.0) ? sqrt(sq) : 0.0;
+                }
+            }
+
+            ndf += count;
+            DistanceStatistics::count(EuclideanDistance<FeatureVector>::MetricType, count);
+        }
+
+        /**
+        * Finds the nearest encoded vectors by approximate distance.
+        *
+        * @param codes The encoded dataset, from encode().
+        * @param k The number of neighbors to keep, e.g. a few times the final k
+        * when they are to be re-ranked.
+        * @param result Receives up to k (distance, position) pairs, nearest first.
+        */
+        void kNearest(FeatureVector &query, const std::vector<uint8_t> &codes, size_t k, std::vector< std::pair<double, uint32_t> > &result){
+
+            std::vector<float> table(getTableSize());
+            computeTable(query, &table[0]);
+            size_t count = codes.size() / subspaces;
+            std::vector<double> distances(count);
+            if (count > 0)
+                scan(&table[0], &codes[0], count, &distances[0]);
+            select(distances, k, result);
+        }
+
+        /**
+        * @copydoc kNearest(FeatureVector &query, const std::vector<uint8_t> &codes, size_t k, std::vector< std::pair<double, uint32_t> > &result).
+        * The codes are packed (see pack()) and count is the number of vectors.
+        */
+        void kNearestPacked(FeatureVector &query, const std::vector<uint8_t> &packed, size_t count, size_t k, std::vector< std::pair<double, uint32_t> > &result){
+
+            std::vector<float> table(getTableSize());
+            computeTable(query, &table[0]);
+            std::vector<double> distances(count);
+            if (count > 0)
+                scanPacked(&table[0], &packed[0], count, &distances[0]);
+            select(distances, k, result);
+        }
+
+    private:
+
+        void check(const FeatureVector &obj) const{
+
+            if (dimension == 0)
+                throw std::runtime_error("The quantizer has not been trained.");
+            if (obj.size() != dimension)
+                throw std::length_error("The feature vectors do not have the same size.");
+        }
+
+        static uint32_t nearest(const double *point, const double *c, uint32_t k, uint32_t d){
+
+            uint32_t best = 0;
+            double bestDistance = DistanceKernels::squaredEuclidean(point, c, d);
+            for (uint32_t j = 1; j < k; j++){
+                double dist = DistanceKernels::squaredEuclidean(point, c + (size_t) j * d, d);
+                if (dist < bestDistance){
+                    bestDistance = dist;
+                    best = j;
+                }
+            }
+            return best;
+        }
+
+        // Lloyd iterations over n points of d values. An emptied cluster takes
+        // the point farthest from its centroid.
+        void kmeans(const double *points, size_t n, uint32_t d, double *c, uint32_t k) const{
+
+            std::vector<uint32_t> assignment(n);
+            std::vector<double> error(n);
+            std::vector<double> sums((size_t) k * d);
+            std::vector<size_t> sizes(k);
+
+            for (uint32_t it = 0; it < iterations; it++){
+                bool changed = false;
+                for (size_t x = 0; x < n; x++){
+                    uint32_t j = nearest(points + x * d, c, k, d);
+                    changed = changed || (j != assignment[x]) || (it == 0);
+                    assignment[x] = j;
+                    error[x] = DistanceKernels::squaredEuclidean(points + x * d, c + (size_t) j * d, d);
+                }
+                if (!changed)
+                    break;
+
+                std::fill(sums.begin(), sums.end(), 0.0);
+                std::fill(sizes.begin(), sizes.end(), 0);
+                for (size_t x = 0; x < n; x++){
+                    sizes[assignment[x]]++;
+                    for (uint32_t i = 0; i < d; i++)
+                        sums[(size_t) assignment[x] * d + i] += points[x * d + i];
+                }
+                for (uint32_t j = 0; j < k; j++){
+                    if (sizes[j] == 0){
+                        size_t far = std::max_element(error.begin(), error.end()) - error.begin();
+                        std::copy(points + far * d, points + far * d + d, c + (size_t) j * d);
+                        error[far] = 0.0;
+                    } else {
+                        for (uint32_t i = 0; i < d; i++)
+                            c[(size_t) j * d + i] = sums[(size_t) j * d + i] / sizes[j];
+                    }
+                }
+            }
+        }
+
+        static void select(std::vector<double> &distances, size_t k, std::vector< std::pair<double, uint32_t> > &result){
+
+            result.resize(distances.size());
+            for (size_t x = 0; x < distances.size(); x++)
+                result[x] = std::make_pair(distances[x], (uint32_t) x);
+            k = std::min(k, result.size());
+            std::partial_sort(result.begin(), result.begin() + k, result.end());
+            result.resize(k);
+        }
+
+        /**
+        * Sums the byte tables of one packed block into 32 totals.
+        */
+        static void accumulate(const uint8_t *lookup, const uint8_t *block, uint32_t m, uint32_t *sums){
+
+#ifdef HERMES_X86_DISPATCH
+            if (DistanceKernels::level() >= DistanceKernels::AVX2){
+                accumulateAvx2(lookup, block, m, sums);
+                return;
+            }
+#endif
+            for (uint32_t j = 0; j < PackedBlock; j++)
+                sums[j] = 0;
+            for (uint32_t s = 0; s < m; s++){
+                for (uint32_t j = 0; j < 16; j++){
+                    uint8_t b = block[s * 16 + j];
+                    sums[j] += lookup[s * 16 + (b & 15)];
+                    sums[j + 16] += lookup[s * 16 + (b >> 4)];
+                }
+            }
+        }
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+        static inline void shuffle(SimdLookup16 &r, const SimdLookup16 &table, const SimdLookup16 &index){
+#ifndef __clang__
+            r = __builtin_shuffle(table, index);
+#else
+            for (int j = 0; j < 16; j++)
+                r[j] = table[index[j] & 15];
+#endif
+        }
+
+        // 16-bit lanes hold 257 entries of at most 255; flush them before that.
+        static const uint32_t LookupFlush = 256;
+
+        static inline void accumulateLanes(const uint8_t *lookup, const uint8_t *block, uint32_t m, uint32_t *sums){
+
+            for (uint32_t j = 0; j < PackedBlock; j++)
+                sums[j] = 0;
+
+            for (uint32_t s0 = 0; s0 < m; s0 += LookupFlush){
+                uint32_t end = std::min(m, s0 + LookupFlush);
+                SimdLookupSum16 low = SimdLookupSum16(), high = SimdLookupSum16();
+                for (uint32_t s = s0; s < end; s++){
+                    SimdLookup16 table, codes, r;
+                    memcpy(&table, lookup + s * 16, 16);
+                    memcpy(&codes, block + s * 16, 16);
+                    shuffle(r, table, codes & 15);
+                    low += __builtin_convertvector(r, SimdLookupSum16);
+                    shuffle(r, table, codes >> 4);
+                    high += __builtin_convertvector(r, SimdLookupSum16);
+                }
+                for (int j = 0; j < 16; j++){
+                    sums[j] += low[j];
+                    sums[j + 16] += high[j];
+                }
+            }
+        }
+#endif
+
+#ifdef HERMES_X86_DISPATCH
+        __attribute__((target("avx2,fma"), flatten))
+        static void accumulateAvx2(const uint8_t *lookup, const uint8_t *block, uint32_t m, uint32_t *sums){
+            accumulateLanes(lookup, block, m, sums);
+        }
+#endif
+};
+
+#endif // PRODUCTQUANTIZER_H
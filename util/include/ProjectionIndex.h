@@ -0,0 +1,382 @@
+#ifndef PROJECTIONINDEX_H
+#define PROJECTIONINDEX_H
+
+#include <Evaluator.h>
+#include <FeatureVectorStore.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/**
+* Filter-and-refine index for Euclidean queries over a low-dimensional
+* projection. The rows of W are m orthonormal directions and mu is the mean
+* of a sample, so for every pair of vectors
+*
+*   ||q - x||^2 = ||W(q - x)||^2 + ||R(q - x)||^2
+*              >= ||Wq - Wx||^2 + (||R(q - mu)|| - ||R(x - mu)||)^2
+*
+* where R is the projection onto the remaining directions. Every object is
+* stored as its m projected coordinates followed by its residual norm
+* ||R(x - mu)||, so the bound is the plain Euclidean distance between two
+* rows of m + 1 values. Queries compute the bounds of all objects in one
+* batched pass over these rows (see DistanceKernels) and only read the full
+* vector of the objects whose bound does not rule them out.
+*
+* W holds either the m principal directions of a sample (PCA), which capture
+* most of the distance on real data, or m random orthonormal directions
+* (RANDOM), which need no fitting but give weaker bounds.
+*
+* The rows are stored as Entry values (float or double). The bounds are
+* lowered by the worst rounding error of the rows, so results are exact.
+*
+* The index keeps positions in the list, not copies: the list must outlive
+* the index and stay unchanged.
+*
+* Example:
+*   ProjectionIndex<FeatureVector> index(list, 32);
+*   std::vector< std::pair<double, uint32_t> > best;
+*   index.kNearest(query, 10, best);
+*
+* @arg FeatureVector The feature vector type.
+* @arg Entry The type of the stored rows: float or double.
+*/
+template <class FeatureVector = BasicArrayObject<double>, class Entry = float>
+class ProjectionIndex{
+
+    public:
+        enum Method{
+            // The principal directions of the sample, found by subspace
+            // iteration.
+            PCA = 0,
+            // Random Gaussian directions, orthonormalized.
+            RANDOM = 1
+        };
+
+        /**
+        * A query answer: the distance and the position of the object.
+        */
+        typedef std::pair<double, uint32_t> Result;
+
+    private:
+        // Rounds of subspace iteration run by PCA.
+        static const uint32_t PowerIterations = 8;
+
+        std::vector<FeatureVector> *objects;
+        Evaluator<FeatureVector> evaluator;
+        size_t dimension;
+        uint32_t projected;
+        // The sample mean, and the directions as projected rows of dimension values.
+        std::vector<double> mean;
+        std::vector<double> directions;
+        // One row of projected + 1 values per object.
+        FeatureVectorStore<Entry> table;
+        // Largest ||x - mu|| over the objects.
+        double maxNorm;
+        // Error of a stored row relative to ||x - mu||, see lowerBounds().
+        double tolerance;
+
+    public:
+
+        /**
+        * Fits the projection on a sample of the objects and fills the table.
+        *
+        * @param objects The objects to be indexed, all of the same size.
+        * @param dimensions The number of projected dimensions, at most the size of the objects.
+        * @param method How the directions are chosen.
+        * @param sampleSize The number of objects drawn to fit the projection.
+        * @param seed The seed of the random choices.
+        * @throw std::length_error If the objects do not have the same size.
+        */
+        ProjectionIndex(std::vector<FeatureVector> &objects, uint32_t dimensions = 16, Method method = PCA, uint32_t sampleSize = 1024, uint32_t seed = 5489)
+            : evaluator(Evaluator<FeatureVector>::EUCLIDEAN), table(0, FeatureVectorStore<Entry>::ROW_MAJOR){
+
+            this->objects = &objects;
+            dimension = objects.empty() ? 0 : objects[0].size();
+            for (size_t x = 0; x < objects.size(); x++)
+                if (objects[x].size() != dimension)
+                    throw std::length_error("The feature vectors do not have the same size.");
+            projected = (uint32_t) std::min((size_t) dimensions, dimension);
+
+            std::mt19937 random(seed);
+            fit(method, sampleSize, random);
+
+            // Error of each row (coordinates and residual) relative to ||x - mu||:
+            // the rounding to Entry, plus the cancellation in the residual,
+            // whose square is a difference of two sums of dimension terms.
+            double doubleError = (double) (dimension + projected + 1) * std::numeric_limits<double>::epsilon();
+            tolerance = 2.0 * std::numeric_limits<Entry>::epsilon() + std::sqrt(4.0 * doubleError);
+
+            table = FeatureVectorStore<Entry>(projected + 1, FeatureVectorStore<Entry>::ROW_MAJOR);
+            table.reserve(objects.size());
+            std::vector<Entry> row(projected + 1);
+            std::vector<double> centered(dimension);
+            maxNorm = 0.0;
+            for (size_t x = 0; x < objects.size(); x++){
+                maxNorm = std::max(maxNorm, project(objects[x], centered, row));
+                table.add(x, row.data());
+            }
+        }
+
+        size_t size() const{
+
+            return table.size();
+        }
+
+        /**
+        * Gets the number of projected dimensions.
+        */
+        uint32_t getProjectedDimension() const{
+
+            return projected;
+        }
+
+        /**
+        * Gets the projection directions, one row of getDimension() values each.
+        */
+        const std::vector<double> &getDirections() const{
+
+            return directions;
+        }
+
+        /**
+        * Gets the size of the indexed feature vectors.
+        */
+        size_t getDimension() const{
+
+            return dimension;
+        }
+
+        /**
+        * Returns the number of full distances computed by the queries.
+        */
+        uint64_t getStatistics(){
+
+            return evaluator.getStatistics();
+        }
+
+        void resetStatistics(){
+
+            evaluator.resetStatistics();
+        }
+
+        /**
+        * Computes the lower bounds of the Euclidean distances between the
+        * query and every object.
+        *
+        * @param query The query feature vector.
+        * @param bounds Receives one lower bound per object.
+        * @throw std::length_error If the query does not have the size of the objects.
+        */
+        void lowerBounds(FeatureVector &query, std::vector<double> &bounds){
+
+            if (query.size() != dimension)
+                throw std::length_error("The feature vectors do not have the same size.");
+
+            bounds.assign(size(), 0.0);
+            if (bounds.empty())
+                return;
+
+            std::vector<Entry> row(projected + 1);
+            std::vector<double> centered(dimension);
+            double queryNorm = project(query, centered, row);
+            table.template getDistances< EuclideanDistance< FeatureVectorView<Entry> > >(row.data(), 0, table.size(), bounds.data());
+
+            // Each row is off by at most tolerance times the norm of its vector.
+            double slack = (queryNorm + maxNorm) * tolerance;
+            for (size_t x = 0; x < bounds.size(); x++)
+                bounds[x] = std::max(0.0, bounds[x] - slack);
+        }
+
+        /**
+        * Finds every object within radius of the query, nearest first.
+        *
+        * @param query The query feature vector.
+        * @param radius The query radius.
+        * @param result Receives (distance, position) pairs.
+        */
+        void range(FeatureVector &query, double radius, std::vector<Result> &result){
+
+            std::vector<double> bounds;
+            lowerBounds(query, bounds);
+
+            result.clear();
+            for (uint32_t x = 0; x < bounds.size(); x++){
+                if (bounds[x] > radius)
+                    continue;
+                double d = evaluator.getBoundedDistance(query, (*objects)[x], radius);
+                if (d <= radius)
+                    result.push_back(Result(d, x));
+            }
+            std::sort(result.begin(), result.end());
+        }
+
+        /**
+        * Finds the k nearest objects to the query, nearest first. Ties at the
+        * k-th distance are broken arbitrarily.
+        *
+        * @param query The query feature vector.
+        * @param k The number of neighbors.
+        * @param result Receives (distance, position) pairs.
+        */
+        void kNearest(FeatureVector &query, size_t k, std::vector<Result> &result){
+
+            result.clear();
+            if ((k == 0) || (size() == 0))
+                return;
+
+            std::vector<double> bounds;
+            lowerBounds(query, bounds);
+
+            // Objects are refined by increasing bound, so the scan stops at
+            // the first bound above the k-th distance.
+            std::vector<Result> order(bounds.size());
+            for (uint32_t x = 0; x < bounds.size(); x++)
+                order[x] = Result(bounds[x], x);
+            std::make_heap(order.begin(), order.end(), std::greater<Result>());
+
+            std::priority_queue<Result> best;
+            double tau = std::numeric_limits<double>::infinity();
+            while (!order.empty() && (order.front().first <= tau)){
+                uint32_t x = order.front().second;
+                std::pop_heap(order.begin(), order.end(), std::greater<Result>());
+                order.pop_back();
+
+                double d = evaluator.getBoundedDistance(query, (*objects)[x], tau);
+                if (best.size() < k){
+                    best.push(Result(d, x));
+                } else if (d < tau){
+                    best.pop();
+                    best.push(Result(d, x));
+                }
+                if (best.size() == k)
+                    tau = best.top().first;
+            }
+
+            result.resize(best.size());
+            for (size_t x = result.size(); x > 0; x--){
+                result[x - 1] = best.top();
+                best.pop();
+            }
+        }
+
+    private:
+
+        // Writes W(v - mu) and ||R(v - mu)|| into row and returns ||v - mu||.
+        double project(const FeatureVector &v, std::vector<double> &centered, std::vector<Entry> &row) const{
+
+            const typename FeatureVector::value_type *data = v.getRawData();
+            for (size_t i = 0; i < dimension; i++)
+                centered[i] = (double) data[i] - mean[i];
+            double norm = DistanceKernels::compute<DotProductKernel>(centered.data(), centered.data(), dimension);
+            double inside = 0.0;
+            for (uint32_t j = 0; j < projected; j++){
+                double y = DistanceKernels::compute<DotProductKernel>(&directions[j * dimension], centered.data(), dimension);
+                row[j] = (Entry) y;
+                inside += y * y;
+            }
+            row[projected] = (Entry) std::sqrt(std::max(0.0, norm - inside));
+            return std::sqrt(norm);
+        }
+
+        void fit(Method method, uint32_t sampleSize, std::mt19937 &random){
+
+            size_t n = objects->size();
+            size_t d = dimension;
+            mean.assign(d, 0.0);
+            directions.assign((size_t) projected * d, 0.0);
+            if (n == 0)
+                return;
+
+            // Sample without replacement: a partial Fisher-Yates shuffle.
+            std::vector<uint32_t> pick(n);
+            for (uint32_t x = 0; x < n; x++)
+                pick[x] = x;
+            size_t s = std::min((size_t) std::max(sampleSize, 1u), n);
+            for (size_t x = 0; x < s; x++)
+                std::swap(pick[x], pick[x + random() % (n - x)]);
+
+            std::vector<double> points(s * d);
+            for (size_t x = 0; x < s; x++){
+                const typename FeatureVector::value_type *data = (*objects)[pick[x]].getRawData();
+                for (size_t i = 0; i < d; i++){
+                    points[x * d + i] = (double) data[i];
+                    mean[i] += (double) data[i];
+                }
+            }
+            for (size_t i = 0; i < d; i++)
+                mean[i] /= s;
+            for (size_t x = 0; x < s; x++)
+                for (size_t i = 0; i < d; i++)
+                    points[x * d + i] -= mean[i];
+
+            std::normal_distribution<double> gaussian;
+            for (size_t i = 0; i < directions.size(); i++)
+                directions[i] = gaussian(random);
+            orthonormalize(random);
+            if (method != PCA)
+                return;
+
+            // Subspace iteration: directions <- orthonormal(directions * X^T * X).
+            std::vector<double> scores(s * projected), next(directions.size());
+            for (uint32_t round = 0; round < PowerIterations; round++){
+                for (size_t x = 0; x < s; x++)
+                    for (uint32_t j = 0; j < projected; j++)
+                        scores[x * projected + j] = DistanceKernels::compute<DotProductKernel>(&directions[j * d], &points[x * d], d);
+                std::fill(next.begin(), next.end(), 0.0);
+                for (size_t x = 0; x < s; x++){
+                    const double *point = &points[x * d];
+                    for (uint32_t j = 0; j < projected; j++){
+                        double w = scores[x * projected + j];
+                        double *direction = &next[j * d];
+                        for (size_t i = 0; i < d; i++)
+                            direction[i] += w * point[i];
+                    }
+                }
+                directions.swap(next);
+                orthonormalize(random);
+            }
+        }
+
+        // Modified Gram-Schmidt, run twice so the rows stay orthogonal to
+        // working precision. A row left with no norm of its own (rank
+        // deficient sample) is replaced by a random one.
+        void orthonormalize(std::mt19937 &random){
+
+            size_t d = dimension;
+            std::normal_distribution<double> gaussian;
+            for (uint32_t j = 0; j < projected; j++){
+                double *row = &directions[j * d];
+                double original = std::sqrt(DistanceKernels::compute<DotProductKernel>(row, row, d));
+                for (uint32_t attempt = 0; ; attempt++){
+                    for (uint32_t pass = 0; pass < 2; pass++){
+                        for (uint32_t p = 0; p < j; p++){
+                            const double *other = &directions[p * d];
+                            double dot = DistanceKernels::compute<DotProductKernel>(other, row, d);
+                            for (size_t i = 0; i < d; i++)
+                                row[i] -= dot * other[i];
+                        }
+                    }
+                    double norm = std::sqrt(DistanceKernels::compute<DotProductKernel>(row, row, d));
+                    if ((norm > 1e-8 * original) && (norm > 0.0)){
+                        for (size_t i = 0; i < d; i++)
+                            row[i] /= norm;
+                        break;
+                    }
+                    if (attempt == 16)
+                        throw std::runtime_error("Could not find orthonormal projection directions.");
+                    for (size_t i = 0; i < d; i++)
+                        row[i] = gaussian(random);
+                    original = std::sqrt(DistanceKernels::compute<DotProductKernel>(row, row, d));
+                }
+            }
+        }
+};
+
+#endif // PROJECTIONINDEX_H
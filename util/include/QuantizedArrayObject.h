@@ -0,0 +1,140 @@
+#ifndef QUANTIZEDARRAYOBJECT_H
+#define QUANTIZEDARRAYOBJECT_H
+
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+/**
+* A scalar-quantized feature vector, as produced by ScalarQuantizer:
+* +-----+------+-------+--------+---------+--------------+----------------+
+* | OID | Size | Scale | Offset | CodeSum | SquaredNorm  | Codes []       |
+* +-----+------+-------+--------+---------+--------------+----------------+
+*
+* Dimension i decodes to offset + scale * codes[i] when the scale is per
+* vector; with per-dimension scales the quantizer holds them and Scale and
+* Offset are 1 and 0. CodeSum and SquaredNorm (of the decoded vector) let
+* Euclidean distances be computed from an integer dot product.
+*
+* @arg Code int8_t for int8 codes, uint16_t for binary16 (half float) codes.
+*/
+template <class Code>
+class QuantizedArrayObject{
+
+    private:
+        std::vector<Code> codes;
+        uint32_t OID;
+        double scale;
+        double offset;
+        int64_t codeSum;
+        double squaredNorm;
+
+    public:
+
+        typedef Code value_type;
+
+        QuantizedArrayObject(){
+            OID = 0;
+            scale = 1.0;
+            offset = 0.0;
+            codeSum = 0;
+            squaredNorm = 0.0;
+        }
+
+        void setOID(uint32_t OID){
+            this->OID = OID;
+        }
+
+        uint32_t getOID() const{
+            return OID;
+        }
+
+        uint32_t size() const{
+            return codes.size();
+        }
+
+        /**
+        * Replaces the codes and the decoding parameters.
+        * @param codes The n codes.
+        * @param scale The per-vector scale (1 with per-dimension scales).
+        * @param offset The per-vector offset (0 with per-dimension scales).
+        * @param squaredNorm The squared norm of the decoded vector.
+        */
+        void set(const Code *codes, uint32_t n, double scale, double offset, double squaredNorm){
+
+            this->codes.assign(codes, codes + n);
+            this->scale = scale;
+            this->offset = offset;
+            this->squaredNorm = squaredNorm;
+            codeSum = 0;
+            for (uint32_t x = 0; x < n; x++)
+                codeSum += (int64_t) codes[x];
+        }
+
+        const Code *getRawData() const{
+            return codes.empty() ? NULL : &codes[0];
+        }
+
+        Code operator[](uint32_t idx) const{
+            return codes[idx];
+        }
+
+        double getScale() const{
+            return scale;
+        }
+
+        double getOffset() const{
+            return offset;
+        }
+
+        int64_t getCodeSum() const{
+            return codeSum;
+        }
+
+        double getSquaredNorm() const{
+            return squaredNorm;
+        }
+
+        void setSquaredNorm(double squaredNorm){
+            this->squaredNorm = squaredNorm;
+        }
+
+        uint32_t getSerializedSize() const{
+            return 2 * sizeof(uint32_t) + 2 * sizeof(double) + sizeof(int64_t) + sizeof(double) + sizeof(Code) * codes.size();
+        }
+
+        /**
+        * Writes the object into out, which must hold getSerializedSize() bytes.
+        */
+        void serialize(unsigned char *out) const{
+
+            uint32_t n = codes.size();
+            memcpy(out, &OID, sizeof(uint32_t)); out += sizeof(uint32_t);
+            memcpy(out, &n, sizeof(uint32_t)); out += sizeof(uint32_t);
+            memcpy(out, &scale, sizeof(double)); out += sizeof(double);
+            memcpy(out, &offset, sizeof(double)); out += sizeof(double);
+            memcpy(out, &codeSum, sizeof(int64_t)); out += sizeof(int64_t);
+            memcpy(out, &squaredNorm, sizeof(double)); out += sizeof(double);
+            if (n > 0)
+                memcpy(out, &codes[0], sizeof(Code) * n);
+        }
+
+        /**
+        * Reads an object written by serialize().
+        */
+        void unserialize(const unsigned char *in){
+
+            uint32_t n;
+            memcpy(&OID, in, sizeof(uint32_t)); in += sizeof(uint32_t);
+            memcpy(&n, in, sizeof(uint32_t)); in += sizeof(uint32_t);
+            memcpy(&scale, in, sizeof(double)); in += sizeof(double);
+            memcpy(&offset, in, sizeof(double)); in += sizeof(double);
+            memcpy(&codeSum, in, sizeof(int64_t)); in += sizeof(int64_t);
+            memcpy(&squaredNorm, in, sizeof(double)); in += sizeof(double);
+            codes.resize(n);
+            if (n > 0)
+                memcpy(&codes[0], in, sizeof(Code) * n);
+        }
+};
+
+#endif // QUANTIZEDARRAYOBJECT_H
@@ -0,0 +1,429 @@
+#ifndef SCALARQUANTIZER_H
+#define SCALARQUANTIZER_H
+
+#include <Evaluator.h>
+#include <QuantizedArrayObject.h>
+#include <QuantizedKernels.h>
+#include <DistanceStatistics.h>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+/**
+* Compresses feature vectors into int8 or binary16 codes and compares the
+* codes directly, at 1/8 or 1/4 of the memory traffic of doubles.
+*
+* int8 codes map each value x to round((x - offset) / scale), clamped to
+* [-127, 127]. With PER_DIMENSION, offset and scale come from the range of
+* each dimension over a training sample (see train()), values outside it
+* saturate, and Euclidean and CityBlock distances run the weighted integer
+* kernels. With PER_VECTOR, every vector keeps its own range, no training is
+* needed, and Euclidean distances come from an integer dot product. binary16
+* codes (Code = uint16_t) need neither.
+*
+* Every other metric decodes both vectors to float and runs the float kernel
+* of its class. Approximate distances can be refined against the original
+* vectors with rerank().
+*
+* Example:
+*   ScalarQuantizer<int8_t> sq(Evaluator<FeatureVector>::EUCLIDEAN);
+*   sq.train(list);
+*   std::vector< QuantizedArrayObject<int8_t> > codes;
+*   sq.encode(list, codes);
+*   std::vector< std::pair<double, uint32_t> > best;
+*   sq.kNearest(query, codes, 4 * k, best);
+*   sq.rerank(query, list, best, k);
+*
+* @arg Code int8_t or uint16_t (binary16).
+* @arg FeatureVector The type of the original feature vectors.
+*/
+template <class Code = int8_t, class FeatureVector = BasicArrayObject<double> >
+class ScalarQuantizer{
+
+    public:
+        enum Mode{
+            // A scale and an offset per dimension, learnt by train().
+            PER_DIMENSION = 0,
+            // A scale and an offset per vector.
+            PER_VECTOR = 1
+        };
+
+        typedef QuantizedArrayObject<Code> QuantizedVector;
+
+    private:
+        typedef double (*FloatKernel)(const float *, const float *, size_t);
+
+        uint16_t types;
+        Mode mode;
+        uint64_t ndf;
+        std::vector<double> offsets;
+        std::vector<double> scales;
+        // scales as float, and squared, for the weighted kernels.
+        std::vector<float> weights;
+        std::vector<float> squaredWeights;
+        // NULL for MINKOWSKI, whose order is given at runtime.
+        FloatKernel floatKernel;
+        double minkowskiOrder;
+        Evaluator<FeatureVector> exact;
+
+    public:
+
+        /**
+        * Constructor.
+        *
+        * @param types The distance function number, as in Evaluator.
+        * @param mode Where int8 scales are kept (ignored by binary16 codes).
+        */
+        ScalarQuantizer(uint16_t types = Evaluator<FeatureVector>::EUCLIDEAN, Mode mode = PER_DIMENSION){
+
+            this->mode = mode;
+            minkowskiOrder = 2.0;
+            setType(types);
+            resetStatistics();
+        }
+
+        /**
+        * Sets the distance function.
+        *
+        * @param distanceFunction The distance function number, as in Evaluator.
+        * @throw std::invalid_argument If it is not a known distance function.
+        */
+        void setType(uint16_t distanceFunction){
+
+            FloatKernel kernel;
+            switch (distanceFunction){
+                case Evaluator<FeatureVector>::EUCLIDEAN: kernel = &EuclideanDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::CITYBLOCK: kernel = &ManhattanDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::CHEBYSHEV: kernel = &ChebyshevDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::JEFFREY: kernel = &JeffreyDivergence<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::CANBERRA: kernel = &CanberraDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::BRAYCURTIS: kernel = &BrayCurtisDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::QUISQUARE: kernel = &ChiSquareDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::HAMMING: kernel = &HammingDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::COSINE: kernel = &CosineDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::DOTPRODUCT: kernel = &DotProductDistance<FeatureVector>::template compute<float>; break;
+                case Evaluator<FeatureVector>::MINKOWSKI: kernel = NULL; break;
+                default:
+                    throw std::invalid_argument("The distance function is not supported by the scalar quantizer.");
+            }
+
+            types = distanceFunction;
+            floatKernel = kernel;
+            exact.setType(distanceFunction);
+        }
+
+        uint16_t getType() const{
+
+            return types;
+        }
+
+        /**
+        * Sets the order p of the MINKOWSKI type (2 by default), for both the
+        * approximate and the re-ranking distances.
+        *
+        * @param p The order.
+        * @throw std::invalid_argument If p is not a positive finite number.
+        */
+        void setMinkowskiOrder(double p){
+
+            exact.setMinkowskiOrder(p);
+            minkowskiOrder = p;
+        }
+
+        double getMinkowskiOrder() const{
+
+            return minkowskiOrder;
+        }
+
+        Mode getMode() const{
+
+            return mode;
+        }
+
+        void resetStatistics(){
+
+            ndf = 0;
+            exact.resetStatistics();
+        }
+
+        /**
+        * Returns the number of approximate distances computed.
+        */
+        uint64_t getStatistics() const{
+
+            return ndf;
+        }
+
+        /**
+        * Returns the number of exact distances computed by rerank().
+        */
+        uint64_t getRerankStatistics(){
+
+            return exact.getStatistics();
+        }
+
+        /**
+        * Learns the per-dimension ranges. Only needed by int8 codes in
+        * PER_DIMENSION mode.
+        *
+        * @param sample A representative set of feature vectors of equal size.
+        */
+        void train(const std::vector<FeatureVector> &sample){
+
+            if (sample.empty())
+                return;
+
+            uint32_t size = sample[0].size();
+            std::vector<double> low(size), high(size);
+            for (uint32_t i = 0; i < size; i++)
+                low[i] = high[i] = sample[0][i];
+            for (size_t x = 1; x < sample.size(); x++){
+                if (sample[x].size() != size)
+                    throw std::length_error("The feature vectors do not have the same size.");
+                for (uint32_t i = 0; i < size; i++){
+                    low[i] = std::min(low[i], (double) sample[x][i]);
+                    high[i] = std::max(high[i], (double) sample[x][i]);
+                }
+            }
+
+            offsets.resize(size);
+            scales.resize(size);
+            weights.resize(size);
+            squaredWeights.resize(size);
+            for (uint32_t i = 0; i < size; i++){
+                offsets[i] = (low[i] + high[i]) / 2.0;
+                scales[i] = (high[i] > low[i]) ? (high[i] - low[i]) / (2.0 * MaxCode) : 1.0;
+                weights[i] = (float) scales[i];
+                squaredWeights[i] = (float) (scales[i] * scales[i]);
+            }
+        }
+
+        /**
+        * Returns the trained dimension (0 before train()).
+        */
+        uint32_t getDimension() const{
+
+            return offsets.size();
+        }
+
+        /**
+        * Quantizes one feature vector.
+        */
+        QuantizedVector encode(const FeatureVector &obj) const{
+
+            QuantizedVector q;
+            std::vector<Code> codes(obj.size());
+            double scale = 1.0, offset = 0.0;
+            encodeCodes(obj, codes.empty() ? NULL : &codes[0], scale, offset);
+
+            q.set(codes.empty() ? NULL : &codes[0], codes.size(), scale, offset, 0.0);
+            q.setSquaredNorm(squaredNorm(q));
+            q.setOID(obj.getOID());
+            return q;
+        }
+
+        /**
+        * Quantizes a list of feature vectors.
+        *
+        * @param out Receives one quantized vector per object, in order.
+        */
+        void encode(const std::vector<FeatureVector> &objects, std::vector<QuantizedVector> &out) const{
+
+            out.clear();
+            out.reserve(objects.size());
+            for (size_t x = 0; x < objects.size(); x++)
+                out.push_back(encode(objects[x]));
+        }
+
+        /**
+        * Reconstructs an approximation of the original feature vector.
+        */
+        FeatureVector decode(const QuantizedVector &q) const{
+
+            std::vector<float> values(q.size());
+            decodeCodes(q, values.empty() ? NULL : &values[0]);
+            FeatureVector obj;
+            obj.setOID(q.getOID());
+            for (size_t i = 0; i < values.size(); i++)
+                obj.set((typename FeatureVector::value_type) values[i]);
+            return obj;
+        }
+
+        /**
+        * Calculates the approximate distance between two quantized vectors.
+        *
+        * @return The distance between the decoded vectors, up to float rounding.
+        */
+        double getDistance(const QuantizedVector &a, const QuantizedVector &b){
+
+            if (a.size() != b.size())
+                throw std::length_error("The feature vectors do not have the same size.");
+
+            ndf++;
+            DistanceStatistics::count(types);
+            return approximate(a, b);
+        }
+
+        /**
+        * Finds the nearest quantized vectors by approximate distance.
+        *
+        * @param query The (original) query, quantized on the fly.
+        * @param codes The quantized dataset.
+        * @param k The number of neighbors to keep, e.g. a few times the final k
+        * when they are to be re-ranked.
+        * @param result Receives up to k (distance, position in codes) pairs, nearest first.
+        */
+        void kNearest(FeatureVector &query, std::vector<QuantizedVector> &codes, size_t k, std::vector< std::pair<double, uint32_t> > &result){
+
+            QuantizedVector q = encode(query);
+            result.clear();
+            result.reserve(codes.size());
+            for (size_t x = 0; x < codes.size(); x++)
+                result.push_back(std::make_pair(getDistance(q, codes[x]), (uint32_t) x));
+
+            k = std::min(k, result.size());
+            std::partial_sort(result.begin(), result.begin() + k, result.end());
+            result.resize(k);
+        }
+
+        /**
+        * Replaces approximate distances by exact ones against the original
+        * vectors and keeps the k nearest (see Evaluator::rerank()).
+        *
+        * @param originals The original feature vectors, indexed like the codes.
+        * @param candidates (distance, position) pairs, e.g. from kNearest().
+        */
+        void rerank(FeatureVector &query, std::vector<FeatureVector> &originals, std::vector< std::pair<double, uint32_t> > &candidates, size_t k){
+
+            exact.rerank(query, originals, candidates, k);
+        }
+
+    private:
+        static const int MaxCode = 127;
+
+        static int8_t quantize(double x, double offset, double scale){
+
+            double c = nearbyint((x - offset) / scale);
+            return (int8_t) std::max(-(double) MaxCode, std::min((double) MaxCode, c));
+        }
+
+        void encodeCodes(const FeatureVector &obj, int8_t *codes, double &scale, double &offset) const{
+
+            uint32_t n = obj.size();
+            if (mode == PER_VECTOR){
+                if (n == 0)
+                    return;
+                double low = obj[0], high = obj[0];
+                for (uint32_t i = 1; i < n; i++){
+                    low = std::min(low, (double) obj[i]);
+                    high = std::max(high, (double) obj[i]);
+                }
+                offset = (low + high) / 2.0;
+                scale = (high > low) ? (high - low) / (2.0 * MaxCode) : 1.0;
+                for (uint32_t i = 0; i < n; i++)
+                    codes[i] = quantize(obj[i], offset, scale);
+            } else {
+                if (offsets.empty())
+                    throw std::runtime_error("The quantizer has not been trained.");
+                if (n != offsets.size())
+                    throw std::length_error("The feature vectors do not have the same size.");
+                for (uint32_t i = 0; i < n; i++)
+                    codes[i] = quantize(obj[i], offsets[i], scales[i]);
+            }
+        }
+
+        void encodeCodes(const FeatureVector &obj, uint16_t *codes, double &, double &) const{
+
+            for (uint32_t i = 0; i < obj.size(); i++)
+                codes[i] = QuantizedKernels::floatToHalf((float) obj[i]);
+        }
+
+        template <class T>
+        void decodeCodes(const QuantizedArrayObject<int8_t> &q, T *out) const{
+
+            const int8_t *c = q.getRawData();
+            if (mode == PER_VECTOR){
+                for (uint32_t i = 0; i < q.size(); i++)
+                    out[i] = (T) (q.getOffset() + q.getScale() * c[i]);
+            } else {
+                for (uint32_t i = 0; i < q.size(); i++)
+                    out[i] = (T) (offsets[i] + scales[i] * c[i]);
+            }
+        }
+
+        void decodeCodes(const QuantizedArrayObject<uint16_t> &q, float *out) const{
+
+            QuantizedKernels::decodeHalf(q.getRawData(), out, q.size());
+        }
+
+        // The squared norm of the decoded vector, in double precision.
+        double squaredNorm(const QuantizedArrayObject<int8_t> &q) const{
+
+            std::vector<double> values(q.size());
+            if (q.size() > 0)
+                decodeCodes(q, &values[0]);
+            double norm = 0.0;
+            for (size_t i = 0; i < values.size(); i++)
+                norm += values[i] * values[i];
+            return norm;
+        }
+
+        double squaredNorm(const QuantizedArrayObject<uint16_t> &q) const{
+
+            double norm = 0.0;
+            for (uint32_t i = 0; i < q.size(); i++){
+                double v = QuantizedKernels::halfToFloat(q[i]);
+                norm += v * v;
+            }
+            return norm;
+        }
+
+        double approximate(const QuantizedArrayObject<int8_t> &a, const QuantizedArrayObject<int8_t> &b) const{
+
+            uint32_t n = a.size();
+            if (mode == PER_DIMENSION){
+                if (n != offsets.size())
+                    throw std::length_error("The feature vectors do not have the same size.");
+                // The offsets cancel out: a - b = scale * (ca - cb).
+                if (types == Evaluator<FeatureVector>::EUCLIDEAN)
+                    return sqrt(QuantizedKernels::weightedSquaredEuclidean(a.getRawData(), b.getRawData(), &squaredWeights[0], n));
+                if (types == Evaluator<FeatureVector>::CITYBLOCK)
+                    return QuantizedKernels::weightedManhattan(a.getRawData(), b.getRawData(), &weights[0], n);
+            } else if (types == Evaluator<FeatureVector>::EUCLIDEAN){
+                // |a - b|^2 = |a|^2 + |b|^2 - 2 a.b, with
+                // a.b = n oa ob + oa sb sum(cb) + ob sa sum(ca) + sa sb ca.cb.
+                double dot = n * a.getOffset() * b.getOffset()
+                           + a.getOffset() * b.getScale() * b.getCodeSum()
+                           + b.getOffset() * a.getScale() * a.getCodeSum()
+                           + a.getScale() * b.getScale() * QuantizedKernels::dotProduct(a.getRawData(), b.getRawData(), n);
+                double sq = a.getSquaredNorm() + b.getSquaredNorm() - 2.0 * dot;
+                return (sq > 0.0) ? sqrt(sq) : 0.0;
+            }
+            return decoded(a, b);
+        }
+
+        double approximate(const QuantizedArrayObject<uint16_t> &a, const QuantizedArrayObject<uint16_t> &b) const{
+
+            return decoded(a, b);
+        }
+
+        // Decodes both vectors into per-thread scratch and runs the float kernel.
+        double decoded(const QuantizedVector &a, const QuantizedVector &b) const{
+
+            static thread_local std::vector<float> fa, fb;
+            fa.resize(a.size());
+            fb.resize(b.size());
+            const float *pa = NULL, *pb = NULL;
+            if (a.size() > 0){
+                decodeCodes(a, &fa[0]);
+                decodeCodes(b, &fb[0]);
+                pa = &fa[0];
+                pb = &fb[0];
+            }
+            if (floatKernel == NULL)
+                return MinkowskiDistance<FeatureVector>::computeRuntime(pa, pb, a.size(), minkowskiOrder);
+            return floatKernel(pa, pb, a.size());
+        }
+};
+
+#endif // SCALARQUANTIZER_H
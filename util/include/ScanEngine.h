@@ -0,0 +1,340 @@
+#ifndef SCANENGINE_H
+#define SCANENGINE_H
+
+#include <Evaluator.h>
+#include <FeatureVectorStore.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <stdint.h>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+* Exact linear k-nearest neighbor and range scans, split across threads.
+*
+* Every thread scans a contiguous part of the collection with its own
+* Evaluator and keeps a bounded heap of its k best candidates. The k-th
+* distance of any thread bounds the global one, so each thread publishes it
+* to a shared threshold that only decreases, and all threads use the
+* tightest one known as the bound of their early-abandoning distances.
+*
+* Candidates are ranked by (distance, position), so the answer is the same
+* whatever the number of threads and their timing.
+*
+* Example:
+*   ScanEngine<FeatureVector> scan(Evaluator<FeatureVector>::EUCLIDEAN);
+*   std::vector< std::pair<double, uint32_t> > best;
+*   scan.kNearest(query, list, 10, best);
+*
+* @arg FeatureVector The feature vector type.
+*/
+template <class FeatureVector = BasicArrayObject<double> >
+class ScanEngine{
+
+    public:
+        /**
+        * A query answer: the distance and the OID of the feature vector.
+        */
+        typedef std::pair<double, uint32_t> Result;
+
+    private:
+        typedef typename FeatureVector::value_type DType;
+        typedef FeatureVectorView<DType> View;
+
+        struct Candidate{
+            double dist;
+            uint32_t position;
+
+            bool operator<(const Candidate &other) const{
+                return (dist < other.dist) || ((dist == other.dist) && (position < other.position));
+            }
+        };
+
+        // Smaller parts are not worth a thread.
+        static const size_t MinChunk = 1024;
+
+        uint16_t types;
+        double minkowskiOrder;
+        uint32_t threads;
+        std::atomic<uint64_t> ndf;
+
+    public:
+
+        /**
+        * Constructor.
+        *
+        * @param types The distance function number, as in Evaluator.
+        * @param threads The number of threads (0 for one per hardware thread).
+        */
+        ScanEngine(uint16_t types, uint32_t threads = 0){
+
+            this->types = types;
+            minkowskiOrder = 2.0;
+            setThreads(threads);
+            resetStatistics();
+        }
+
+        void setType(uint16_t types){
+
+            this->types = types;
+        }
+
+        uint16_t getType() const{
+
+            return types;
+        }
+
+        /**
+        * Sets the order p of the MINKOWSKI type, as in Evaluator (2 by default).
+        *
+        * @param p The order.
+        * @throw std::invalid_argument If p is not a positive finite number.
+        */
+        void setMinkowskiOrder(double p){
+
+            MinkowskiDistance<FeatureVector>::checkOrder(p);
+            minkowskiOrder = p;
+        }
+
+        double getMinkowskiOrder() const{
+
+            return minkowskiOrder;
+        }
+
+        void setThreads(uint32_t threads){
+
+            this->threads = (threads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+        }
+
+        uint32_t getThreads() const{
+
+            return threads;
+        }
+
+        /**
+        * Returns the number of distances computed by the scans.
+        */
+        uint64_t getStatistics() const{
+
+            return ndf.load();
+        }
+
+        void resetStatistics(){
+
+            ndf = 0;
+        }
+
+        /**
+        * Finds the k nearest feature vectors to the query, nearest first.
+        *
+        * @param query The query feature vector.
+        * @param list The feature vectors to be scanned.
+        * @param k The number of neighbors.
+        * @param result Receives (distance, OID) pairs.
+        */
+        void kNearest(FeatureVector &query, std::vector<FeatureVector> &list, size_t k, std::vector<Result> &result){
+
+            std::vector<Candidate> best;
+            scanNearest(query, ListSource(list), list.size(), k, best);
+            answer(best, ListSource(list), result);
+        }
+
+        /**
+        * @copydoc kNearest(FeatureVector &query, std::vector<FeatureVector> &list, size_t k, std::vector<Result> &result).
+        */
+        void kNearest(FeatureVector &query, const FeatureVectorStore<DType> &store, size_t k, std::vector<Result> &result){
+
+            View q(query.getOID(), query.getRawData(), query.size());
+            std::vector<Candidate> best;
+            scanNearest(q, StoreSource(store), store.size(), k, best);
+            answer(best, StoreSource(store), result);
+        }
+
+        /**
+        * Finds every feature vector within radius of the query, nearest first.
+        *
+        * @param query The query feature vector.
+        * @param list The feature vectors to be scanned.
+        * @param radius The query radius.
+        * @param result Receives (distance, OID) pairs.
+        */
+        void range(FeatureVector &query, std::vector<FeatureVector> &list, double radius, std::vector<Result> &result){
+
+            std::vector<Candidate> found;
+            scanRange(query, ListSource(list), list.size(), radius, found);
+            answer(found, ListSource(list), result);
+        }
+
+        /**
+        * @copydoc range(FeatureVector &query, std::vector<FeatureVector> &list, double radius, std::vector<Result> &result).
+        */
+        void range(FeatureVector &query, const FeatureVectorStore<DType> &store, double radius, std::vector<Result> &result){
+
+            View q(query.getOID(), query.getRawData(), query.size());
+            std::vector<Candidate> found;
+            scanRange(q, StoreSource(store), store.size(), radius, found);
+            answer(found, StoreSource(store), result);
+        }
+
+    private:
+
+        struct ListSource{
+            std::vector<FeatureVector> *list;
+            ListSource(std::vector<FeatureVector> &list) : list(&list){
+            }
+            FeatureVector &operator()(size_t i) const{
+                return (*list)[i];
+            }
+            uint32_t getOID(size_t i) const{
+                return (*list)[i].getOID();
+            }
+        };
+
+        struct StoreSource{
+            const FeatureVectorStore<DType> *store;
+            StoreSource(const FeatureVectorStore<DType> &store) : store(&store){
+            }
+            View operator()(size_t i) const{
+                return store->getView(i);
+            }
+            uint32_t getOID(size_t i) const{
+                return store->getOID(i);
+            }
+        };
+
+        template <class Object, class Source>
+        void scanNearest(Object &query, const Source &source, size_t n, size_t k, std::vector<Candidate> &best){
+
+            std::vector< std::vector<Candidate> > heaps(parts(n));
+            std::atomic<double> bound(std::numeric_limits<double>::infinity());
+
+            run(n, heaps.size(), [&](uint32_t t, size_t begin, size_t end){
+                Evaluator<Object> evaluator(types);
+                evaluator.setMinkowskiOrder(minkowskiOrder);
+                std::vector<Candidate> &heap = heaps[t];
+                heap.reserve(std::min(k, end - begin));
+                for (size_t x = begin; (x < end) && (k > 0); x++){
+                    double limit = bound.load(std::memory_order_relaxed);
+                    if ((heap.size() == k) && (heap.front().dist < limit))
+                        limit = heap.front().dist;
+
+                    auto &&object = source(x);
+                    Candidate c = {evaluator.getBoundedDistance(query, object, limit), (uint32_t) x};
+                    if (c.dist > limit)
+                        continue;
+
+                    if (heap.size() < k){
+                        heap.push_back(c);
+                        std::push_heap(heap.begin(), heap.end());
+                    } else if (c < heap.front()){
+                        std::pop_heap(heap.begin(), heap.end());
+                        heap.back() = c;
+                        std::push_heap(heap.begin(), heap.end());
+                    } else {
+                        continue;
+                    }
+                    if (heap.size() == k)
+                        tighten(bound, heap.front().dist);
+                }
+                ndf += evaluator.getStatistics();
+            });
+
+            merge(heaps, best);
+            if (best.size() > k)
+                best.resize(k);
+        }
+
+        template <class Object, class Source>
+        void scanRange(Object &query, const Source &source, size_t n, double radius, std::vector<Candidate> &found){
+
+            std::vector< std::vector<Candidate> > pieces(parts(n));
+
+            run(n, pieces.size(), [&](uint32_t t, size_t begin, size_t end){
+                Evaluator<Object> evaluator(types);
+                evaluator.setMinkowskiOrder(minkowskiOrder);
+                for (size_t x = begin; x < end; x++){
+                    auto &&object = source(x);
+                    Candidate c = {evaluator.getBoundedDistance(query, object, radius), (uint32_t) x};
+                    if (c.dist <= radius)
+                        pieces[t].push_back(c);
+                }
+                ndf += evaluator.getStatistics();
+            });
+
+            merge(pieces, found);
+        }
+
+        uint32_t parts(size_t n) const{
+
+            size_t chunks = (n + MinChunk - 1) / MinChunk;
+            return std::max((size_t) 1, std::min((size_t) threads, chunks));
+        }
+
+        // Runs task(t, begin, end) over count contiguous parts of [0, n), the
+        // first one on the calling thread, and rethrows the first failure.
+        template <class Task>
+        void run(size_t n, uint32_t count, const Task &task){
+
+            DistanceStatistics::QueryCounters *query = DistanceStatistics::getCurrentQuery();
+            std::vector<std::exception_ptr> errors(count);
+            auto body = [&](uint32_t t){
+                try {
+                    if (query != NULL){
+                        DistanceStatistics::QueryScope scope(*query);
+                        task(t, n * t / count, n * (t + 1) / count);
+                    } else {
+                        task(t, n * t / count, n * (t + 1) / count);
+                    }
+                } catch (...){
+                    errors[t] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for (uint32_t t = 1; t < count; t++){
+                try {
+                    workers.push_back(std::thread(body, t));
+                } catch (std::system_error &){
+                    // No threads on this platform: do the part here.
+                    body(t);
+                }
+            }
+            body(0);
+            for (size_t x = 0; x < workers.size(); x++)
+                workers[x].join();
+
+            for (uint32_t t = 0; t < count; t++)
+                if (errors[t])
+                    std::rethrow_exception(errors[t]);
+        }
+
+        static void merge(std::vector< std::vector<Candidate> > &parts, std::vector<Candidate> &out){
+
+            out.clear();
+            for (size_t x = 0; x < parts.size(); x++)
+                out.insert(out.end(), parts[x].begin(), parts[x].end());
+            std::sort(out.begin(), out.end());
+        }
+
+        template <class Source>
+        static void answer(const std::vector<Candidate> &candidates, const Source &source, std::vector<Result> &result){
+
+            result.resize(candidates.size());
+            for (size_t x = 0; x < candidates.size(); x++)
+                result[x] = Result(candidates[x].dist, source.getOID(candidates[x].position));
+        }
+
+        // Lowers the shared threshold to d unless it is already lower.
+        static void tighten(std::atomic<double> &bound, double d){
+
+            double current = bound.load(std::memory_order_relaxed);
+            while ((d < current) && !bound.compare_exchange_weak(current, d, std::memory_order_relaxed)){
+            }
+        }
+};
+
+#endif // SCANENGINE_H
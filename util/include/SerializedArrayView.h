@@ -0,0 +1,112 @@
+#ifndef SERIALIZEDARRAYVIEW_H
+#define SERIALIZEDARRAYVIEW_H
+
+#include <cstring>
+#include <stdint.h>
+#include <string>
+
+/**
+* A read-only view of a feature vector serialized by
+* BasicArrayObject::serialize():
+* +-----+------+------------------+
+* | OID | Size | Vector Data []   |
+* +-----+------+------------------+
+*
+* Nothing is decoded or copied: getRawData() points into the given buffer,
+* which must outlive the view and be aligned for DType (buffers from new[],
+* malloc() or std::string are). The view has the interface the distance
+* functions and Evaluator need, so candidates can be compared straight from
+* their storage:
+*
+*   SerializedArrayView<double> a(blobA), b(blobB);
+*   EuclideanDistance< SerializedArrayView<double> > d;
+*   double dist = d.getDistance(a, b);
+*
+* To compare a BasicArrayObject query against a view, use the metric static
+* kernels: EuclideanDistance<FeatureVector>::compute(q.getRawData(),
+* b.getRawData(), b.size()).
+*
+* @arg DType The data type of each position.
+*/
+template <class DType>
+class SerializedArrayView{
+
+    private:
+        const DType *data;
+        uint32_t dimension;
+        uint32_t OID;
+
+    public:
+
+        typedef DType value_type;
+
+        SerializedArrayView(){
+            data = NULL;
+            dimension = 0;
+            OID = 0;
+        }
+
+        /**
+        * Constructor Method.
+        * @param dataIn The serialized object.
+        * @param dataSize The byte vector size. When it is not 0 the size is
+        * taken from it, as in BasicArrayObject::unserialize().
+        */
+        SerializedArrayView(const unsigned char *dataIn, uint32_t dataSize = 0){
+
+            reset(dataIn, dataSize);
+        }
+
+        SerializedArrayView(const std::string &dataIn){
+
+            reset((const unsigned char *) dataIn.data(), dataIn.size());
+        }
+
+        /**
+        * Points the view at another serialized object.
+        * @copydetails SerializedArrayView(const unsigned char *dataIn, uint32_t dataSize).
+        */
+        void reset(const unsigned char *dataIn, uint32_t dataSize = 0){
+
+            memcpy(&OID, dataIn, sizeof(uint32_t));
+            if (dataSize != 0){
+                dimension = (dataSize - sizeof(uint32_t) - sizeof(uint32_t)) / sizeof(DType);
+            } else {
+                memcpy(&dimension, dataIn + sizeof(uint32_t), sizeof(uint32_t));
+            }
+            data = (const DType *) (dataIn + sizeof(uint32_t) + sizeof(uint32_t));
+        }
+
+        uint32_t getOID() const{
+            return OID;
+        }
+
+        /**
+        * @deprecated This method is deprecated. Use getOID() instead.
+        */
+        uint32_t GetOID() const{
+            return getOID();
+        }
+
+        uint32_t size() const{
+            return dimension;
+        }
+
+        uint32_t getSize() const{
+            return dimension;
+        }
+
+        const DType *getRawData() const{
+            return data;
+        }
+
+        const DType &operator[](uint32_t idx) const{
+            return data[idx];
+        }
+
+        uint32_t getSerializedSize() const{
+            return sizeof(uint32_t) + sizeof(uint32_t) + sizeof(DType) * dimension;
+        }
+};
+
+#endif // SERIALIZEDARRAYVIEW_H
@@ -0,0 +1,482 @@
+#ifndef TEXTCODEC_H
+#define TEXTCODEC_H
+
+#include <DistanceKernels.h>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+// Sixteen characters or bytes, the matching comparison masks, and the same
+// bits seen as four 32-bit words.
+typedef uint8_t SimdText16 __attribute__((vector_size(16)));
+typedef int8_t SimdTextMask16 __attribute__((vector_size(16)));
+typedef uint32_t SimdTextWord4 __attribute__((vector_size(16)));
+#endif
+
+/**
+* Base64 and hexadecimal codecs writing into caller-provided buffers.
+*
+* The Base64 alphabet is the URL-safe one of BasicArrayObject::base64Chars()
+* ('+' and '-' for 62 and 63), with '=' padding. Decoding stops at the first
+* character outside the alphabet, '=' included, exactly like
+* BasicArrayObject::fromBase64(). Blocks of 12 bytes (16 characters) are
+* translated with byte shuffles and lane comparisons when
+* DistanceKernels::level() is AVX2 or above, and with 256-entry tables
+* otherwise (SSE2 has no byte shuffle); both give the same bytes.
+*/
+class TextCodec{
+
+    public:
+
+        /**
+        * Gets the number of characters encodeBase64() writes for n bytes.
+        */
+        static size_t base64Size(size_t n){
+
+            return (n + 2) / 3 * 4;
+        }
+
+        /**
+        * Gets the largest number of bytes decodeBase64() writes for len
+        * characters.
+        */
+        static size_t base64DecodedSize(size_t len){
+
+            return len / 4 * 3 + ((len % 4 > 1) ? len % 4 - 1 : 0);
+        }
+
+        static const char *base64Alphabet(){
+
+            return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+-";
+        }
+
+        /**
+        * Gets the 6-bit value of a Base64 character, or -1 if c is not in
+        * the alphabet.
+        */
+        static int base64Value(char c){
+
+            return Tables::instance.base64[(unsigned char) c];
+        }
+
+        /**
+        * Encodes bytes as padded Base64.
+        * @param in The bytes.
+        * @param n The number of bytes.
+        * @param out Receives base64Size(n) characters (no terminator).
+        * @return The number of characters written.
+        */
+        static size_t encodeBase64(const unsigned char *in, size_t n, char *out){
+
+            size_t used = encodeGroups(in, n - n % 3, out);
+            size_t o = used / 3 * 4;
+            if (n > used){
+                unsigned char last[3] = {in[used], 0, 0};
+                if (n - used > 1)
+                    last[1] = in[used + 1];
+                encodeGroup(last, out + o);
+                out[o + 3] = '=';
+                if (n - used == 1)
+                    out[o + 2] = '=';
+                o += 4;
+            }
+            return o;
+        }
+
+        /**
+        * Decodes Base64 text, stopping at the first character outside the
+        * alphabet.
+        * @param in The text.
+        * @param len The number of characters.
+        * @param out Receives up to base64DecodedSize(len) bytes.
+        * @return The number of bytes written.
+        */
+        static size_t decodeBase64(const char *in, size_t len, unsigned char *out){
+
+            return decodeBase64(in, len, out, base64DecodedSize(len));
+        }
+
+        /**
+        * Decodes Base64 text, writing at most capacity bytes, e.g. straight
+        * into the storage of a feature vector.
+        * @copydetails decodeBase64(const char *in, size_t len, unsigned char *out).
+        * @param capacity The size of out.
+        */
+        static size_t decodeBase64(const char *in, size_t len, unsigned char *out, size_t capacity){
+
+            size_t quads = std::min(len / 4, capacity / 3);
+            size_t used = decodeQuads(in, quads * 4, out);
+            size_t o = used / 4 * 3;
+
+            // At most one more (partial) group fits: decode it aside.
+            size_t valid = 0;
+            while ((used + valid < len) && (valid < 4) && (base64Value(in[used + valid]) >= 0))
+                valid++;
+            if ((valid > 1) && (o < capacity)){
+                unsigned char last[3];
+                size_t n = decodeTail(in + used, valid, last);
+                n = std::min(n, capacity - o);
+                memcpy(out + o, last, n);
+                o += n;
+            }
+            return o;
+        }
+
+        /**
+        * Encodes bytes as upper case hexadecimal, two characters per byte.
+        * @return The number of characters written, 2 * n.
+        */
+        static size_t encodeHex(const unsigned char *in, size_t n, char *out){
+
+            for (size_t x = 0; x < n; x++)
+                memcpy(out + 2 * x, Tables::instance.hex + 2 * in[x], 2);
+            return 2 * n;
+        }
+
+        /**
+        * Decodes hexadecimal text. Both cases are accepted, other characters
+        * count as 0, and an odd last character is the high half of the last
+        * byte, as in BasicArrayObject::fromHexaDecimal().
+        * @param out Receives (len + 1) / 2 bytes.
+        * @return The number of bytes written.
+        */
+        static size_t decodeHex(const char *in, size_t len, unsigned char *out){
+
+            const uint8_t *nibble = Tables::instance.nibble;
+            size_t x = 0;
+            for (; x + 1 < len; x += 2)
+                out[x / 2] = (nibble[(unsigned char) in[x]] << 4) | nibble[(unsigned char) in[x + 1]];
+            if (x < len)
+                out[x / 2] = nibble[(unsigned char) in[x]] << 4;
+            return (len + 1) / 2;
+        }
+
+    private:
+        friend class Base64Decoder;
+
+        struct Tables{
+            signed char base64[256];
+            uint8_t nibble[256];
+            char hex[512];
+
+            constexpr Tables() : base64(), nibble(), hex(){
+                for (int c = 0; c < 256; c++)
+                    base64[c] = -1;
+                for (int v = 0; v < 64; v++)
+                    base64[(unsigned char) "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+-"[v]] = v;
+                for (int v = 0; v < 16; v++){
+                    nibble[(unsigned char) "0123456789ABCDEF"[v]] = v;
+                    nibble[(unsigned char) "0123456789abcdef"[v]] = v;
+                }
+                for (int b = 0; b < 256; b++){
+                    hex[2 * b] = "0123456789ABCDEF"[b >> 4];
+                    hex[2 * b + 1] = "0123456789ABCDEF"[b & 15];
+                }
+            }
+
+            static const Tables instance;
+        };
+
+        static void encodeGroup(const unsigned char *in, char *out){
+
+            const char *alphabet = base64Alphabet();
+            out[0] = alphabet[in[0] >> 2];
+            out[1] = alphabet[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+            out[2] = alphabet[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+            out[3] = alphabet[in[2] & 0x3f];
+        }
+
+        // Decodes 2 to 4 valid characters into 1 to 3 bytes.
+        static size_t decodeTail(const char *in, size_t n, unsigned char *out){
+
+            int v[4] = {0, 0, 0, 0};
+            for (size_t x = 0; x < n; x++)
+                v[x] = base64Value(in[x]);
+            out[0] = (v[0] << 2) | (v[1] >> 4);
+            out[1] = (v[1] << 4) | (v[2] >> 2);
+            out[2] = (v[2] << 6) | v[3];
+            return n - 1;
+        }
+
+        // Encodes n bytes, a multiple of 3, without padding.
+        static size_t encodeGroups(const unsigned char *in, size_t n, char *out){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (DistanceKernels::level()){
+                case DistanceKernels::AVX512:
+                case DistanceKernels::AVX2: return encodeGroupsAvx2(in, n, out);
+                default: break;
+            }
+#endif
+            return encodeGroupsScalar(in, n, out, 0);
+        }
+
+        static size_t encodeGroupsScalar(const unsigned char *in, size_t n, char *out, size_t i){
+
+            for (; i < n; i += 3)
+                encodeGroup(in + i, out + i / 3 * 4);
+            return n;
+        }
+
+        // Decodes whole groups of 4 characters up to the first group holding
+        // a character outside the alphabet. Returns the characters consumed.
+        static size_t decodeQuads(const char *in, size_t len, unsigned char *out){
+
+#ifdef HERMES_X86_DISPATCH
+            switch (DistanceKernels::level()){
+                case DistanceKernels::AVX512:
+                case DistanceKernels::AVX2: return decodeQuadsAvx2(in, len, out);
+                default: break;
+            }
+#endif
+            return decodeQuadsScalar(in, len, out, 0);
+        }
+
+        static size_t decodeQuadsScalar(const char *in, size_t len, unsigned char *out, size_t i){
+
+            const signed char *table = Tables::instance.base64;
+            for (; i + 4 <= len; i += 4){
+                int a = table[(unsigned char) in[i]], b = table[(unsigned char) in[i + 1]];
+                int c = table[(unsigned char) in[i + 2]], d = table[(unsigned char) in[i + 3]];
+                if ((a | b | c | d) < 0)
+                    break;
+                unsigned char *o = out + i / 4 * 3;
+                o[0] = (a << 2) | (b >> 4);
+                o[1] = (b << 4) | (c >> 2);
+                o[2] = (c << 6) | d;
+            }
+            return i;
+        }
+
+#ifdef HERMES_VECTOR_EXTENSIONS
+        static inline void shuffle(SimdText16 &r, const SimdText16 &v, const SimdText16 &index){
+#ifndef __clang__
+            r = __builtin_shuffle(v, index);
+#else
+            for (int j = 0; j < 16; j++)
+                r[j] = v[index[j] & 15];
+#endif
+        }
+
+        static size_t encodeGroupsLanes(const unsigned char *in, size_t n, char *out){
+
+            const SimdText16 spread = {1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10};
+            size_t i = 0;
+
+            // Each step reads 16 bytes and encodes the first 12.
+            for (; i + 16 <= n; i += 12){
+                SimdText16 v, s, x;
+                SimdTextWord4 w;
+                memcpy(&v, in + i, 16);
+
+                // Every word holds b a c b of its group a b c, which puts each
+                // 6-bit index in a contiguous bit range.
+                shuffle(s, v, spread);
+                memcpy(&w, &s, 16);
+                w = ((w >> 10) & 63) | (((w >> 4) & 63) << 8) | (((w >> 22) & 63) << 16) | (((w >> 16) & 63) << 24);
+                memcpy(&x, &w, 16);
+
+                // Index to character: add the offset of its alphabet range.
+                SimdTextMask16 index = (SimdTextMask16) x;
+                SimdTextMask16 offset = SimdTextMask16() + 65;
+                offset += (index > 25) & 6;
+                offset += (index > 51) & -75;
+                offset += (index > 61) & -15;
+                offset += (index == 63) & 1;
+                x += (SimdText16) offset;
+                memcpy(out + i / 3 * 4, &x, 16);
+            }
+            return encodeGroupsScalar(in, n, out, i);
+        }
+
+        static size_t decodeQuadsLanes(const char *in, size_t len, unsigned char *out){
+
+            const SimdText16 pack = {0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 3, 7, 11, 15};
+            size_t i = 0;
+
+            for (; i + 16 <= len; i += 16){
+                SimdText16 v, b;
+                SimdTextMask16 c;
+                SimdTextWord4 w;
+                memcpy(&c, in + i, 16);
+
+                // Signed comparisons: characters above 127 are negative and
+                // fall outside every range.
+                SimdTextMask16 upper = (c > 'A' - 1) & (c < 'Z' + 1);
+                SimdTextMask16 lower = (c > 'a' - 1) & (c < 'z' + 1);
+                SimdTextMask16 digit = (c > '0' - 1) & (c < '9' + 1);
+                SimdTextMask16 plus = (c == '+');
+                SimdTextMask16 minus = (c == '-');
+                SimdTextMask16 valid = upper | lower | digit | plus | minus;
+                uint64_t half[2];
+                memcpy(half, &valid, 16);
+                if ((half[0] & half[1]) != ~(uint64_t) 0)
+                    break;
+
+                SimdTextMask16 offset = (upper & -65) | (lower & -71) | (digit & 4) | (plus & 19) | (minus & 18);
+                v = (SimdText16) (c + offset);
+
+                // Join the four 6-bit values of every word into 3 bytes, most
+                // significant first, then drop the fourth byte of each word.
+                memcpy(&w, &v, 16);
+                w = ((w & 0xff) << 18) | (((w >> 8) & 0xff) << 12) | (((w >> 16) & 0xff) << 6) | (w >> 24);
+                w = ((w >> 16) & 0xff) | (w & 0xff00) | ((w & 0xff) << 16);
+                memcpy(&v, &w, 16);
+                shuffle(b, v, pack);
+                memcpy(out + i / 4 * 3, &b, 12);
+            }
+            return decodeQuadsScalar(in, len, out, i);
+        }
+#endif
+
+#ifdef HERMES_X86_DISPATCH
+        __attribute__((target("avx2"), flatten))
+        static size_t encodeGroupsAvx2(const unsigned char *in, size_t n, char *out){
+            return encodeGroupsLanes(in, n, out);
+        }
+
+        __attribute__((target("avx2"), flatten))
+        static size_t decodeQuadsAvx2(const char *in, size_t len, unsigned char *out){
+            return decodeQuadsLanes(in, len, out);
+        }
+#endif
+};
+
+inline constexpr TextCodec::Tables TextCodec::Tables::instance;
+
+/**
+* Base64 encoding of a byte stream fed in pieces of any size, e.g. a batch
+* of serialized feature vectors written to a text column.
+*
+* Example:
+*   Base64Encoder encoder;
+*   for (...) text.append(buf, encoder.update(bytes, n, buf));
+*   text.append(buf, encoder.finish(buf));
+*/
+class Base64Encoder{
+
+    private:
+        unsigned char pending[3];
+        size_t count;
+
+    public:
+
+        Base64Encoder(){
+            count = 0;
+        }
+
+        /**
+        * Encodes more bytes. Up to 2 of them are held back until the next
+        * call completes their group.
+        * @param out Receives up to TextCodec::base64Size(n + 2) characters.
+        * @return The number of characters written.
+        */
+        size_t update(const unsigned char *in, size_t n, char *out){
+
+            size_t o = 0;
+            while ((count > 0) && (count < 3) && (n > 0)){
+                pending[count++] = *in++;
+                n--;
+            }
+            if (count == 3){
+                o += TextCodec::encodeBase64(pending, 3, out);
+                count = 0;
+            }
+            size_t whole = n - n % 3;
+            o += TextCodec::encodeBase64(in, whole, out + o);
+            for (size_t x = whole; x < n; x++)
+                pending[count++] = in[x];
+            return o;
+        }
+
+        /**
+        * Encodes the held back bytes with padding and resets the encoder.
+        * @param out Receives up to 4 characters.
+        * @return The number of characters written.
+        */
+        size_t finish(char *out){
+
+            size_t o = TextCodec::encodeBase64(pending, count, out);
+            count = 0;
+            return o;
+        }
+};
+
+/**
+* Base64 decoding of text fed in pieces of any size. Like
+* TextCodec::decodeBase64(), it stops at the first character outside the
+* alphabet and ignores everything after it.
+*/
+class Base64Decoder{
+
+    private:
+        char pending[4];
+        size_t count;
+        bool stopped;
+
+        size_t push(char c, unsigned char *out){
+
+            if (TextCodec::base64Value(c) < 0){
+                stopped = true;
+                return 0;
+            }
+            pending[count++] = c;
+            if (count < 4)
+                return 0;
+            count = 0;
+            return TextCodec::decodeBase64(pending, 4, out);
+        }
+
+    public:
+
+        Base64Decoder(){
+            count = 0;
+            stopped = false;
+        }
+
+        /**
+        * Decodes more text. Up to 3 characters are held back until the next
+        * call completes their group.
+        * @param out Receives up to TextCodec::base64DecodedSize(len + 3) bytes.
+        * @return The number of bytes written.
+        */
+        size_t update(const char *in, size_t len, unsigned char *out){
+
+            size_t used = 0, o = 0;
+            while ((count > 0) && (used < len) && !stopped)
+                o += push(in[used++], out + o);
+            if (stopped)
+                return o;
+
+            size_t consumed = TextCodec::decodeQuads(in + used, (len - used) / 4 * 4, out + o);
+            o += consumed / 4 * 3;
+            used += consumed;
+            while ((used < len) && !stopped)
+                o += push(in[used++], out + o);
+            return o;
+        }
+
+        /**
+        * Decodes the held back characters and resets the decoder.
+        * @param out Receives up to 2 bytes.
+        * @return The number of bytes written.
+        */
+        size_t finish(unsigned char *out){
+
+            size_t o = TextCodec::decodeBase64(pending, count, out);
+            count = 0;
+            stopped = false;
+            return o;
+        }
+
+        /**
+        * Tells whether a character outside the alphabet was met.
+        */
+        bool isStopped() const{
+
+            return stopped;
+        }
+};
+
+#endif // TEXTCODEC_H
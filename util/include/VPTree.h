@@ -0,0 +1,345 @@
+#ifndef VPTREE_H
+#define VPTREE_H
+
+#include <EuclideanDistance.h>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <queue>
+#include <random>
+#include <stdint.h>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+* Vantage-point tree over a list of objects, for exact range and k-nearest
+* neighbor queries under any metric distance function.
+*
+* Every internal node picks a vantage point among its objects and splits the
+* others at their median distance to it; the triangle inequality then rules
+* out whole subtrees at query time. Leaves hold up to LeafSize objects along
+* with their distance to the parent vantage point, which filters them before
+* any distance is computed.
+*
+* The tree keeps positions in the list, not copies: the list must outlive the
+* tree and stay unchanged. Queries count their distances in the Metric
+* object (getStatistics()) and in DistanceStatistics, so the distances of a
+* single query can be read with a DistanceStatistics::QueryScope.
+*
+* Example:
+*   VPTree< FeatureVector, EuclideanDistance<FeatureVector> > tree(list);
+*   std::vector< std::pair<double, uint32_t> > best;
+*   tree.kNearest(query, 10, best);
+*
+* @arg ObjectType The type of the indexed objects.
+* @arg Metric A DistanceFunction<ObjectType> class that is a metric.
+*/
+template <class ObjectType, class Metric = EuclideanDistance<ObjectType> >
+class VPTree{
+
+    public:
+        /**
+        * A query answer: the distance and the position of the object.
+        */
+        typedef std::pair<double, uint32_t> Result;
+
+        static const uint32_t LeafSize = 16;
+
+    private:
+        struct Item{
+            uint32_t index;
+            // Distance to the vantage point of the enclosing node.
+            double dist;
+        };
+
+        // The node of the range [begin, end) is stored at nodes[begin], its
+        // vantage point at items[begin]; the inner subtree is [begin + 1,
+        // mid) and the outer one [mid, end).
+        struct Node{
+            double innerLow, innerHigh;
+            double outerLow, outerHigh;
+            uint32_t mid;
+        };
+
+        // Subtrees smaller than this are not worth a thread.
+        static const uint32_t ParallelGrain = 4096;
+
+        // Computed distances carry rounding errors relative to their
+        // magnitude; the triangle inequality tests are widened by this
+        // fraction of the distances compared, so no answer is pruned.
+        static constexpr double RelativeSlack = 1e-9;
+
+        std::vector<ObjectType> *objects;
+        std::vector<Item> items;
+        std::vector<Node> nodes;
+        Metric metric;
+        std::atomic<uint64_t> buildCount;
+        uint32_t seed;
+
+    public:
+
+        /**
+        * Builds the tree.
+        *
+        * @param objects The objects to be indexed.
+        * @param threads The number of threads building the tree (0 for one
+        * per hardware thread).
+        * @param seed The seed of the vantage point choices.
+        */
+        VPTree(std::vector<ObjectType> &objects, uint32_t threads = 0, uint32_t seed = 5489)
+            : VPTree(objects, Metric(), threads, seed){
+        }
+
+        /**
+        * Builds the tree with a copy of a configured metric, e.g.
+        * MinkowskiDistance<ObjectType>(3.0).
+        *
+        * @param objects The objects to be indexed.
+        * @param metric The metric; its statistics are not carried over.
+        * @param threads The number of threads building the tree (0 for one
+        * per hardware thread).
+        * @param seed The seed of the vantage point choices.
+        */
+        VPTree(std::vector<ObjectType> &objects, const Metric &metric, uint32_t threads = 0, uint32_t seed = 5489)
+            : metric(metric){
+
+            this->metric.resetStatistics();
+            this->objects = &objects;
+            this->seed = seed;
+            buildCount = 0;
+
+            items.resize(objects.size());
+            nodes.resize(objects.size());
+            for (uint32_t x = 0; x < items.size(); x++){
+                items[x].index = x;
+                items[x].dist = 0.0;
+            }
+
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            uint32_t depth = 0;
+            while ((1u << depth) < threads)
+                depth++;
+            build(0, items.size(), depth);
+        }
+
+        /**
+        * Gets the number of indexed objects.
+        */
+        size_t size() const{
+
+            return items.size();
+        }
+
+        /**
+        * Finds every object within radius of the query, nearest first.
+        *
+        * @param query The query object.
+        * @param radius The query radius.
+        * @param result Receives (distance, position) pairs.
+        */
+        void range(ObjectType &query, double radius, std::vector<Result> &result){
+
+            result.clear();
+            if (!items.empty())
+                rangeSearch(query, radius, 0, items.size(), -1.0, result);
+            std::sort(result.begin(), result.end());
+        }
+
+        /**
+        * Finds the k nearest objects to the query, nearest first. Ties at the
+        * k-th distance are broken arbitrarily.
+        *
+        * @param query The query object.
+        * @param k The number of neighbors.
+        * @param result Receives (distance, position) pairs.
+        */
+        void kNearest(ObjectType &query, size_t k, std::vector<Result> &result){
+
+            result.clear();
+            if (items.empty() || (k == 0))
+                return;
+
+            std::priority_queue<Result> best;
+            double tau = std::numeric_limits<double>::infinity();
+            nearestSearch(query, k, 0, items.size(), -1.0, best, tau);
+
+            result.resize(best.size());
+            for (size_t x = result.size(); x > 0; x--){
+                result[x - 1] = best.top();
+                best.pop();
+            }
+        }
+
+        /**
+        * Returns the number of distances computed by the queries.
+        */
+        uint64_t getStatistics(){
+
+            return metric.getDistanceCount();
+        }
+
+        void resetStatistics(){
+
+            metric.resetStatistics();
+        }
+
+        /**
+        * Returns the number of distances computed to build the tree.
+        */
+        uint64_t getBuildStatistics() const{
+
+            return buildCount.load();
+        }
+
+    private:
+
+        bool isLeaf(uint32_t begin, uint32_t end) const{
+
+            return end - begin <= LeafSize;
+        }
+
+        void build(uint32_t begin, uint32_t end, uint32_t depth){
+
+            if (isLeaf(begin, end))
+                return;
+
+            // Deterministic choice, whatever the thread running it.
+            std::mt19937 random(seed ^ (begin * 2654435761u));
+            uint32_t pick = begin + random() % (end - begin);
+            std::swap(items[begin], items[pick]);
+
+            Metric local(metric);
+            ObjectType &vp = (*objects)[items[begin].index];
+            for (uint32_t x = begin + 1; x < end; x++)
+                items[x].dist = local.getDistance(vp, (*objects)[items[x].index]);
+            buildCount += end - begin - 1;
+
+            uint32_t mid = begin + 1 + (end - begin - 1) / 2;
+            std::nth_element(items.begin() + begin + 1, items.begin() + mid, items.begin() + end, ItemCloser());
+
+            Node &node = nodes[begin];
+            node.mid = mid;
+            node.innerLow = node.outerLow = std::numeric_limits<double>::infinity();
+            node.innerHigh = node.outerHigh = 0.0;
+            for (uint32_t x = begin + 1; x < end; x++){
+                double &low = (x < mid) ? node.innerLow : node.outerLow;
+                double &high = (x < mid) ? node.innerHigh : node.outerHigh;
+                low = std::min(low, items[x].dist);
+                high = std::max(high, items[x].dist);
+            }
+
+            if ((depth > 0) && (end - begin >= ParallelGrain)){
+                std::future<void> outer;
+                try {
+                    outer = std::async(std::launch::async, &VPTree::build, this, mid, end, depth - 1);
+                } catch (std::system_error &){
+                    // No threads on this platform: carry on alone.
+                    build(begin + 1, mid, 0);
+                    build(mid, end, 0);
+                    return;
+                }
+                build(begin + 1, mid, depth - 1);
+                outer.get();
+            } else {
+                build(begin + 1, mid, 0);
+                build(mid, end, 0);
+            }
+        }
+
+        // parentDist is the query distance to the vantage point of the parent
+        // node, negative at the root.
+        void rangeSearch(ObjectType &query, double radius, uint32_t begin, uint32_t end, double parentDist, std::vector<Result> &result){
+
+            if (isLeaf(begin, end)){
+                for (uint32_t x = begin; x < end; x++){
+                    if ((parentDist >= 0.0) && !near(parentDist, items[x].dist, radius))
+                        continue;
+                    double d = metric.getBoundedDistance(query, (*objects)[items[x].index], radius);
+                    if (d <= radius)
+                        result.push_back(Result(d, items[x].index));
+                }
+                return;
+            }
+
+            const Node &node = nodes[begin];
+            double d = metric.getDistance(query, (*objects)[items[begin].index]);
+            if (d <= radius)
+                result.push_back(Result(d, items[begin].index));
+
+            if (overlaps(d, radius, node.innerLow, node.innerHigh))
+                rangeSearch(query, radius, begin + 1, node.mid, d, result);
+            if (overlaps(d, radius, node.outerLow, node.outerHigh))
+                rangeSearch(query, radius, node.mid, end, d, result);
+        }
+
+        void nearestSearch(ObjectType &query, size_t k, uint32_t begin, uint32_t end, double parentDist, std::priority_queue<Result> &best, double &tau){
+
+            if (isLeaf(begin, end)){
+                for (uint32_t x = begin; x < end; x++){
+                    if ((parentDist >= 0.0) && !near(parentDist, items[x].dist, tau))
+                        continue;
+                    double d = metric.getBoundedDistance(query, (*objects)[items[x].index], tau);
+                    offer(Result(d, items[x].index), k, best, tau);
+                }
+                return;
+            }
+
+            const Node &node = nodes[begin];
+            double d = metric.getDistance(query, (*objects)[items[begin].index]);
+            offer(Result(d, items[begin].index), k, best, tau);
+
+            // The subtree on the query side of the median is searched first,
+            // as it most likely tightens tau.
+            bool innerFirst = (d < node.outerLow);
+            for (int side = 0; side < 2; side++){
+                bool inner = (side == 0) == innerFirst;
+                double low = inner ? node.innerLow : node.outerLow;
+                double high = inner ? node.innerHigh : node.outerHigh;
+                if (overlaps(d, tau, low, high)){
+                    if (inner)
+                        nearestSearch(query, k, begin + 1, node.mid, d, best, tau);
+                    else
+                        nearestSearch(query, k, node.mid, end, d, best, tau);
+                }
+            }
+        }
+
+        // Whether |a - b| may be <= r, up to the rounding of a and b.
+        static bool near(double a, double b, double r){
+
+            return std::fabs(a - b) <= r + RelativeSlack * (a + b);
+        }
+
+        // Whether a distance in [low, high] may lie within r of d, up to
+        // the rounding of all three.
+        static bool overlaps(double d, double r, double low, double high){
+
+            return (d + r + RelativeSlack * (d + low) >= low) && (d - r - RelativeSlack * (d + high) <= high);
+        }
+
+        static void offer(const Result &r, size_t k, std::priority_queue<Result> &best, double &tau){
+
+            if (best.size() < k){
+                best.push(r);
+            } else if (r.first < tau){
+                best.pop();
+                best.push(r);
+            } else {
+                return;
+            }
+            if (best.size() == k)
+                tau = best.top().first;
+        }
+
+        struct ItemCloser{
+            bool operator()(const Item &a, const Item &b) const{
+                return a.dist < b.dist;
+            }
+        };
+};
+
+#endif // VPTREE_H